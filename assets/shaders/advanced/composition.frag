@@ -15,9 +15,13 @@ layout (std140, binding = 0) uniform UNIFORMS
 	vec3 CameraDirection;
 
 	vec3 LightDirection;
+
+	// camera the hit distances were marched with
+	mat4 MarchInvProjectionView;
+	vec3 MarchCameraPosition;
 } Uniforms;
 
-layout (binding = 1) uniform sampler2D Positions;
+layout (binding = 1) uniform sampler2D HitDistances;
 layout (binding = 3) uniform sampler2D SmoothedDepth;
 layout (binding = 4) uniform sampler2D ObjectNormals;
 // layout (binding = 3) uniform sampler2D Depth;
@@ -45,7 +49,30 @@ vec4 sampleFloor(vec3 a, vec3 r)
 	return vec4(vec3(0.25 + (f.x + f.y) / 4), 0.5);
 }
 
-vec3 position(vec2 uv) { return texture(Positions, uv).xyz; }
+// Direction of the ray the hit distance was marched along. The ray marcher
+// starts its rays at pixel corners, hence the half texel shift.
+vec3 marchRay()
+{
+	const vec2 uv = UV - 0.5 / vec2(textureSize(HitDistances, 0));
+
+	vec4 worldH =
+		Uniforms.MarchInvProjectionView *
+		vec4(2 * uv - 1, 1, 1);
+
+	return normalize(worldH.xyz / worldH.w - Uniforms.MarchCameraPosition);
+}
+
+// octahedral normal encoding, see encodeNormal in RayMarcher.cpp
+vec3 decodeNormal(vec2 e)
+{
+	vec3 n = vec3(e, 1 - abs(e.x) - abs(e.y));
+	const float t = max(-n.z, 0);
+
+	n.x += n.x >= 0 ? -t : t;
+	n.y += n.y >= 0 ? -t : t;
+
+	return normalize(n);
+}
 
 vec3 smoothedPosition(vec2 uv)
 {
@@ -70,15 +97,15 @@ vec3 viewRay()
 void main()
 {
 
-	// Color = vec4(texture(Positions, UV).xyz, 1);
+	// Color = vec4(Uniforms.MarchCameraPosition + texture(HitDistances, UV).r * marchRay(), 1);
 	// return;
 
 	// if (texture(SmoothedDepth, UV).r > 0.99)
 	// 	discard;
 
-	const vec4 PositionsSampled = texture(Positions, UV);
+	const float hitDistance = texture(HitDistances, UV).r;
 
-	if (PositionsSampled.w == 0)
+	if (hitDistance == 0)
 	{
 		Color = .75 * sampleFloor(Uniforms.CameraPosition, viewRay());
 		return;
@@ -103,9 +130,9 @@ void main()
 	const vec3 screenNormal = normalize(cross(dx, dy));
 #endif
 
-	const vec3 world = PositionsSampled.xyz;
+	const vec3 world = Uniforms.MarchCameraPosition + hitDistance * marchRay();
 
-	const vec3 objectNormal = texture(ObjectNormals, UV).xyz;
+	const vec3 objectNormal = decodeNormal(texture(ObjectNormals, UV).xy);
 	const vec3 normal = objectNormal;
 
 	// const vec3 normal = normalize(screenNormal + objectNormal);
@@ -1,11 +1,13 @@
 #version 460
 
 #define MAX_KERNEL_N 32
+#define MAX_TAPS MAX_KERNEL_N
 
 layout (std140, binding = 0) uniform UNIFORMS2
 {
 	int GaussN;
-	vec4[MAX_KERNEL_N * MAX_KERNEL_N / 4] Kernel;
+	int NumTaps;
+	vec4[MAX_TAPS] Taps; // x: offset in texels, y: weight
 } Uniforms;
 
 layout (std140, binding = 2) uniform UNIFORMS
@@ -14,33 +16,28 @@ layout (std140, binding = 2) uniform UNIFORMS
 	float TexelHeight;
 } ResolutionUniforms;
 
+layout (push_constant) uniform PUSH_CONSTANTS
+{
+	vec2 Direction;
+} PushConstants;
+
 layout (binding = 1) uniform sampler2D Depth;
 
 layout (location = 0) in vec2 UV;
 
 layout (location = 0) out float SmoothedDepth;
 
-float getKernelValue(int index)
-{
-	return Uniforms.Kernel[index / 4][index % 4];
-}
-
 void main()
 {
-	const int N = Uniforms.GaussN;
-	const vec2 res = vec2(ResolutionUniforms.TexelWidth, ResolutionUniforms.TexelHeight);
-	float sum = 0;
+	const vec2 step = PushConstants.Direction * vec2(ResolutionUniforms.TexelWidth, ResolutionUniforms.TexelHeight);
+
+	float sum = Uniforms.Taps[0].y * texture(Depth, UV).r;
 
-	for (int i = -N; i <= N; ++i)
+	for (int i = 1; i < Uniforms.NumTaps; ++i)
 	{
-		for (int j = -N; j <= N; ++j)
-		{
-			int index = abs(i) * (Uniforms.GaussN + 1) + abs(j);
-
-			sum +=
-				getKernelValue(index) *
-				texture(Depth, UV + vec2(i, j) * res).r;
-		}
+		const vec2 offset = Uniforms.Taps[i].x * step;
+
+		sum += Uniforms.Taps[i].y * (texture(Depth, UV + offset).r + texture(Depth, UV - offset).r);
 	}
 
 	SmoothedDepth = sum;
@@ -8,8 +8,13 @@ layout (std140, binding = 0) uniform UNIFORMS
 	float Radius; // world space
 } Uniforms;
 
-layout (location = 0) in vec3 a_Position;
-layout (location = 1) in vec2 a_UV;
+layout (location = 0) in vec3 a_Position; // per instance
+
+// billboard corners of the two triangles, selected by gl_VertexIndex
+const vec2 c_UVs[6] = vec2[](
+	vec2(0, 0), vec2(0, 1), vec2(1, 0),
+	vec2(1, 0), vec2(0, 1), vec2(1, 1)
+);
 
 layout (location = 0) out FRAGMENT_IN
 {
@@ -19,10 +24,13 @@ layout (location = 0) out FRAGMENT_IN
 
 void main()
 {
-	const vec4 viewPosition = Uniforms.View * vec4(a_Position, 1);
+	// expand the billboard in view space, so that it faces the camera
+	const vec2 uv = c_UVs[gl_VertexIndex];
+	vec4 viewPosition = Uniforms.View * vec4(a_Position, 1);
+	viewPosition.xy += Uniforms.Radius * vec2(2 * uv.x - 1, 1 - 2 * uv.y);
 
 	Output.ViewPosition = viewPosition.xyz / viewPosition.w;
-	Output.UV = a_UV;
+	Output.UV = uv;
 
 	gl_Position = Uniforms.Projection * viewPosition;
 }
@@ -1,20 +1,51 @@
 #version 460
 
+#define MODE_INVERTED 0
+#define MODE_HEATMAP 1
+
 layout (std140, binding = 2) uniform UNIFORMS
 {
 	float TexelWidth;
 	float TexelHeight;
 } ResolutionUniforms;
 
+layout (push_constant) uniform PUSH_CONSTANTS
+{
+	int Mode;
+} PushConstants;
+
 layout (binding = 0) uniform sampler2D Image;
 
 layout (location = 0) in vec2 UV;
 
 layout (location = 0) out vec4 Color;
 
+// black -> blue -> cyan -> green -> yellow -> red
+vec3 heatmap(float x)
+{
+	const vec3 colors[6] = vec3[](
+		vec3(0.0, 0.0, 0.0),
+		vec3(0.0, 0.0, 1.0),
+		vec3(0.0, 1.0, 1.0),
+		vec3(0.0, 1.0, 0.0),
+		vec3(1.0, 1.0, 0.0),
+		vec3(1.0, 0.0, 0.0)
+	);
+
+	const float t = clamp(x, 0.0, 1.0) * 5.0;
+	const int i = min(int(t), 4);
+
+	return mix(colors[i], colors[i + 1], t - float(i));
+}
+
 void main()
 {
-	Color = vec4(vec3(1-texture(Image, UV).r), 1);
+	const float r = texture(Image, UV).r;
+
+	if (PushConstants.Mode == MODE_HEATMAP)
+		Color = vec4(heatmap(r), 1);
+	else
+		Color = vec4(vec3(1-r), 1);
 	// Color = vec4(texture(Image, UV).r, 0, 0, 1);
 	// Color = vec4(1,0,0,1);
 }
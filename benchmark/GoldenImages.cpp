@@ -0,0 +1,321 @@
+#include <engine/hzpch.h>
+
+#include "GoldenImages.h"
+#include "MarchView.h"
+
+#include "app/Dataset.h"
+#include "app/AdvancedRenderer/RayMarcher.h"
+
+#include <engine/utils/Profiler.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+// ------------------------------------------------------------------------
+
+namespace
+{
+	struct Scene
+	{
+		const char* Name;
+		size_t NumParticles;
+		uint32_t Seed;
+		glm::vec3 Direction; // of the camera from the center
+		bool Anisotropic;
+		bool Approximate;
+		bool GridSkipping;
+	};
+
+	// Changing a scene invalidates its golden, add new ones instead.
+	const Scene Scenes[] = {
+		{ "cube_20k_isotropic", 20000, 1, { 1.0f, 0.8f, -1.2f }, false, false, true },
+		{ "cube_20k_isotropic_no_skipping", 20000, 1, { 1.0f, 0.8f, -1.2f }, false, false, false },
+		{ "cube_100k_anisotropic", 100000, 2, { 1.0f, 0.8f, -1.2f }, true, false, true },
+		{ "cube_100k_anisotropic_approx", 100000, 2, { 1.0f, 0.8f, -1.2f }, true, true, true },
+		{ "cube_100k_anisotropic_top", 100000, 2, { 0.1f, 1.5f, -0.2f }, true, false, true },
+	};
+
+	// the particle density of the benchmark scenes
+	constexpr float ParticleRadius = 0.1f;
+	constexpr float ParticleRadiusMultiplier = 2.0f;
+	constexpr float ParticleSpacing = 0.5f * ParticleRadius;
+
+	constexpr uint32_t Resolution = 128;
+
+	// of active pixels, in particle radii and in degrees
+	constexpr float MaxHitMismatch = 0.002f;
+	constexpr float MaxMeanPositionError = 0.02f;
+	constexpr float MaxMeanNormalError = 1.0f;
+
+	struct GoldenHeader
+	{
+		char Magic[4] = { 'G', 'L', 'D', '1' };
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+	};
+
+	struct Image
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		std::vector<float> HitDistances;
+		std::vector<uint32_t> Normals;
+	};
+}
+
+// ------------------------------------------------------------------------
+
+static bool WriteGolden(const std::filesystem::path& path, const Image& image)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Could not write golden '{}'!", path.string());
+		return false;
+	}
+
+	GoldenHeader header;
+	header.Width = image.Width;
+	header.Height = image.Height;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(image.HitDistances.data()), image.HitDistances.size() * sizeof(float));
+	file.write(reinterpret_cast<const char*>(image.Normals.data()), image.Normals.size() * sizeof(uint32_t));
+
+	return bool(file);
+}
+
+static bool ReadGolden(const std::filesystem::path& path, Image& image)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file)
+		return false;
+
+	GoldenHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!file || std::memcmp(header.Magic, GoldenHeader().Magic, sizeof(header.Magic)) != 0)
+	{
+		SPDLOG_ERROR("'{}' is not a golden!", path.string());
+		return false;
+	}
+
+	const size_t numPixels = size_t(header.Width) * header.Height;
+
+	image.Width = header.Width;
+	image.Height = header.Height;
+	image.HitDistances.resize(numPixels);
+	image.Normals.resize(numPixels);
+
+	file.read(reinterpret_cast<char*>(image.HitDistances.data()), numPixels * sizeof(float));
+	file.read(reinterpret_cast<char*>(image.Normals.data()), numPixels * sizeof(uint32_t));
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Golden '{}' is truncated!", path.string());
+		return false;
+	}
+
+	return true;
+}
+
+// Normals as colors, active pixels without a hit dark gray.
+static void WriteNormalImage(const std::filesystem::path& path, const Image& image, const std::vector<float>& depth)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	file << "P6\n" << image.Width << " " << image.Height << "\n255\n";
+
+	for (size_t i = 0; i < image.HitDistances.size(); i++)
+	{
+		glm::vec3 color(0.0f);
+
+		if (image.HitDistances[i] != 0.0f)
+			color = 0.5f * decodeNormal(image.Normals[i]) + 0.5f;
+		else if (depth[i] != 1.0f)
+			color = glm::vec3(0.125f);
+
+		const glm::u8vec3 rgb = glm::u8vec3(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+		file.write(reinterpret_cast<const char*>(&rgb), 3);
+	}
+}
+
+// Returns the median march time in ms, the image is that of the last run.
+static float March(const GoldenOptions& options,
+				   const Scene& scene,
+				   RayMarcher& marcher,
+				   Dataset& dataset,
+				   MarchView& view,
+				   Image& image)
+{
+	const VisualizationSettings settings = {
+		.Frame = 0,
+		.MaxSteps = 128,
+		.StepSize = 0.09f * ParticleRadius,
+		.IsoDensity = 1.0f,
+		.EnableGridSkipping = scene.GridSkipping,
+		.EnableAnisotropy = scene.Anisotropic,
+		.ApproximateAnisotropy = scene.Approximate,
+		.k_n = 0.5f,
+		.k_r = 2.0f,
+		.k_s = 2000.0f,
+		.N_eps = 1,
+	};
+
+	image.Width = view.Width;
+	image.Height = view.Height;
+	image.HitDistances.assign(size_t(view.Width) * view.Height, 0.0f);
+	image.Normals.assign(size_t(view.Width) * view.Height, 0);
+
+	std::vector<float> times;
+
+	for (uint32_t i = 0; i < options.Repetitions; i++)
+	{
+		marcher.Prepare(settings, view.CameraPosition, view.InvProjectionView, view.Width, view.Height,
+						&dataset, image.HitDistances.data(), image.Normals.data(), view.Depth.data());
+
+		// every run starts cold, like the first march of a frame
+		marcher.ResetAnisotropyCache();
+
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		marcher.Start();
+		while (!marcher.IsDone())
+			std::this_thread::yield();
+
+		times.push_back(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+
+		Profiler::Collect();
+	}
+
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+// ------------------------------------------------------------------------
+
+bool RunGoldenImages(const GoldenOptions& options, RayMarcher& marcher)
+{
+	const std::filesystem::path budgetsPath = options.Directory / "budgets.yml";
+
+	YAML::Node budgets;
+
+	if (options.Update)
+		std::filesystem::create_directories(options.Directory);
+	else if (std::filesystem::exists(budgetsPath))
+		budgets = YAML::LoadFile(budgetsPath.string());
+
+	uint32_t numFailed = 0;
+	uint32_t numSkipped = 0;
+
+	for (const Scene& scene : Scenes)
+	{
+		const float extent = 0.5f * std::cbrt(float(scene.NumParticles)) * ParticleSpacing;
+
+		Dataset dataset;
+		Dataset::makeCube(dataset, extent, scene.NumParticles, ParticleRadius, ParticleRadiusMultiplier, scene.Seed);
+
+		MarchView view = MarchView::Make(dataset.Frames[0], extent, Resolution, scene.Direction);
+
+		Image image;
+		const float time = March(options, scene, marcher, dataset, view, image);
+
+		const std::filesystem::path goldenPath = options.Directory / (std::string(scene.Name) + ".bin");
+
+		if (options.Update)
+		{
+			if (!WriteGolden(goldenPath, image))
+			{
+				numFailed++;
+				continue;
+			}
+
+			budgets[scene.Name]["march_ms"] = time;
+
+			SPDLOG_INFO("{:<32} {:>8.3f} ms  golden written", scene.Name, time);
+			continue;
+		}
+
+		if (!std::filesystem::exists(goldenPath))
+		{
+			SPDLOG_WARN("{:<32} {:>8.3f} ms  SKIPPED, no golden, run with '--golden update' first", scene.Name, time);
+			numSkipped++;
+			continue;
+		}
+
+		Image golden;
+		if (!ReadGolden(goldenPath, golden))
+		{
+			numFailed++;
+			continue;
+		}
+
+		std::vector<std::string> failures;
+
+		if (golden.Width != image.Width || golden.Height != image.Height)
+			failures.push_back(fmt::format("golden is {}x{}", golden.Width, golden.Height));
+		else
+		{
+			const RayMarcher::ImageDifference difference = RayMarcher::CompareImages(
+				golden.HitDistances.data(), golden.Normals.data(),
+				image.HitDistances.data(), image.Normals.data(),
+				view.Depth.data(), image.Width * image.Height, ParticleRadius);
+
+			if (difference.HitMismatch > MaxHitMismatch)
+				failures.push_back(fmt::format("{:.3f} % of the hits differ", 100.0f * difference.HitMismatch));
+			if (difference.MeanPositionError > MaxMeanPositionError)
+				failures.push_back(fmt::format("mean position error {:.4f} radii", difference.MeanPositionError));
+			if (difference.MeanNormalError > MaxMeanNormalError)
+				failures.push_back(fmt::format("mean normal error {:.3f} deg", difference.MeanNormalError));
+		}
+
+		if (const YAML::Node budget = budgets[scene.Name]["march_ms"])
+		{
+			const float limit = budget.as<float>() * (1.0f + 0.01f * options.BudgetTolerance);
+
+			if (time > limit)
+				failures.push_back(fmt::format("march took {:.3f} ms, budget {:.3f} ms", time, limit));
+		}
+		else
+			SPDLOG_WARN("{:<32} has no march budget.", scene.Name);
+
+		if (failures.empty())
+		{
+			SPDLOG_INFO("{:<32} {:>8.3f} ms  passed", scene.Name, time);
+			continue;
+		}
+
+		numFailed++;
+
+		for (const std::string& failure : failures)
+			SPDLOG_ERROR("{:<32} {}", scene.Name, failure);
+
+		WriteNormalImage(options.Directory / (std::string(scene.Name) + ".actual.ppm"), image, view.Depth);
+		if (golden.Width == image.Width && golden.Height == image.Height)
+			WriteNormalImage(options.Directory / (std::string(scene.Name) + ".golden.ppm"), golden, view.Depth);
+	}
+
+	if (options.Update)
+	{
+		std::ofstream file(budgetsPath, std::ios::trunc);
+		file << "# median march times in ms of the machine that wrote the goldens\n"
+			 << budgets << "\n";
+	}
+
+	const size_t numPassed = std::size(Scenes) - numFailed - numSkipped;
+
+	if (numFailed)
+		SPDLOG_ERROR("{} of {} scenes failed, {} skipped.", numFailed, std::size(Scenes), numSkipped);
+	else if (numSkipped)
+		SPDLOG_WARN("{} of {} scenes passed, {} skipped without a golden.", numPassed, std::size(Scenes), numSkipped);
+	else
+		SPDLOG_INFO("All {} scenes passed.", std::size(Scenes));
+
+	return numFailed == 0;
+}
+
+// ------------------------------------------------------------------------
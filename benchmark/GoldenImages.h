@@ -0,0 +1,30 @@
+#pragma once
+
+class RayMarcher;
+
+/*
+* Regression check of the ray marcher on fixed scenes: seeded cubes seen from
+* fixed cameras with fixed settings. The hit distances and normals of every
+* scene are compared with stored goldens, and the median march time with a
+* stored budget.
+*
+*   benchmark --golden update   writes the goldens and the budgets
+*   benchmark --golden check    fails if an image or a march time regressed
+*
+* The goldens and the budgets in assets/goldens are written by update on the
+* reference machine and committed; check skips scenes without a golden and
+* only fails for a golden that differs or cannot be read.
+* The budgets are march times of the machine that wrote them. The composition
+* needs the GPU and is not checked; the normals of failing scenes are written
+* as PPM images next to the goldens instead.
+*/
+struct GoldenOptions
+{
+	std::filesystem::path Directory = "assets/goldens";
+	bool Update = false;
+	uint32_t Repetitions = 5;
+	float BudgetTolerance = 25.0f; // in percent over the budget
+};
+
+// Returns false if a scene failed. Scenes without a golden are skipped.
+bool RunGoldenImages(const GoldenOptions& options, RayMarcher& marcher);
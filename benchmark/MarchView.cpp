@@ -0,0 +1,53 @@
+#include <engine/hzpch.h>
+
+#include "MarchView.h"
+
+#include "app/Dataset.h"
+
+// ------------------------------------------------------------------------
+
+MarchView MarchView::Make(const Frame& frame, float extent, uint32_t resolution, glm::vec3 direction)
+{
+	MarchView view;
+	view.Width = resolution;
+	view.Height = resolution;
+	view.CameraPosition = direction * 2.5f * extent;
+
+	const glm::mat4 projection = glm::scale(glm::perspective(glm::radians(45.0f), 1.0f, 0.01f, 100.0f * extent), { 1, -1, 1 });
+	const glm::mat4 viewMatrix = glm::lookAt(view.CameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 projectionView = projection * viewMatrix;
+	view.InvProjectionView = glm::inverse(projectionView);
+
+	const uint32_t numPixels = view.Width * view.Height;
+	view.Depth.assign(numPixels, 1.0f);
+	view.NumActive = 0;
+
+	for (uint32_t i = 0; i < numPixels; i++)
+	{
+		const glm::vec2 clip(float(i % view.Width) * 2.0f / float(view.Width) - 1.0f,
+							 float(i / view.Width) * 2.0f / float(view.Height) - 1.0f);
+
+		const glm::vec4 nearH = view.InvProjectionView * glm::vec4(clip, 0.0f, 1.0f);
+		const glm::vec4 farH = view.InvProjectionView * glm::vec4(clip, 1.0f, 1.0f);
+		const glm::vec3 origin = glm::vec3(nearH) / nearH.w;
+		const glm::vec3 ray = glm::vec3(farH) / farH.w - origin;
+
+		const glm::vec3 t0 = (frame.m_Min - origin) / ray;
+		const glm::vec3 t1 = (frame.m_Max - origin) / ray;
+		const glm::vec3 tMin = glm::min(t0, t1);
+		const glm::vec3 tMax = glm::max(t0, t1);
+		const float tNear = std::max(std::max(tMin.x, tMin.y), tMin.z);
+		const float tFar = std::min(std::min(tMax.x, tMax.y), tMax.z);
+
+		if (tNear > tFar || tFar < 0.0f)
+			continue;
+
+		const glm::vec4 entry = projectionView * glm::vec4(origin + std::max(tNear, 0.0f) * ray, 1.0f);
+		view.Depth[i] = std::min(entry.z / entry.w, std::nextafter(1.0f, 0.0f));
+		view.NumActive++;
+	}
+
+	return view;
+}
+
+// ------------------------------------------------------------------------
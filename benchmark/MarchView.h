@@ -0,0 +1,25 @@
+#pragma once
+
+class Frame;
+
+// Camera and depth input of a ray march without a GPU.
+struct MarchView
+{
+	uint32_t Width;
+	uint32_t Height;
+
+	glm::vec3 CameraPosition;
+	glm::mat4 InvProjectionView;
+
+	// The depth pass is replaced by the front faces of the bounding box of
+	// the frame, a conservative start like the particle splats.
+	std::vector<float> Depth;
+	uint32_t NumActive; // pixels with a depth below 1
+
+	// Looks at the center of a cube of the given extent from direction,
+	// scaled to the distance of the default camera.
+	static MarchView Make(const Frame& frame,
+						  float extent,
+						  uint32_t resolution,
+						  glm::vec3 direction = glm::vec3(1.0f, 0.8f, -1.2f));
+};
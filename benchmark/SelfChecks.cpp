@@ -0,0 +1,185 @@
+#include <engine/hzpch.h>
+
+#include "SelfChecks.h"
+
+#include "app/Kernel.h"
+#include "app/SymmetricEigenSolver.h"
+
+#include <random>
+
+// ------------------------------------------------------------------------
+
+namespace
+{
+	constexpr float KernelSupport = 0.2f;
+	constexpr uint32_t NumKernelSets = 2000;
+	constexpr uint32_t MaxKernelNeighbors = 70; // covers full vectors and tails
+
+	// relative to the sum of the magnitudes of the summands
+	constexpr float MaxKernelError = 1e-4f;
+
+	constexpr uint32_t NumEigenSamples = 10000;
+	constexpr float MaxEigenError = 1e-3f; // relative to the largest coefficient
+
+	struct KernelSet
+	{
+		std::vector<float> X, Y, Z;
+	};
+}
+
+// ------------------------------------------------------------------------
+
+static std::vector<KernelSet> MakeKernelSets()
+{
+	std::mt19937 engine(1);
+	std::uniform_real_distribution<float> position(-1.2f * KernelSupport, 1.2f * KernelSupport);
+	std::uniform_int_distribution<uint32_t> count(0, MaxKernelNeighbors);
+
+	std::vector<KernelSet> sets(NumKernelSets);
+
+	for (KernelSet& set : sets)
+	{
+		const uint32_t n = count(engine);
+
+		for (uint32_t j = 0; j < n; j++)
+		{
+			set.X.push_back(position(engine));
+			set.Y.push_back(position(engine));
+			set.Z.push_back(position(engine));
+		}
+	}
+
+	return sets;
+}
+
+bool CheckKernelSimd()
+{
+	CubicSplineKernel isotropic(KernelSupport);
+	AnisotropicKernel anisotropic(KernelSupport);
+
+	// a stretched kernel, as computed by WPCA for a surface particle
+	const glm::mat3 G = glm::mat3(glm::vec3(1.4f, 0.0f, 0.0f),
+								  glm::vec3(0.0f, 1.0f, 0.1f),
+								  glm::vec3(0.0f, 0.1f, 0.7f));
+	const float detG = glm::determinant(G);
+
+	const std::vector<KernelSet> sets = MakeKernelSets();
+
+	const KernelSimdLevel previous = GetKernelSimdLevel();
+	bool passed = true;
+
+	for (int level = 0; level <= int(GetMaxKernelSimdLevel()); level++)
+	{
+		SetKernelSimdLevel(KernelSimdLevel(level));
+
+		float maxError[2] = {}; // density, gradient
+
+		for (const KernelSet& set : sets)
+		{
+			const uint32_t n = uint32_t(set.X.size());
+
+			for (bool stretched : { false, true })
+			{
+				float density = 0.0f, densityScale = 0.0f;
+				glm::vec3 gradient(0.0f);
+				float gradientScale = 0.0f;
+
+				for (uint32_t j = 0; j < n; j++)
+				{
+					const glm::vec3 r(set.X[j], set.Y[j], set.Z[j]);
+
+					const float w = stretched ? anisotropic.W(G, detG, r) : isotropic.W(r);
+					const glm::vec3 g = stretched ? anisotropic.gradW(G, detG, r) : isotropic.gradW(r);
+
+					density += w;
+					densityScale += std::abs(w);
+					gradient += g;
+					gradientScale += glm::length(g);
+				}
+
+				const float batchDensity = stretched ?
+					anisotropic.W(G, detG, set.X.data(), set.Y.data(), set.Z.data(), n) :
+					isotropic.W(set.X.data(), set.Y.data(), set.Z.data(), n);
+
+				const glm::vec3 batchGradient = stretched ?
+					anisotropic.gradW(G, detG, set.X.data(), set.Y.data(), set.Z.data(), n) :
+					isotropic.gradW(set.X.data(), set.Y.data(), set.Z.data(), n);
+
+				glm::vec3 fusedGradient;
+				const float fusedDensity = stretched ?
+					anisotropic.WgradW(G, detG, set.X.data(), set.Y.data(), set.Z.data(), n, fusedGradient) :
+					isotropic.WgradW(set.X.data(), set.Y.data(), set.Z.data(), n, fusedGradient);
+
+				if (densityScale > 0.0f)
+				{
+					maxError[0] = std::max(maxError[0], std::abs(batchDensity - density) / densityScale);
+					maxError[0] = std::max(maxError[0], std::abs(fusedDensity - density) / densityScale);
+				}
+
+				if (gradientScale > 0.0f)
+				{
+					maxError[1] = std::max(maxError[1], glm::length(batchGradient - gradient) / gradientScale);
+					maxError[1] = std::max(maxError[1], glm::length(fusedGradient - gradient) / gradientScale);
+				}
+			}
+		}
+
+		const bool levelPassed = maxError[0] <= MaxKernelError && maxError[1] <= MaxKernelError;
+		passed = passed && levelPassed;
+
+		if (levelPassed)
+			SPDLOG_INFO("Kernel batch {:<8} density {:.2e}, gradient {:.2e}  passed",
+						KernelSimdLevelToString(KernelSimdLevel(level)), maxError[0], maxError[1]);
+		else
+			SPDLOG_ERROR("Kernel batch {:<8} density {:.2e}, gradient {:.2e}  deviates from the per-neighbor kernels!",
+						 KernelSimdLevelToString(KernelSimdLevel(level)), maxError[0], maxError[1]);
+	}
+
+	SetKernelSimdLevel(previous);
+
+	return passed;
+}
+
+bool CheckSymmetricEigenSolver()
+{
+	// the batched solver follows the instruction set of the kernels
+	const KernelSimdLevel previous = GetKernelSimdLevel();
+	SymmetricEigenSolverErrors errors = {};
+
+	for (int level = 0; level <= int(GetMaxKernelSimdLevel()); level++)
+	{
+		SetKernelSimdLevel(KernelSimdLevel(level));
+
+		const SymmetricEigenSolverErrors levelErrors = ValidateSymmetricEigenSolver(NumEigenSamples, true);
+		errors.Eigenvalues = std::max(errors.Eigenvalues, levelErrors.Eigenvalues);
+		errors.Reconstruction = std::max(errors.Reconstruction, levelErrors.Reconstruction);
+		errors.Orthonormality = std::max(errors.Orthonormality, levelErrors.Orthonormality);
+	}
+
+	SetKernelSimdLevel(previous);
+
+	bool passed = true;
+
+	// WPCA clamps the eigenvalues and relies on R being a rotation for det(G)
+	if (errors.Eigenvalues > MaxEigenError)
+	{
+		SPDLOG_ERROR("Symmetric eigen solver eigenvalues deviate from Eigen by {}!", errors.Eigenvalues);
+		passed = false;
+	}
+
+	if (errors.Reconstruction > MaxEigenError)
+	{
+		SPDLOG_ERROR("Symmetric eigen solver reconstruction deviates by {}!", errors.Reconstruction);
+		passed = false;
+	}
+
+	if (errors.Orthonormality > MaxEigenError)
+	{
+		SPDLOG_ERROR("Symmetric eigen solver eigenvectors are not orthonormal, deviation {}!", errors.Orthonormality);
+		passed = false;
+	}
+
+	return passed;
+}
+
+// ------------------------------------------------------------------------
@@ -0,0 +1,15 @@
+#pragma once
+
+/*
+* Checks of the optimized code paths against their plain counterparts, run
+* before the goldens by 'benchmark --golden check'. Each logs its largest
+* deviation and returns false if it is above the tolerance.
+*/
+
+// The batch kernel evaluations of every supported instruction set against
+// the per-neighbor kernels, for density, gradient and both fused.
+bool CheckKernelSimd();
+
+// The closed-form solvers used by WPCA against Eigen: eigenvalues,
+// reconstruction and orthonormality of the eigenvectors, single and batched.
+bool CheckSymmetricEigenSolver();
@@ -0,0 +1,689 @@
+#include <engine/hzpch.h>
+
+#include <engine/utils/HardwareCounters.h>
+#include <engine/utils/Profiler.h>
+#include <engine/utils/Utils.h>
+
+#include "app/Dataset.h"
+#include "app/Kernel.h"
+#include "app/AdvancedRenderer/RayMarcher.h"
+
+#include "GoldenImages.h"
+#include "MarchView.h"
+#include "SelfChecks.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
+/*
+* Microbenchmarks of the CPU side of the renderer on synthetic cubes of
+* particles. Needs neither a window nor a GPU.
+*
+*   benchmark [--sizes 10000,100000,1000000,10000000] [--repetitions 5]
+*             [--resolution 256] [--threads <n>] [--label <commit>]
+*             [--counters 1] [--out benchmark.json]
+*   benchmark --golden check|update [--golden-dir assets/goldens]
+*             [--budget-tolerance 25] [--repetitions 5] [--threads <n>]
+*
+* --threads sets the workers of the ray marcher, by default all but one
+* hardware thread. The thread scaling of the march is measured up to it.
+*
+* On Linux, the marches also record the hardware counters of the workers per
+* pixel, if the kernel allows it. --counters 0 turns them off.
+*
+* --golden runs the regression check of GoldenImages.h instead and exits
+* with 1 if a scene failed. check runs the checks of SelfChecks.h first.
+*
+* Every measurement is repeated, its median and minimum are written as one
+* record to a JSON file, so that the results of different commits can be
+* compared by a script.
+*/
+
+// ------------------------------------------------------------------------
+
+struct Options
+{
+	std::vector<size_t> Sizes = { 10000, 100000, 1000000, 10000000 };
+	uint32_t Repetitions = 5;
+	uint32_t Resolution = 256;
+	uint32_t Threads = 0; // of the ray marcher, 0 for the default
+	bool Counters = true;
+	std::string Golden; // check or update, empty for the benchmarks
+	std::string GoldenDirectory = "assets/goldens";
+	float BudgetTolerance = 25.0f; // in percent
+	std::string Label;
+	std::string Output = "benchmark.json";
+};
+
+struct Result
+{
+	std::string Benchmark;
+	size_t Particles;
+	std::string Unit;
+	double Median;
+	double Min;
+};
+
+// The scenes have the particle density of the datasets, about 30 neighbors
+// within the particle radius.
+constexpr float ParticleRadius = 0.1f;
+constexpr float ParticleRadiusMultiplier = 2.0f;
+constexpr float ParticleSpacing = 0.5f * ParticleRadius;
+
+constexpr uint32_t NumSamples = 2000; // particles or positions per measurement
+constexpr uint32_t MaxNeighbors = 8192; // of the ray marcher
+
+using Clock = std::chrono::high_resolution_clock;
+
+static std::vector<Result> s_Results;
+static uint32_t s_MarchThreads = 0;
+
+// keeps the measured work from being optimized away
+static volatile float s_Sink = 0.0f;
+
+// ------------------------------------------------------------------------
+
+static double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void AddResult(const std::string& benchmark, size_t particles, const char* unit, std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+
+	const Result result = { benchmark, particles, unit, values[values.size() / 2], values.front() };
+	s_Results.push_back(result);
+
+	SPDLOG_INFO("{:>9} particles  {:<28} {:>14.3f} {}", particles, benchmark, result.Median, unit);
+}
+
+// Runs f repetitions times, f returns the value of one run in unit.
+template <typename F>
+static void Measure(const Options& options, const char* benchmark, size_t particles, const char* unit, F&& f)
+{
+	std::vector<double> values(options.Repetitions);
+
+	for (double& value : values)
+		value = f();
+
+	AddResult(benchmark, particles, unit, std::move(values));
+}
+
+// Records the counters of the ray marcher workers since the last reset, per
+// item of work. All repetitions count, so median and min are the same.
+static void AddCounterResults(const char* benchmark, size_t particles, uint64_t numItems)
+{
+	if (!HardwareCounters::IsEnabled())
+		return;
+
+	const Profiler::CounterTotals totals = Profiler::GetCounterTotals("ThreadPool job");
+
+	if (totals.Calls == 0)
+		return;
+
+	for (uint32_t i = 0; i < HardwareCounters::NumCounters; i++)
+	{
+		const auto counter = HardwareCounters::Counter(i);
+
+		if (!HardwareCounters::IsAvailable(counter))
+			continue;
+
+		const std::string name = fmt::format("{}_{}", benchmark, HardwareCounters::GetName(counter));
+		const std::string unit = fmt::format("{}/pixel", HardwareCounters::GetName(counter));
+		const double value = double(totals.Sum[i]) / double(numItems);
+
+		s_Results.push_back({ name, particles, unit, value, value });
+		SPDLOG_INFO("{:>9} particles  {:<28} {:>14.3f} {}", particles, name, value, unit);
+	}
+}
+
+// Bytes per component of the cube, after the frame was built, and the
+// high-water mark of the process so far.
+static void AddMemoryResults(const Dataset& dataset, size_t particles)
+{
+	constexpr double MB = 1024.0 * 1024.0;
+
+	const FrameMemory memory = dataset.GetMemoryUsage().Total;
+
+	const std::pair<const char*, size_t> components[] = {
+		{ "memory_particles", memory.Particles },
+		{ "memory_particles_ext", memory.ParticlesExt },
+		{ "memory_search", memory.Search },
+		{ "memory_search_ext", memory.SearchExt },
+		{ "memory_density_grid", memory.DensityGrid },
+		{ "memory_frame", memory.GetTotal() },
+		{ "memory_peak_process", Utils::GetPeakProcessMemory() },
+	};
+
+	for (const auto& [name, bytes] : components)
+	{
+		const double value = double(bytes) / MB;
+
+		s_Results.push_back({ name, particles, "MB", value, value });
+		SPDLOG_INFO("{:>9} particles  {:<28} {:>14.3f} MB", particles, name, value);
+	}
+}
+
+// Relative positions of the neighbors of some particles, in SoA layout.
+struct NeighborSets
+{
+	std::vector<uint32_t> Offsets; // NumSamples + 1
+	std::vector<float> X, Y, Z;
+
+	uint32_t GetCount(uint32_t i) const { return Offsets[i + 1] - Offsets[i]; }
+	size_t GetTotal() const { return X.size(); }
+};
+
+static NeighborSets GatherNeighbors(Dataset& dataset, const std::vector<glm::vec3>& positions, bool extended)
+{
+	const Frame& frame = dataset.Frames[0];
+	const std::vector<Particle>& particles = extended ? frame.m_ParticlesExt : frame.m_Particles;
+
+	NeighborSets sets;
+	sets.Offsets.push_back(0);
+
+	for (const glm::vec3& p : positions)
+	{
+		std::vector<uint32_t> neighbors = extended ?
+			dataset.GetNeighborsExt(p, 0) :
+			dataset.GetNeighbors(p, 0);
+
+		if (neighbors.size() > MaxNeighbors)
+			neighbors.resize(MaxNeighbors);
+
+		for (uint32_t j : neighbors)
+		{
+			const glm::vec3 r = p - particles[j];
+			sets.X.push_back(r.x);
+			sets.Y.push_back(r.y);
+			sets.Z.push_back(r.z);
+		}
+
+		sets.Offsets.push_back(uint32_t(sets.X.size()));
+	}
+
+	return sets;
+}
+
+static std::vector<glm::vec3> RandomPositions(float extent, uint32_t count, uint32_t seed)
+{
+	std::mt19937 engine(seed);
+	std::uniform_real_distribution<float> distribution(-extent, extent);
+
+	std::vector<glm::vec3> positions(count);
+	for (glm::vec3& p : positions)
+		p = { distribution(engine), distribution(engine), distribution(engine) };
+
+	return positions;
+}
+
+// ------------------------------------------------------------------------
+
+static void BenchmarkBuild(const Options& options, Dataset& dataset, size_t numParticles)
+{
+	Frame& frame = dataset.Frames[0];
+
+	// search, bounding box and density grid
+	Measure(options, "frame_build", numParticles, "ms", [&]() {
+		const auto start = Clock::now();
+		Frame built(&dataset, frame.m_Particles, dataset.ParticleRadius, dataset.ParticleRadiusExt);
+		return 1e3 * Seconds(start);
+	});
+
+	// rebuilding the grid replaces all cells, the search can not be rebuilt
+	Measure(options, "build_density_grid", numParticles, "ms", [&]() {
+		const auto start = Clock::now();
+		frame.BuildDensityGrid(1);
+		return 1e3 * Seconds(start);
+	});
+}
+
+static void BenchmarkNeighbors(const Options& options, Dataset& dataset, size_t numParticles, float extent)
+{
+	const std::vector<glm::vec3> positions = RandomPositions(extent, NumSamples, 1);
+
+	Measure(options, "get_neighbors", numParticles, "queries/s", [&]() {
+		size_t sum = 0;
+		const auto start = Clock::now();
+
+		for (const glm::vec3& p : positions)
+			sum += dataset.GetNeighbors(p, 0).size();
+
+		const double seconds = Seconds(start);
+		s_Sink = float(sum);
+		return double(positions.size()) / seconds;
+	});
+
+	Measure(options, "get_neighbors_ext", numParticles, "queries/s", [&]() {
+		size_t sum = 0;
+		const auto start = Clock::now();
+
+		for (const glm::vec3& p : positions)
+			sum += dataset.GetNeighborsExt(p, 0).size();
+
+		const double seconds = Seconds(start);
+		s_Sink = float(sum);
+		return double(positions.size()) / seconds;
+	});
+}
+
+static void BenchmarkKernels(const Options& options, Dataset& dataset, size_t numParticles, float extent)
+{
+	const NeighborSets sets = GatherNeighbors(dataset, RandomPositions(extent, NumSamples, 2), false);
+
+	if (sets.GetTotal() == 0)
+		return;
+
+	CubicSplineKernel& isotropic = dataset.m_IsotropicKernel;
+	AnisotropicKernel& anisotropic = dataset.m_AnisotropicKernel;
+
+	// a stretched kernel, as computed by WPCA for a surface particle
+	const glm::mat3 G = glm::mat3(glm::vec3(1.4f, 0.0f, 0.0f),
+								  glm::vec3(0.0f, 1.0f, 0.1f),
+								  glm::vec3(0.0f, 0.1f, 0.7f));
+	const float detG = glm::determinant(G);
+
+	// Evaluations per second over all neighbor sets, f sums one set.
+	auto measureEvaluations = [&](const char* benchmark, auto&& f) {
+		Measure(options, benchmark, numParticles, "evals/s", [&]() {
+			float sum = 0.0f;
+			const auto start = Clock::now();
+
+			for (uint32_t i = 0; i < NumSamples; i++)
+			{
+				const uint32_t offset = sets.Offsets[i];
+				sum += f(sets.X.data() + offset, sets.Y.data() + offset, sets.Z.data() + offset, sets.GetCount(i));
+			}
+
+			const double seconds = Seconds(start);
+			s_Sink = sum;
+			return double(sets.GetTotal()) / seconds;
+		});
+	};
+
+	measureEvaluations("cubic_spline_scalar", [&](const float* x, const float* y, const float* z, uint32_t n) {
+		float sum = 0.0f;
+		for (uint32_t j = 0; j < n; j++)
+			sum += isotropic.W(glm::vec3(x[j], y[j], z[j]));
+		return sum;
+	});
+
+	measureEvaluations("cubic_spline_batch", [&](const float* x, const float* y, const float* z, uint32_t n) {
+		return isotropic.W(x, y, z, n);
+	});
+
+	measureEvaluations("anisotropic_scalar", [&](const float* x, const float* y, const float* z, uint32_t n) {
+		float sum = 0.0f;
+		for (uint32_t j = 0; j < n; j++)
+			sum += anisotropic.W(G, detG, glm::vec3(x[j], y[j], z[j]));
+		return sum;
+	});
+
+	measureEvaluations("anisotropic_batch", [&](const float* x, const float* y, const float* z, uint32_t n) {
+		return anisotropic.W(G, detG, x, y, z, n);
+	});
+}
+
+static void BenchmarkWPCA(const Options& options, Dataset& dataset, RayMarcher& marcher, size_t numParticles, float extent)
+{
+	const NeighborSets sets = GatherNeighbors(dataset, RandomPositions(extent, NumSamples, 3), true);
+
+	Measure(options, "wpca", numParticles, "ns/call", [&]() {
+		glm::mat3 G;
+		float detG;
+		float sum = 0.0f;
+		uint32_t numCalls = 0;
+
+		const auto start = Clock::now();
+
+		for (uint32_t i = 0; i < NumSamples; i++)
+		{
+			// WPCA needs at least one neighbor
+			if (sets.GetCount(i) == 0)
+				continue;
+
+			const uint32_t offset = sets.Offsets[i];
+			marcher.WPCA(sets.X.data() + offset, sets.Y.data() + offset, sets.Z.data() + offset, sets.GetCount(i), G, detG);
+
+			sum += detG;
+			numCalls++;
+		}
+
+		const double seconds = Seconds(start);
+		s_Sink = sum;
+		return 1e9 * seconds / double(std::max(numCalls, 1u));
+	});
+}
+
+static void BenchmarkMarch(const Options& options, Dataset& dataset, RayMarcher& marcher, size_t numParticles, float extent)
+{
+	// looking at a corner of the cube, like the default camera
+	MarchView view = MarchView::Make(dataset.Frames[0], extent, options.Resolution);
+
+	const uint32_t numPixels = view.Width * view.Height;
+	const uint32_t numActive = view.NumActive;
+
+	std::vector<float> hitDistances(numPixels);
+	std::vector<uint32_t> normals(numPixels);
+
+	struct Variant
+	{
+		const char* Name;
+		bool Anisotropic;
+		bool Approximate;
+	};
+
+	const Variant variants[] = {
+		{ "march_isotropic", false, false },
+		{ "march_anisotropic", true, false },
+		{ "march_anisotropic_approx", true, true },
+	};
+
+	for (const Variant& variant : variants)
+	{
+		VisualizationSettings settings = {
+			.Frame = 0,
+			.MaxSteps = 128,
+			.StepSize = 0.09f * ParticleRadius,
+			.IsoDensity = 1.0f,
+			.EnableGridSkipping = true,
+			.EnableAnisotropy = variant.Anisotropic,
+			.ApproximateAnisotropy = variant.Approximate,
+			.k_n = 0.5f,
+			.k_r = 2.0f,
+			.k_s = 2000.0f,
+			.N_eps = 1,
+		};
+
+		Profiler::ResetCounterTotals();
+
+		Measure(options, variant.Name, numParticles, "ns/pixel", [&]() {
+			marcher.Prepare(settings, view.CameraPosition, view.InvProjectionView, view.Width, view.Height,
+							&dataset, hitDistances.data(), normals.data(), view.Depth.data());
+
+			// the memoized anisotropy would make all but the first run cheap
+			marcher.ResetAnisotropyCache();
+
+			const auto start = Clock::now();
+
+			marcher.Start();
+			while (!marcher.IsDone())
+				std::this_thread::yield();
+
+			const double seconds = Seconds(start);
+
+			// the workers' scopes would fill their buffers otherwise
+			Profiler::Collect();
+
+			return 1e9 * seconds / double(std::max(numActive, 1u));
+		});
+
+		AddCounterResults(variant.Name, numParticles, options.Repetitions * std::max(numActive, 1u));
+	}
+
+	// thread scaling of the exact anisotropic march, one record per thread count
+	VisualizationSettings settings = {
+		.Frame = 0,
+		.MaxSteps = 128,
+		.StepSize = 0.09f * ParticleRadius,
+		.IsoDensity = 1.0f,
+		.EnableGridSkipping = true,
+		.EnableAnisotropy = true,
+		.ApproximateAnisotropy = false,
+		.k_n = 0.5f,
+		.k_r = 2.0f,
+		.k_s = 2000.0f,
+		.N_eps = 1,
+	};
+
+	marcher.Prepare(settings, view.CameraPosition, view.InvProjectionView, view.Width, view.Height,
+					&dataset, hitDistances.data(), normals.data(), view.Depth.data());
+
+	std::map<uint32_t, std::vector<double>> times, efficiencies;
+
+	for (uint32_t i = 0; i < options.Repetitions; i++)
+	{
+		for (const RayMarcher::ScalingResult& result : marcher.MeasureScaling())
+		{
+			times[result.NumThreads].push_back(result.Time);
+			efficiencies[result.NumThreads].push_back(100.0 * result.Efficiency);
+		}
+
+		Profiler::Collect();
+	}
+
+	for (auto& [numThreads, values] : times)
+		AddResult(fmt::format("march_threads_{}", numThreads), numParticles, "ms", std::move(values));
+
+	for (auto& [numThreads, values] : efficiencies)
+		AddResult(fmt::format("march_efficiency_threads_{}", numThreads), numParticles, "%", std::move(values));
+}
+
+// ------------------------------------------------------------------------
+
+static void PrintUsage()
+{
+	fmt::print(stderr,
+		"usage: benchmark [--sizes 10000,100000,1000000,10000000] [--repetitions 5]\n"
+		"                 [--resolution 256] [--threads <n>] [--label <commit>]\n"
+		"                 [--counters 1] [--out benchmark.json]\n"
+		"       benchmark --golden check|update [--golden-dir assets/goldens]\n"
+		"                 [--budget-tolerance 25] [--repetitions 5] [--threads <n>]\n");
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (!value)
+		{
+			SPDLOG_ERROR("Missing value for '{}'!", arg);
+			return false;
+		}
+
+		try
+		{
+			if (arg == "--sizes")
+			{
+				options.Sizes.clear();
+
+				std::stringstream s(value);
+				std::string size;
+				while (std::getline(s, size, ','))
+					options.Sizes.push_back(std::stoull(size));
+			}
+			else if (arg == "--repetitions")
+				options.Repetitions = std::max(1, std::stoi(value));
+			else if (arg == "--resolution")
+				options.Resolution = std::max(1, std::stoi(value));
+			else if (arg == "--threads")
+				options.Threads = std::max(0, std::stoi(value));
+			else if (arg == "--counters")
+				options.Counters = std::stoi(value) != 0;
+			else if (arg == "--golden")
+			{
+				options.Golden = value;
+
+				if (options.Golden != "check" && options.Golden != "update")
+				{
+					SPDLOG_ERROR("--golden is either 'check' or 'update'!");
+					return false;
+				}
+			}
+			else if (arg == "--golden-dir")
+				options.GoldenDirectory = value;
+			else if (arg == "--budget-tolerance")
+				options.BudgetTolerance = std::max(0.0f, std::stof(value));
+			else if (arg == "--label")
+				options.Label = value;
+			else if (arg == "--out")
+				options.Output = value;
+			else
+			{
+				SPDLOG_ERROR("Unknown option '{}'!", arg);
+				return false;
+			}
+		}
+		catch (const std::exception&)
+		{
+			SPDLOG_ERROR("Invalid value '{}' for '{}'!", value, arg);
+			return false;
+		}
+
+		i++;
+	}
+
+	return true;
+}
+
+static const char* GetConfiguration()
+{
+#if DEBUG
+	return "Debug";
+#elif RELEASE
+	return "Release";
+#elif PRODUCTION
+	return "Production";
+#else
+	return "Unknown";
+#endif
+}
+
+static std::string EscapeJSON(const std::string& s)
+{
+	std::string r;
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			r += '\\';
+		r += c;
+	}
+	return r;
+}
+
+static bool WriteResults(const Options& options)
+{
+	std::ofstream file(options.Output, std::ios::trunc);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Could not write results to '{}'!", options.Output);
+		return false;
+	}
+
+	file << "{\n"
+		 << "\t\"label\": \"" << EscapeJSON(options.Label) << "\",\n"
+		 << "\t\"configuration\": \"" << GetConfiguration() << "\",\n"
+		 << "\t\"threads\": " << std::thread::hardware_concurrency() << ",\n"
+		 << "\t\"march_threads\": " << s_MarchThreads << ",\n"
+		 << "\t\"hardware_counters\": " << (HardwareCounters::GetAvailable() ? "true" : "false") << ",\n"
+		 << "\t\"kernel_simd\": \"" << KernelSimdLevelToString(GetKernelSimdLevel()) << "\",\n"
+		 << "\t\"repetitions\": " << options.Repetitions << ",\n"
+		 << "\t\"resolution\": " << options.Resolution << ",\n"
+		 << "\t\"results\": [";
+
+	file << std::setprecision(9);
+
+	const char* separator = "\n";
+
+	for (const Result& result : s_Results)
+	{
+		file << separator
+			 << "\t\t{ \"benchmark\": \"" << result.Benchmark
+			 << "\", \"particles\": " << result.Particles
+			 << ", \"unit\": \"" << result.Unit
+			 << "\", \"median\": " << result.Median
+			 << ", \"min\": " << result.Min << " }";
+
+		separator = ",\n";
+	}
+
+	file << "\n\t]\n}\n";
+
+	SPDLOG_INFO("Wrote {} results to '{}'.", s_Results.size(), options.Output);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	Profiler::SetThreadName("Main");
+
+	RayMarcher marcher(options.Threads);
+	s_MarchThreads = marcher.GetNumThreads();
+
+	if (!options.Golden.empty())
+	{
+		const GoldenOptions golden = {
+			.Directory = options.GoldenDirectory,
+			.Update = options.Golden == "update",
+			.Repetitions = options.Repetitions,
+			.BudgetTolerance = options.BudgetTolerance,
+		};
+
+		bool passed = true;
+
+		if (!golden.Update)
+		{
+			passed = CheckKernelSimd() && passed;
+			passed = CheckSymmetricEigenSolver() && passed;
+		}
+
+		passed = RunGoldenImages(golden, marcher) && passed;
+		marcher.Exit();
+
+		return passed ? 0 : 1;
+	}
+
+	// only the marches record them, to keep the system calls out of the other benchmarks
+	const bool counters = options.Counters && HardwareCounters::IsSupported();
+
+	for (size_t numParticles : options.Sizes)
+	{
+		// particles fill [-extent, extent]^3 at the spacing of the datasets
+		const float extent = 0.5f * std::cbrt(float(numParticles)) * ParticleSpacing;
+
+		Dataset dataset;
+
+		{
+			const auto start = Clock::now();
+			Dataset::makeCube(dataset, extent, numParticles, ParticleRadius, ParticleRadiusMultiplier, 1);
+
+			const double ms = 1e3 * Seconds(start);
+			s_Results.push_back({ "make_cube", numParticles, "ms", ms, ms });
+			SPDLOG_INFO("{:>9} particles  {:<28} {:>14.3f} ms", numParticles, "make_cube", ms);
+		}
+
+		AddMemoryResults(dataset, numParticles);
+
+		BenchmarkBuild(options, dataset, numParticles);
+		BenchmarkNeighbors(options, dataset, numParticles, extent);
+		BenchmarkKernels(options, dataset, numParticles, extent);
+		HardwareCounters::SetEnabled(counters);
+		BenchmarkMarch(options, dataset, marcher, numParticles, extent);
+		HardwareCounters::SetEnabled(false);
+
+		// after a march, which prepared the marcher for this dataset
+		BenchmarkWPCA(options, dataset, marcher, numParticles, extent);
+	}
+
+	marcher.Exit();
+
+	return WriteResults(options) ? 0 : 1;
+}
@@ -16,6 +16,17 @@ for k, v in pairs(VULKAN_LIBS) do
 	VULKAN_LIBS_DEBUG[k] = "%{VULKAN_SDK}/Lib/" .. v .. "d"
 end
 
+-- Production loads the SPIR-V next to every shader instead of compiling at
+-- runtime, so it is compiled before every build.
+SHADER_COMMANDS = {}
+
+for _, extension in ipairs({ "vert", "frag", "comp", "geom" }) do
+	for _, source in ipairs(os.matchfiles("assets/shaders/**." .. extension)) do
+		local spv = path.join(path.getdirectory(source), "compiled_" .. path.getname(source) .. ".spv")
+		table.insert(SHADER_COMMANDS, '"%{VULKAN_SDK}/Bin/glslc" "' .. source .. '" -o "' .. spv .. '"')
+	end
+end
+
 -- workspace
 workspace "fluids"
 	configurations { "Debug", "Release", "Production" }
@@ -111,3 +122,60 @@ project "fluids"
 
 	filter "configurations:Production"
 		links(VULKAN_LIBS_RELEASE)
+		prebuildcommands(SHADER_COMMANDS)
+
+	filter {}
+
+-- CPU microbenchmarks, runs without a window or GPU
+project "benchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++20"
+
+	includedirs {
+		"src",
+		"vendor",
+		"vendor/glm",
+		"vendor/yaml-cpp/include",
+		"vendor/spdlog/include",
+		"vendor/imgui",
+		"vendor/partio/src",
+		"vendor/CompactNSearch/include",
+		"vendor/eigen/include",
+		"%{VULKAN_SDK}/Include", -- headers only, through the precompiled header
+	}
+
+	files {
+		"benchmark/**",
+
+		"src/engine/hzpch.*",
+		"src/engine/assets/**",
+		"src/engine/utils/HardwareCounters.*",
+		"src/engine/utils/Log.*",
+		"src/engine/utils/PerformanceTimer.*",
+		"src/engine/utils/Profiler.*",
+		"src/engine/utils/Statistics.*",
+		"src/engine/utils/Utils.*",
+
+		"src/app/Dataset.*",
+		"src/app/Kernel.*",
+		"src/app/KernelBatch.cpp",
+		"src/app/Simd.h",
+		"src/app/StackArray.h",
+		"src/app/SymmetricEigenSolver.*",
+		"src/app/ThreadPool.*",
+		"src/app/Utils.*",
+		"src/app/AdvancedRenderer/AnisotropyCache.*",
+		"src/app/AdvancedRenderer/RayMarcher.*",
+	}
+
+	links {
+		"vendor/yaml-cpp/lib/%{cfg.buildcfg}/yaml-cpp",
+		"vendor/imgui/bin/%{cfg.buildcfg}/ImGui",
+
+		"partio",
+		"CompactNSearch",
+	}
+
+	pchheader "engine/hzpch.h"
+	pchsource "src/engine/hzpch.cpp"
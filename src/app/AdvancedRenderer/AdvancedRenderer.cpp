@@ -7,11 +7,15 @@
 #include <engine/events/Event.h>
 #include <engine/utils/PerformanceTimer.h>
 #include <engine/input/Input.h>
+#include <engine/utils/Statistics.h>
+#include <engine/utils/Utils.h>
+#include <engine/assets/AssetManager.h>
 
 #include "app/Kernel.h"
 #include "app/Utils.h"
 
 #include <fstream>
+#include <future>
 
 // ------------------------------------------------------------------------
 
@@ -20,7 +24,9 @@ VisualizationSettings g_VisualizationSettings = {
 	.StepSize = 0.009f,
 	.IsoDensity = 1.0f,
 
+	.EnableGridSkipping = true,
 	.EnableAnisotropy = true,
+	.ApproximateAnisotropy = false,
 	.k_n = 0.5f,
 	.k_r = 2.0f,
 	.k_s = 2000.0f,
@@ -28,6 +34,7 @@ VisualizationSettings g_VisualizationSettings = {
 };
 
 static float s_ProcessTimer = 0.0f;
+static std::chrono::steady_clock::time_point s_MarchStart;
 constexpr const float s_ProcessTimerMax = 1.0f;
 
 bool g_Autoplay = false;
@@ -35,6 +42,15 @@ bool g_Recording = false;
 
 std::atomic_bool RayMarchFinished = true;
 
+static bool s_CompareAnisotropy = false;
+static std::optional<RayMarcher::ImageDifference> s_AnisotropyDifference;
+
+static std::optional<uint32_t> s_NumMarchThreads; // applied before the next march
+static bool s_MeasureScaling = false;
+static std::vector<RayMarcher::ScalingResult> s_Scaling;
+
+static std::optional<MemoryUsage> s_MemoryUsage; // refreshed on demand
+
 bool s_EnableDepthPass = true;
 bool s_EnableRayMarch = true;
 bool s_EnableGaussPass = true;
@@ -42,6 +58,43 @@ bool s_EnableCoordinateSystem = true;
 bool s_EnableComposition = true;
 bool s_EnableShowDepth = false;
 
+// 0: composition, 1: depth, 2: blurred depth, 3: ray cost
+static int s_ShownImage = 0;
+
+enum CostMetric
+{
+	CostSteps,
+	CostSkipIterations,
+	CostNeighbors,
+	CostWPCACalls,
+	CostTime,
+	NumCostMetrics,
+};
+
+static const char* s_CostMetricNames[NumCostMetrics] = {
+	"Steps",
+	"Grid skips",
+	"Neighbors",
+	"WPCA calls",
+	"Time [us]",
+};
+
+static int s_CostMetric = CostSteps;
+
+static float GetCostMetric(const RayCost& cost, int metric)
+{
+	switch (metric)
+	{
+	case CostSteps:			 return float(cost.Steps);
+	case CostSkipIterations: return float(cost.SkipIterations);
+	case CostNeighbors:		 return float(cost.Neighbors);
+	case CostWPCACalls:		 return float(cost.WPCACalls);
+	case CostTime:			 return cost.Time;
+	}
+
+	return 0.0f;
+}
+
 // ------------------------------------------------------------------------
 
 decltype(AdvancedRenderer::Vertex::Attributes) AdvancedRenderer::Vertex::Attributes = {
@@ -61,6 +114,16 @@ decltype(AdvancedRenderer::Vertex::Binding) AdvancedRenderer::Vertex::Binding =
 	vk::VertexInputRate::eVertex, // VertexInputRate inputRate
 };
 
+decltype(AdvancedRenderer::ParticleInstance::Attributes) AdvancedRenderer::ParticleInstance::Attributes = {
+	vk::VertexInputAttributeDescription{ 0, 0, vk::Format::eR32G32B32Sfloat, 0 },
+};
+
+decltype(AdvancedRenderer::ParticleInstance::Binding) AdvancedRenderer::ParticleInstance::Binding = vk::VertexInputBindingDescription{
+	0, // uint32_t binding
+	sizeof(Particle), // uint32_t stride
+	vk::VertexInputRate::eInstance, // VertexInputRate inputRate
+};
+
 // ------------------------------------------------------------------------
 
 template <typename T>
@@ -71,6 +134,51 @@ void DumpDataToFile(const char* filename, const std::vector<T>& data)
 	file.close();
 }
 
+static void WriteScalingReport(const std::filesystem::path& path, const std::vector<RayMarcher::ScalingResult>& results)
+{
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Could not write scaling report to '{}'!", path.string());
+		return;
+	}
+
+	auto writeArray = [&](const auto& values) {
+		file << "[";
+		for (size_t i = 0; i < values.size(); i++)
+			file << (i ? ", " : "") << values[i];
+		file << "]";
+	};
+
+	file << "[";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const RayMarcher::ScalingResult& r = results[i];
+
+		file << (i ? ",\n" : "\n")
+			 << "\t{ \"threads\": " << r.NumThreads
+			 << ", \"time_ms\": " << r.Time
+			 << ", \"speedup\": " << r.Speedup
+			 << ", \"efficiency\": " << r.Efficiency
+			 << ",\n\t  \"busy_ms\": ";
+		writeArray(r.BusyTime);
+		file << ",\n\t  \"idle_ms\": ";
+		writeArray(r.IdleTime);
+		file << ",\n\t  \"chunks\": ";
+		writeArray(r.NumChunks);
+		file << " }";
+	}
+
+	file << "\n]\n";
+
+	SPDLOG_INFO("Wrote thread scaling of {} to {} threads to '{}'.",
+				results.front().NumThreads,
+				results.back().NumThreads,
+				path.string());
+}
+
 void DumpDataToFile(const char* filename, const void* data, size_t size)
 {
 	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
@@ -99,8 +207,17 @@ void AdvancedRenderer::Init(::Dataset* dataset)
 	SmoothedDepthBuffer.Init(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
 							 vk::Format::eR32Sfloat,
 							 vk::ImageAspectFlagBits::eColor);
-	PositionsBuffer.Init(BilateralBuffer::Color);
-	NormalsBuffer.Init(BilateralBuffer::Color);
+	HitDistanceBuffer.Init(vk::ImageUsageFlagBits::eSampled,
+						   vk::Format::eR32Sfloat,
+						   vk::ImageAspectFlagBits::eColor);
+	NormalsBuffer.Init(vk::ImageUsageFlagBits::eSampled,
+					   vk::Format::eR16G16Snorm,
+					   vk::ImageAspectFlagBits::eColor);
+	CostBuffer.Init(vk::ImageUsageFlagBits::eSampled,
+					vk::Format::eR32Sfloat,
+					vk::ImageAspectFlagBits::eColor);
+
+	BuildRenderGraph();
 
 	DepthRenderPass.Init();
 	CompositionRenderPass.Init();
@@ -111,7 +228,27 @@ void AdvancedRenderer::Init(::Dataset* dataset)
 	ShowImageRenderPass.Sampler = DepthBuffer.GPU.Sampler;
 	ShowImageRenderPass.Init();
 
-	VertexBuffer.Create(6 * Dataset->MaxParticles * sizeof(Vertex));
+	// pipelines only read the state created above, the driver compiles them concurrently
+	{
+		const auto start = PerformanceTimer::Clock::now();
+
+		std::array<std::future<void>, 5> pipelines = {
+			std::async(std::launch::async, [&]() { DepthRenderPass.CreatePipeline(); }),
+			std::async(std::launch::async, [&]() { CompositionRenderPass.CreatePipeline(); }),
+			std::async(std::launch::async, [&]() { GaussRenderPass.CreatePipeline(); }),
+			std::async(std::launch::async, [&]() { CoordinateSystemRenderPass.CreatePipeline(); }),
+			std::async(std::launch::async, [&]() { ShowImageRenderPass.CreatePipeline(); }),
+		};
+
+		for (auto& pipeline : pipelines)
+			pipeline.wait();
+
+		SPDLOG_INFO("Created pipelines in {}.", PerformanceTimer::Stringify(PerformanceTimer::Clock::now() - start));
+	}
+
+	// only bound for the fullscreen passes, their vertices are generated in the shader
+	VertexBuffer.Create(3 * sizeof(Vertex));
+	ParticleCache.Init(Dataset, ParticleCacheBudget, ParticleCachePrefetch);
 
 	// init camera
 	Camera = Camera3D(
@@ -126,10 +263,14 @@ void AdvancedRenderer::Init(::Dataset* dataset)
 
 void AdvancedRenderer::Exit()
 {
+	// frames in flight may still use the resources
+	Vulkan.Device.waitIdle();
+
 	m_RayMarcher.Exit();
 
 	delete Dataset;
 	VertexBuffer.Destroy();
+	ParticleCache.Exit();
 
 	CoordinateSystemRenderPass.Exit();
 	ShowImageRenderPass.Exit();
@@ -137,8 +278,11 @@ void AdvancedRenderer::Exit()
 	CompositionRenderPass.Exit();
 	DepthRenderPass.Exit();
 
+	Graph.Exit();
+
+	CostBuffer.Exit();
 	NormalsBuffer.Exit();
-	PositionsBuffer.Exit();
+	HitDistanceBuffer.Exit();
 	SmoothedDepthBuffer.Exit();
 	DepthBuffer.Exit();
 }
@@ -149,6 +293,9 @@ void AdvancedRenderer::Update(float time)
 		s_ProcessTimer += time;
 
 	CameraController.Update(time);
+
+	if (Benchmark.RecordingPath)
+		Benchmark.Path.Record(CameraController);
 }
 
 void AdvancedRenderer::HandleEvent(Event& e)
@@ -160,86 +307,52 @@ void AdvancedRenderer::Render()
 {
 	// - begin command buffer
 	// 
-	// - transition depth buffer
 	// - collect render data
-	// 
-	// - begin depth pass
-	// - render scene
-	// - end depth pass
-	// 
-	// - begin gauss pass
-	// - render gauss pass
-	// - end gauss pass
+	// - record the pre-marching passes of the render graph:
+	//   depth pass, gauss pass, depth buffer copy to CPU
 	// 
 	// - end command buffer
-	// - submit command buffer
+	// - submit command buffer and wait for its fence
 	// 
-	// - transition depth buffer
-	// - copy depth buffer to CPU
 	// - do ray marching and fill positions and normals buffer
-	// - (transition positions and normals buffer)
-	// - copy positions and normals buffer to GPU
-	// - (transition positions and normals buffer)
-	// - copy positions and normals buffer to GPU
 	// 
 	// - begin command buffer
 	// 
-	// - begin composition pass
-	// - render fullscreen quad
-	// - end composition pass
+	// - record the post-marching passes of the render graph:
+	//   positions and normals buffer copies to GPU, composition
 	// 
 	// - render ImGui pass
 	// 
 	// - end command buffer
 	// - submit command buffer
+	//
+	// The render graph records the barriers between the passes and skips
+	// the passes that are disabled or whose output is not used.
 
 	//   Done in Renderer:
 	// begin command buffer
 	
-	{
-		PROFILE_SCOPE("Pre-marching");
-
-		CollectRenderData();
+	Benchmark.OnFrame();
 
-		if (s_EnableDepthPass)
-		{
-			DepthBuffer.TransitionLayout(vk::ImageLayout::eDepthAttachmentOptimal,
-										 vk::AccessFlagBits::eDepthStencilAttachmentRead |
-										 vk::AccessFlagBits::eDepthStencilAttachmentWrite,
-										 vk::PipelineStageFlagBits::eEarlyFragmentTests |
-										 vk::PipelineStageFlagBits::eLateFragmentTests);
-
-			DepthRenderPass.Begin();
-			DrawDepthPass();
-			DepthRenderPass.End();
-		}
+	const bool startMarch = RayMarchFinished && s_ProcessTimer >= s_ProcessTimerMax;
 
-		if (s_EnableGaussPass)
-		{
-			DepthBuffer.TransitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal,
-										 vk::AccessFlagBits::eColorAttachmentRead,
-										 vk::PipelineStageFlagBits::eColorAttachmentOutput);
+	// The next keyframe of a benchmark, with its settings. Applied before the
+	// depth pass, so that the march starts from the depth of its own camera
+	// and dataset frame.
+	if (startMarch)
+		Benchmark.BeginMarch(CameraController, g_VisualizationSettings);
 
-			SmoothedDepthBuffer.TransitionLayout(vk::ImageLayout::eColorAttachmentOptimal,
-												 vk::AccessFlagBits::eColorAttachmentWrite,
-												 vk::PipelineStageFlagBits::eColorAttachmentOutput);
+	{
+		PROFILE_SCOPE("Pre-marching");
+		const auto preMarchingStart = std::chrono::steady_clock::now();
 
-			GaussRenderPass.Begin();
-			DrawFullscreenQuad();
-			GaussRenderPass.End();
+		{
+			GPU_PROFILE_SCOPE(Vulkan.CommandBuffer, "GPU Particle upload");
+			CollectRenderData();
 		}
 
-		DepthBuffer.TransitionLayout(vk::ImageLayout::eTransferSrcOptimal,
-									 vk::AccessFlagBits::eTransferRead,
-									 vk::PipelineStageFlagBits::eTransfer);
-
-		PositionsBuffer.TransitionLayout(vk::ImageLayout::eTransferDstOptimal,
-										 vk::AccessFlagBits::eTransferWrite,
-										 vk::PipelineStageFlagBits::eTransfer);
-
-		NormalsBuffer.TransitionLayout(vk::ImageLayout::eTransferDstOptimal,
-									   vk::AccessFlagBits::eTransferWrite,
-									   vk::PipelineStageFlagBits::eTransfer);
+		Graph.BeginFrame();
+		Graph.Execute(Vulkan.CommandBuffer, PreMarching);
 
 		Vulkan.CommandBuffer.end();
 
@@ -250,25 +363,35 @@ void AdvancedRenderer::Render()
 			Vulkan.WaitForRenderingFinished();
 		}
 
-		if (RayMarchFinished)
-			DepthBuffer.CopyFromGPU();
+		GlobalStatistics.Sample("Pre-marching [ms]",
+								std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - preMarchingStart).count());
 	}
 
-	if (RayMarchFinished && s_ProcessTimer >= s_ProcessTimerMax)
+	if (startMarch)
 	{
 		RayMarchFinished = false;
 
-		m_Positions = reinterpret_cast<glm::vec4*>(PositionsBuffer.MapCPUMemory());
-		m_Normals = reinterpret_cast<glm::vec4*>(NormalsBuffer.MapCPUMemory());
-		m_Depth = reinterpret_cast<float*>(DepthBuffer.MapCPUMemory());
+		m_HitDistances = reinterpret_cast<float*>(HitDistanceBuffer.GetCPUMemory());
+		m_Normals = reinterpret_cast<uint32_t*>(NormalsBuffer.GetCPUMemory());
+		m_Depth = reinterpret_cast<float*>(DepthBuffer.GetCPUMemory());
+
+		if (s_NumMarchThreads)
+		{
+			m_RayMarcher.SetNumThreads(*s_NumMarchThreads);
+			s_NumMarchThreads.reset();
+		}
 
 		m_RayMarcher.Prepare(g_VisualizationSettings,
-							 CameraController,
+							 CameraController.Position,
+							 CameraController.Camera.GetInvProjectionView(),
+							 Vulkan.SwapchainExtent.width,
+							 Vulkan.SwapchainExtent.height,
 							 Dataset,
-							 m_Positions,
+							 m_HitDistances,
 							 m_Normals,
 							 m_Depth);
 
+		s_MarchStart = std::chrono::steady_clock::now();
 		m_RayMarcher.Start();
 	}
 
@@ -276,9 +399,33 @@ void AdvancedRenderer::Render()
 	{
 		RayMarchFinished = true;
 
-		PositionsBuffer.UnmapCPUMemory();
-		NormalsBuffer.UnmapCPUMemory();
-		DepthBuffer.UnmapCPUMemory();
+		// includes the frames that ran while the workers marched
+		GlobalStatistics.Sample("Ray march [ms]",
+								std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - s_MarchStart).count());
+
+		if (s_CompareAnisotropy)
+		{
+			PROFILE_SCOPE("Compare anisotropy");
+
+			s_AnisotropyDifference = m_RayMarcher.CompareWithExact();
+			s_CompareAnisotropy = false;
+		}
+
+		if (s_MeasureScaling)
+		{
+			PROFILE_SCOPE("Measure thread scaling");
+
+			s_Scaling = m_RayMarcher.MeasureScaling();
+			s_MeasureScaling = false;
+
+			WriteScalingReport(AssetManager::GetTempDirectory() / "thread_scaling.json", s_Scaling);
+		}
+
+		if (!m_RayMarcher.GetCost().empty())
+		{
+			UpdateCostImage();
+			SampleCostHistograms();
+		}
 
 		if (g_Autoplay)
 		{
@@ -293,36 +440,20 @@ void AdvancedRenderer::Render()
 
 		if (g_Recording)
 			Vulkan.Screenshot();
-		
-		s_ProcessTimer = g_Recording ? s_ProcessTimerMax : 0.0f;
+
+		Benchmark.EndMarch();
+
+		// recordings and benchmarks march back to back
+		s_ProcessTimer = g_Recording || Benchmark.IsRunning() ? s_ProcessTimerMax : 0.0f;
 	}
 
 	{
 		PROFILE_SCOPE("Post-marching");
 
-		PositionsBuffer.CopyToGPU();
-		NormalsBuffer.CopyToGPU();
-
 		Vulkan.CommandBuffer.reset();
 		vk::CommandBufferBeginInfo beginInfo;
 		Vulkan.CommandBuffer.begin(beginInfo);
 
-		PositionsBuffer.TransitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal,
-										 vk::AccessFlagBits::eShaderRead,
-										 vk::PipelineStageFlagBits::eFragmentShader);
-
-		NormalsBuffer.TransitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal,
-									   vk::AccessFlagBits::eShaderRead,
-									   vk::PipelineStageFlagBits::eFragmentShader);
-
-		DepthBuffer.TransitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal,
-									 vk::AccessFlagBits::eShaderRead,
-									 vk::PipelineStageFlagBits::eFragmentShader);
-
-		SmoothedDepthBuffer.TransitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal,
-											 vk::AccessFlagBits::eShaderRead,
-											 vk::PipelineStageFlagBits::eFragmentShader);
-
 		TransitionImageLayout(Vulkan.CommandBuffer,
 							  Vulkan.SwapchainImages[Vulkan.CurrentImageIndex],
 							  vk::ImageLayout::eUndefined,
@@ -332,25 +463,7 @@ void AdvancedRenderer::Render()
 							  vk::PipelineStageFlagBits::eTopOfPipe,
 							  vk::PipelineStageFlagBits::eColorAttachmentOutput);
 
-		if (s_EnableShowDepth)
-		{
-			ShowImageRenderPass.Begin();
-			DrawFullscreenQuad();
-			ShowImageRenderPass.End();
-		}
-
-		if (s_EnableComposition)
-		{
-			CompositionRenderPass.Begin();
-			DrawFullscreenQuad();
-			CompositionRenderPass.End();
-		}
-
-		if (s_EnableCoordinateSystem)
-		{
-			CoordinateSystemRenderPass.Begin();
-			CoordinateSystemRenderPass.End();
-		}
+		Graph.Execute(Vulkan.CommandBuffer, PostMarching);
 	}
 
 	//   Done in Renderer:
@@ -373,6 +486,7 @@ void AdvancedRenderer::RenderUI()
 	ImGui::SliderInt("# steps", &g_VisualizationSettings.MaxSteps, 0, 128);
 	ImGui::DragFloat("Step size", &g_VisualizationSettings.StepSize, 0.0001f, 0.001f, 0.1f, "%f");
 	ImGui::DragFloat("Iso", &g_VisualizationSettings.IsoDensity, 0.1f, 0.001f, 1000.0f, "%f", ImGuiSliderFlags_Logarithmic);
+	ImGui::Checkbox("Skip empty space", &g_VisualizationSettings.EnableGridSkipping);
 
 	ImGui::SliderFloat("Blur spread", &GaussRenderPass.Spread, 1.0f, 32.0f);
 	
@@ -389,6 +503,21 @@ void AdvancedRenderer::RenderUI()
 		ImGui::DragFloat("k_r", &g_VisualizationSettings.k_r, 0.001f, 0.0f, 8.0f);
 		ImGui::DragFloat("k_s", &g_VisualizationSettings.k_s, 1.0f, 0.0f, 6000.0f);
 		ImGui::DragInt("N_eps", &g_VisualizationSettings.N_eps, 1.0f, 1, 500);
+
+		ImGui::Checkbox("Approximate (per grid cell)", &g_VisualizationSettings.ApproximateAnisotropy);
+
+		if (ImGui::Button("Compare with exact"))
+			s_CompareAnisotropy = true;
+
+		if (s_AnisotropyDifference)
+		{
+			const RayMarcher::ImageDifference& d = *s_AnisotropyDifference;
+
+			ImGui::Text("Time: %.1f ms approximate, %.1f ms exact", d.ApproximateTime, d.ExactTime);
+			ImGui::Text("Hit mismatch: %.3f %%", 100.0f * d.HitMismatch);
+			ImGui::Text("Position error: %.4f mean, %.4f max [radii]", d.MeanPositionError, d.MaxPositionError);
+			ImGui::Text("Normal error: %.2f mean, %.2f max [deg]", d.MeanNormalError, d.MaxNormalError);
+		}
 	}
 
 	{
@@ -403,33 +532,259 @@ void AdvancedRenderer::RenderUI()
 
 	{
 		ImGui::Separator();
-		ImGui::Text("What to show");
+		ImGui::Text("Ray cost");
 
-		ImGui::TreePush("last_render_pass");
+		bool record = m_RayMarcher.IsCostRecording();
+		if (ImGui::Checkbox("Record", &record))
+			m_RayMarcher.SetCostRecording(record);
+
+		if (ImGui::Combo("Metric", &s_CostMetric, s_CostMetricNames, NumCostMetrics))
+			UpdateCostImage();
+
+		const std::vector<RayCost>& cost = m_RayMarcher.GetCost();
+
+		if (cost.empty())
+			ImGui::TextDisabled("Recorded with the next march");
+		else if (ImGui::Button("Dump to disk"))
+		{
+			const auto path = AssetManager::GetTempDirectory() /
+				fmt::format("ray_cost_{}x{}.bin", Vulkan.SwapchainExtent.width, Vulkan.SwapchainExtent.height);
+
+			DumpDataToFile(path.string().c_str(), cost);
+			SPDLOG_INFO("Dumped the ray cost to '{}'.", path.string());
+		}
+	}
+
+	{
+		ImGui::Separator();
+		ImGui::Text("Benchmark");
+
+		static RendererBenchmark::Config config = { .LastFrame = int(Dataset->Frames.size()) - 1 };
+		const auto pathFile = AssetManager::GetTempDirectory() / "camera_path.yml";
+
+		ImGui::Checkbox("Record camera path", &Benchmark.RecordingPath);
+		ImGui::SameLine();
+		ImGui::Text("%zu keyframes", Benchmark.Path.GetSize());
+
+		if (ImGui::Button("Clear path"))
+			Benchmark.Path.Clear();
+		ImGui::SameLine();
+		if (ImGui::Button("Save path"))
+			Benchmark.Path.Save(pathFile);
+		ImGui::SameLine();
+		if (ImGui::Button("Load path"))
+			Benchmark.Path.Load(pathFile);
+
+		const int lastFrame = int(Dataset->Frames.size()) - 1;
+		ImGui::DragInt("First frame", &config.FirstFrame, 0.125f, 0, lastFrame, "%d", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::DragInt("Last frame", &config.LastFrame, 0.125f, 0, lastFrame, "%d", ImGuiSliderFlags_AlwaysClamp);
+
+		if (!Benchmark.IsRunning())
+		{
+			if (ImGui::Button("Run benchmark"))
+				StartBenchmark(config);
+		}
+		else
+		{
+			if (ImGui::Button("Stop benchmark"))
+				Benchmark.Stop();
+
+			ImGui::SameLine();
+			ImGui::Text("%u / %u marches", Benchmark.GetNumMarched(), Benchmark.GetNumMarches());
+		}
+	}
+
+	{
+		ImGui::Separator();
+		ImGui::Text("Render graph");
+
+		Graph.RenderUI();
+	}
+
+	{
+		ImGui::Separator();
+		ImGui::Text("Particle buffer cache");
+
+		int budget = int(ParticleCache.GetBudget() / (1024 * 1024));
+		if (ImGui::DragInt("Budget [MB]", &budget, 1.0f, 1, 16384))
+			ParticleCache.SetBudget(vk::DeviceSize(budget) * 1024 * 1024);
+
+		ImGui::Text("%zu frames resident (%.1f MB), %zu uploads",
+					ParticleCache.GetNumResident(),
+					float(ParticleCache.GetResidentSize()) / (1024.0f * 1024.0f),
+					ParticleCache.GetNumUploads());
+	}
+
+	{
+		ImGui::Separator();
+		ImGui::Text("Device memory");
+
+		const MemoryStats stats = Vulkan.Allocator.GetStats();
+		constexpr float MB = 1024.0f * 1024.0f;
+
+		ImGui::Text("%u blocks, %.1f of %.1f MB used",
+					stats.NumBlocks,
+					float(stats.UsedBytes) / MB,
+					float(stats.BlockBytes) / MB);
+		ImGui::Text("%u own allocations, %.1f MB",
+					stats.NumOwnAllocations,
+					float(stats.OwnBytes) / MB);
+		ImGui::Text("%u allocations in total", stats.NumAllocations);
+	}
+
+	{
+		ImGui::Separator();
+		ImGui::Text("Memory");
+
+		if (ImGui::Button("Refresh") || !s_MemoryUsage)
+			s_MemoryUsage = GetMemoryUsage();
+
+		const MemoryUsage& memory = *s_MemoryUsage;
+		constexpr float MB = 1024.0f * 1024.0f;
+
+		ImGui::SameLine();
+		ImGui::Text("%zu frames resident", memory.Frames.NumFrames);
+
+		// the searches are estimates, CompactNSearch does not expose its sizes
+		if (ImGui::BeginTable("Frame memory", 3, ImGuiTableFlags_BordersOuter | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Frame component");
+			ImGui::TableSetupColumn("All frames [MB]");
+			ImGui::TableSetupColumn("Largest [MB]");
+			ImGui::TableHeadersRow();
+
+			const FrameMemory& total = memory.Frames.Total;
+			const FrameMemory& largest = memory.Frames.Largest;
+
+			const std::tuple<const char*, size_t, size_t> rows[] = {
+				{ "Particles", total.Particles, largest.Particles },
+				{ "Particles ext", total.ParticlesExt, largest.ParticlesExt },
+				{ "Search (est.)", total.Search, largest.Search },
+				{ "Search ext (est.)", total.SearchExt, largest.SearchExt },
+				{ "Density grid", total.DensityGrid, largest.DensityGrid },
+				{ "Total", total.GetTotal(), largest.GetTotal() },
+			};
+
+			for (const auto& [name, all, frame] : rows)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%s", name);
+				ImGui::TableNextColumn(); ImGui::Text("%.1f", float(all) / MB);
+				ImGui::TableNextColumn(); ImGui::Text("%.1f", float(frame) / MB);
+			}
+
+			ImGui::EndTable();
+		}
+
+		if (ImGui::BeginTable("Render target memory", 3, ImGuiTableFlags_BordersOuter | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Render target");
+			ImGui::TableSetupColumn("Host [MB]");
+			ImGui::TableSetupColumn("Device [MB]");
+			ImGui::TableHeadersRow();
+
+			auto row = [&](const char* name, vk::DeviceSize host, vk::DeviceSize device) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%s", name);
+				ImGui::TableNextColumn(); ImGui::Text("%.1f", float(host) / MB);
+				ImGui::TableNextColumn(); ImGui::Text("%.1f", float(device) / MB);
+			};
+
+			for (const MemoryUsage::RenderTarget& target : memory.RenderTargets)
+				row(target.Name, target.HostBytes, target.DeviceBytes);
+
+			row("transients", 0, memory.TransientBytes);
+			row("particle cache", 0, memory.ParticleCacheBytes);
+			row("Total",
+				memory.GetRenderTargetHostBytes(),
+				memory.GetRenderTargetDeviceBytes() + memory.TransientBytes + memory.ParticleCacheBytes);
+
+			ImGui::EndTable();
+		}
+
+		ImGui::Text("Process: %.1f MB, peak %.1f MB",
+					float(Utils::GetProcessMemory()) / MB,
+					float(Utils::GetPeakProcessMemory()) / MB);
+	}
+
+	{
+		ImGui::Separator();
+		ImGui::Text("Ray march threads");
+
+		int numThreads = int(s_NumMarchThreads.value_or(m_RayMarcher.GetNumThreads()));
+		if (ImGui::SliderInt("Threads", &numThreads, 1, int(m_RayMarcher.GetMaxThreads())))
+			s_NumMarchThreads = uint32_t(numThreads);
+
+		if (ImGui::Button("Measure scaling"))
+			s_MeasureScaling = true;
 
-		static int radio = 0;
-		ImGui::RadioButton("Composition", &radio, 0);
-		
-		if (ImGui::RadioButton("Depth", &radio, 1))
+		if (!s_Scaling.empty() &&
+			ImGui::BeginTable("Scaling", 6, ImGuiTableFlags_BordersOuter | ImGuiTableFlags_RowBg))
 		{
-			ShowImageRenderPass.ImageView = DepthBuffer.GPU.ImageView;
-			ShowImageRenderPass.Sampler = DepthBuffer.GPU.Sampler;
+			ImGui::TableSetupColumn("Threads");
+			ImGui::TableSetupColumn("Time [ms]");
+			ImGui::TableSetupColumn("Speedup");
+			ImGui::TableSetupColumn("Efficiency");
+			ImGui::TableSetupColumn("Busy [ms]");
+			ImGui::TableSetupColumn("Idle [ms]");
+			ImGui::TableHeadersRow();
+
+			for (const RayMarcher::ScalingResult& r : s_Scaling)
+			{
+				// mean over the workers
+				float busy = 0.0f, idle = 0.0f;
+				for (uint32_t i = 0; i < r.NumThreads; i++)
+				{
+					busy += r.BusyTime[i];
+					idle += r.IdleTime[i];
+				}
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%u", r.NumThreads);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", r.Time);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", r.Speedup);
+				ImGui::TableNextColumn(); ImGui::Text("%.0f %%", 100.0f * r.Efficiency);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", busy / float(r.NumThreads));
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", idle / float(r.NumThreads));
+			}
+
+			ImGui::EndTable();
 		}
+	}
+
+	{
+		ImGui::Separator();
+		ImGui::Text("Kernel instruction set");
 
-		if (ImGui::RadioButton("Blurred depth", &radio, 2))
+		int level = int(GetKernelSimdLevel());
+		const int maxLevel = int(GetMaxKernelSimdLevel());
+
+		for (int i = 0; i <= maxLevel; i++)
 		{
-			ShowImageRenderPass.ImageView = SmoothedDepthBuffer.GPU.ImageView;
-			ShowImageRenderPass.Sampler = SmoothedDepthBuffer.GPU.Sampler;
+			if (ImGui::RadioButton(KernelSimdLevelToString(KernelSimdLevel(i)), &level, i))
+				SetKernelSimdLevel(KernelSimdLevel(level));
 		}
+	}
+
+	{
+		ImGui::Separator();
+		ImGui::Text("What to show");
+
+		ImGui::TreePush("last_render_pass");
+
+		ImGui::RadioButton("Composition", &s_ShownImage, 0);
+		ImGui::RadioButton("Depth", &s_ShownImage, 1);
+		ImGui::RadioButton("Blurred depth", &s_ShownImage, 2);
+		ImGui::RadioButton("Ray cost", &s_ShownImage, 3);
 
 		ImGui::TreePop();
 
-		if (radio == 0)
+		if (s_ShownImage == 0)
 		{
 			s_EnableComposition = true;
 			s_EnableShowDepth = false;
 		}
-		else if (radio == 1 || radio == 2)
+		else
 		{
 			s_EnableComposition = false;
 			s_EnableShowDepth = true;
@@ -444,55 +799,293 @@ void AdvancedRenderer::RenderUI()
 // ------------------------------------------------------------------------
 // PRIVATE HELPER FUNCTIONS
 
-void AdvancedRenderer::CollectRenderData()
+void AdvancedRenderer::BuildRenderGraph()
+{
+	using Usage = RenderGraph::Usage;
+
+	Targets.Depth = Graph.Import("Depth", DepthBuffer.GPU.Image, DepthBuffer.AspectFlags, &DepthBuffer.GPU.Layout);
+	Targets.SmoothedDepth = Graph.Import("Smoothed depth",
+										 SmoothedDepthBuffer.GPU.Image,
+										 SmoothedDepthBuffer.AspectFlags,
+										 &SmoothedDepthBuffer.GPU.Layout);
+	Targets.HitDistance = Graph.Import("Hit distance",
+									   HitDistanceBuffer.GPU.Image,
+									   HitDistanceBuffer.AspectFlags,
+									   &HitDistanceBuffer.GPU.Layout);
+	Targets.Normals = Graph.Import("Normals", NormalsBuffer.GPU.Image, NormalsBuffer.AspectFlags, &NormalsBuffer.GPU.Layout);
+	Targets.Cost = Graph.Import("Ray cost", CostBuffer.GPU.Image, CostBuffer.AspectFlags, &CostBuffer.GPU.Layout);
+
+	Targets.GaussIntermediate = Graph.CreateTransient("Gauss intermediate",
+													  vk::Format::eR32Sfloat,
+													  vk::ImageUsageFlagBits::eColorAttachment |
+													  vk::ImageUsageFlagBits::eSampled,
+													  vk::ImageAspectFlagBits::eColor);
+
+	// before the ray march
+
+	Graph.AddPass("Depth pass", PreMarching, [this](vk::CommandBuffer& cmd) {
+		DepthRenderPass.Begin();
+		DrawDepthPass();
+		DepthRenderPass.End();
+	})
+		.Write(Targets.Depth, Usage::DepthAttachment)
+		.EnabledIf([]() { return s_EnableDepthPass; });
+
+	Graph.AddPass("Gauss horizontal", PreMarching, [this](vk::CommandBuffer& cmd) {
+		GaussRenderPass.Begin(GaussRenderPass::Horizontal);
+		DrawFullscreenQuad();
+		GaussRenderPass.End();
+	})
+		.Read(Targets.Depth, Usage::Sampled)
+		.Write(Targets.GaussIntermediate, Usage::ColorAttachment)
+		.EnabledIf([]() { return s_EnableGaussPass; });
+
+	Graph.AddPass("Gauss vertical", PreMarching, [this](vk::CommandBuffer& cmd) {
+		GaussRenderPass.Begin(GaussRenderPass::Vertical);
+		DrawFullscreenQuad();
+		GaussRenderPass.End();
+	})
+		.Read(Targets.GaussIntermediate, Usage::Sampled)
+		.Write(Targets.SmoothedDepth, Usage::ColorAttachment)
+		.EnabledIf([]() { return s_EnableGaussPass; });
+
+	// read back the depth only while the ray marcher is not using it
+	Graph.AddPass("Depth readback", PreMarching, [this](vk::CommandBuffer& cmd) {
+		DepthBuffer.CopyFromGPU(cmd);
+	})
+		.Read(Targets.Depth, Usage::TransferSrc)
+		.SideEffect()
+		.EnabledIf([]() { return bool(RayMarchFinished); });
+
+	// after the ray march
+
+	Graph.AddPass("Hit upload", PostMarching, [this](vk::CommandBuffer& cmd) {
+		HitDistanceBuffer.CopyToGPU(cmd);
+		NormalsBuffer.CopyToGPU(cmd);
+	})
+		.Write(Targets.HitDistance, Usage::TransferDst)
+		.Write(Targets.Normals, Usage::TransferDst);
+
+	Graph.AddPass("Cost upload", PostMarching, [this](vk::CommandBuffer& cmd) {
+		CostBuffer.CopyToGPU(cmd);
+	})
+		.Write(Targets.Cost, Usage::TransferDst);
+
+	Graph.AddPass("Show depth", PostMarching, [this](vk::CommandBuffer& cmd) {
+		ShowImageRenderPass.ImageView = DepthBuffer.GPU.ImageView;
+		ShowImageRenderPass.Sampler = DepthBuffer.GPU.Sampler;
+
+		ShowImageRenderPass.Begin();
+		DrawFullscreenQuad();
+		ShowImageRenderPass.End();
+	})
+		.Read(Targets.Depth, Usage::Sampled)
+		.SideEffect()
+		.EnabledIf([]() { return s_EnableShowDepth && s_ShownImage == 1; });
+
+	Graph.AddPass("Show blurred depth", PostMarching, [this](vk::CommandBuffer& cmd) {
+		ShowImageRenderPass.ImageView = SmoothedDepthBuffer.GPU.ImageView;
+		ShowImageRenderPass.Sampler = SmoothedDepthBuffer.GPU.Sampler;
+
+		ShowImageRenderPass.Begin();
+		DrawFullscreenQuad();
+		ShowImageRenderPass.End();
+	})
+		.Read(Targets.SmoothedDepth, Usage::Sampled)
+		.SideEffect()
+		.EnabledIf([]() { return s_EnableShowDepth && s_ShownImage == 2; });
+
+	Graph.AddPass("Show ray cost", PostMarching, [this](vk::CommandBuffer& cmd) {
+		ShowImageRenderPass.ImageView = CostBuffer.GPU.ImageView;
+		ShowImageRenderPass.Sampler = CostBuffer.GPU.Sampler;
+		ShowImageRenderPass.PushConstants.Mode = ShowImageRenderPass::Heatmap;
+
+		ShowImageRenderPass.Begin();
+		DrawFullscreenQuad();
+		ShowImageRenderPass.End();
+
+		ShowImageRenderPass.PushConstants.Mode = ShowImageRenderPass::Inverted;
+	})
+		.Read(Targets.Cost, Usage::Sampled)
+		.SideEffect()
+		.EnabledIf([]() { return s_EnableShowDepth && s_ShownImage == 3; });
+
+	Graph.AddPass("Composition", PostMarching, [this](vk::CommandBuffer& cmd) {
+		CompositionRenderPass.Begin();
+		DrawFullscreenQuad();
+		CompositionRenderPass.End();
+	})
+		.Read(Targets.HitDistance, Usage::Sampled)
+		.Read(Targets.Normals, Usage::Sampled)
+		.Read(Targets.SmoothedDepth, Usage::Sampled)
+		.SideEffect()
+		.EnabledIf([]() { return s_EnableComposition; });
+
+	Graph.AddPass("Coordinate system", PostMarching, [this](vk::CommandBuffer& cmd) {
+		CoordinateSystemRenderPass.Begin();
+		CoordinateSystemRenderPass.End();
+	})
+		.SideEffect()
+		.EnabledIf([]() { return s_EnableCoordinateSystem; });
+
+	Graph.Compile();
+}
+
+void AdvancedRenderer::StartBenchmark(RendererBenchmark::Config config)
+{
+	const int lastFrame = int(Dataset->Frames.size()) - 1;
+
+	config.FirstFrame = std::clamp(config.FirstFrame, 0, lastFrame);
+	config.LastFrame = std::clamp(config.LastFrame, config.FirstFrame, lastFrame);
+
+	if (config.Output.empty())
+		config.Output = AssetManager::GetTempDirectory() / "benchmark.json";
+
+	// the dataset frames follow the benchmark
+	g_Autoplay = false;
+	g_Recording = false;
+
+	Benchmark.Start(config, g_VisualizationSettings, GetMemoryUsage());
+	s_ProcessTimer = s_ProcessTimerMax;
+}
+
+MemoryUsage AdvancedRenderer::GetMemoryUsage() const
+{
+	MemoryUsage memory;
+	memory.Frames = Dataset->GetMemoryUsage();
+
+	const std::pair<const char*, const BilateralBuffer*> targets[] = {
+		{ "depth", &DepthBuffer },
+		{ "smoothed_depth", &SmoothedDepthBuffer },
+		{ "hit_distance", &HitDistanceBuffer },
+		{ "normals", &NormalsBuffer },
+		{ "cost", &CostBuffer },
+	};
+
+	for (const auto& [name, buffer] : targets)
+		memory.RenderTargets.push_back({ name, buffer->GetHostSize(), buffer->GetDeviceSize() });
+
+	memory.TransientBytes = Graph.GetStats().TransientBytes;
+	memory.ParticleCacheBytes = ParticleCache.GetResidentSize();
+
+	return memory;
+}
+
+void AdvancedRenderer::UpdateCostImage()
+{
+	const std::vector<RayCost>& cost = m_RayMarcher.GetCost();
+	float* image = reinterpret_cast<float*>(CostBuffer.GetCPUMemory());
+
+	if (cost.empty())
+		return;
+
+	// Normalized to the 99th percentile of the marched pixels, so that a few
+	// expensive pixels do not make the rest of the image black. Marched
+	// pixels take at least one step.
+	std::vector<float> values;
+
+	for (const RayCost& c : cost)
+	{
+		if (c.Steps > 0)
+			values.push_back(GetCostMetric(c, s_CostMetric));
+	}
+
+	float scale = 0.0f;
+
+	if (!values.empty())
+	{
+		auto p99 = values.begin() + (values.size() * 99) / 100;
+		std::nth_element(values.begin(), p99, values.end());
+
+		if (*p99 > 0.0f)
+			scale = 1.0f / *p99;
+	}
+
+	for (size_t i = 0; i < cost.size(); i++)
+		image[i] = std::min(GetCostMetric(cost[i], s_CostMetric) * scale, 1.0f);
+}
+
+void AdvancedRenderer::SampleCostHistograms()
 {
 	PROFILE_FUNCTION();
 
-	NumVertices = 0;
+	// power of two buckets: [0, 1), [1, 2), [2, 4), ...
+	constexpr int NumBuckets = 24;
 
-	Vertex* target = reinterpret_cast<Vertex*>(
-		Vulkan.Device.mapMemory(VertexBuffer.BufferCPU.Memory, 0, VertexBuffer.BufferCPU.Size));
+	const std::vector<RayCost>& cost = m_RayMarcher.GetCost();
 
-	for (auto& particle : Dataset->Frames[g_VisualizationSettings.Frame].m_Particles)
+	for (int metric = 0; metric < NumCostMetrics; metric++)
 	{
-		glm::vec3 x = CameraController.System[0];
-		glm::vec3 y = CameraController.System[1];
-
-		glm::vec3 p = particle;
-		const float R = Dataset->ParticleRadius;
-
-		glm::vec3 topLeft     = p + R * (-x + y);
-		glm::vec3 topRight    = p + R * (+x + y);
-		glm::vec3 bottomLeft  = p + R * (-x - y);
-		glm::vec3 bottomRight = p + R * (+x - y);
-
-		target[NumVertices++] = { topLeft, { -1, -1 } };
-		target[NumVertices++] = { bottomLeft, { -1, 1 } };
-		target[NumVertices++] = { topRight, { 1, -1 } };
-		target[NumVertices++] = { topRight, { 1, -1 } };
-		target[NumVertices++] = { bottomLeft, { -1, 1 } };
-		target[NumVertices++] = { bottomRight, { 1, 1 } };
+		std::array<uint32_t, NumBuckets> buckets = {};
+		uint32_t numMarched = 0;
+		double sum = 0.0;
+
+		for (const RayCost& c : cost)
+		{
+			if (c.Steps == 0)
+				continue;
+
+			const float value = GetCostMetric(c, metric);
+			const int bucket = value < 1.0f ? 0 : std::min(1 + int(std::log2(value)), NumBuckets - 1);
+
+			buckets[bucket]++;
+			numMarched++;
+			sum += value;
+		}
+
+		if (numMarched == 0)
+			return;
+
+		const char* name = s_CostMetricNames[metric];
+
+		GlobalStatistics.Sample(fmt::format("Ray {} mean", name).c_str(), float(sum / numMarched));
+
+		for (int b = 0; b < NumBuckets; b++)
+		{
+			if (buckets[b] == 0)
+				continue;
+
+			const uint32_t lower = b == 0 ? 0 : 1u << (b - 1);
+			const uint32_t upper = 1u << b;
+
+			GlobalStatistics.Sample(fmt::format("Ray {} [{}, {}) [%]", name, lower, upper).c_str(),
+									100.0f * float(buckets[b]) / float(numMarched));
+		}
 	}
+}
 
-	Vulkan.Device.unmapMemory(VertexBuffer.BufferCPU.Memory);
+void AdvancedRenderer::CollectRenderData()
+{
+	PROFILE_FUNCTION();
+
+	// positions only change with the dataset frame, the camera is applied in the shader
+	const uint32_t frame = g_VisualizationSettings.Frame;
 
-	// copy
-	if (NumVertices > 0)
+	ParticleCache.BeginFrame();
+	ParticleBuffer = ParticleCache.Get(Vulkan.CommandBuffer, frame);
+	NumParticles = uint32_t(Dataset->Frames[frame].m_Particles.size());
+
+	// upload the next frames while playing
+	if (g_Autoplay)
 	{
-		OneTimeCommand cmd;
-		VertexBuffer.Copy(cmd);
+		for (uint32_t i = 1; i <= ParticleCachePrefetch; i++)
+			ParticleCache.Prefetch(Vulkan.CommandBuffer, frame + i);
 	}
 }
 
 void AdvancedRenderer::DrawDepthPass()
 {
 	vk::DeviceSize offset = 0;
+	if (!ParticleBuffer)
+		return;
+
 	Vulkan.CommandBuffer.bindVertexBuffers(
 		0,
-		VertexBuffer.BufferGPU.Buffer,
+		ParticleBuffer,
 		offset);
 
-	Vulkan.CommandBuffer.draw(NumVertices, 1, 0, 0);
+	// one billboard of two triangles per particle
+	Vulkan.CommandBuffer.draw(6, NumParticles, 0, 0);
 }
 
 void AdvancedRenderer::DrawFullscreenQuad()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <engine/renderer/objects/VertexBuffer.h>
+#include <engine/renderer/RenderGraph.h>
 #include <engine/camera/Camera3D.h>
 #include <engine/camera/CameraController3D.h>
 
@@ -12,6 +13,8 @@
 #include "ShowImageRenderPass.h"
 #include "CoordinateSystemRenderPass.h"
 #include "RayMarcher.h"
+#include "ParticleBufferCache.h"
+#include "RendererBenchmark.h"
 
 class Event;
 
@@ -27,6 +30,14 @@ public:
 		static const vk::VertexInputBindingDescription Binding;
 	};
 
+	// Particles are drawn as instanced billboards. Each instance reads one
+	// position, the quad is expanded in depth.vert.
+	struct ParticleInstance
+	{
+		static const std::array<vk::VertexInputAttributeDescription, 1> Attributes;
+		static const vk::VertexInputBindingDescription Binding;
+	};
+
 public:
 	AdvancedRenderer();
 
@@ -38,8 +49,20 @@ public:
 
 	void Render();
 	void RenderUI();
+
+	// Frames out of the dataset are clamped, the report goes to .temp by default.
+	void StartBenchmark(RendererBenchmark::Config config);
+
+	// Walks the whole dataset, not meant to be called every frame.
+	MemoryUsage GetMemoryUsage() const;
 	
 private:
+	void BuildRenderGraph();
+
+	// from the ray cost of the last march
+	void UpdateCostImage();
+	void SampleCostHistograms();
+
 	void CollectRenderData();
 
 	void DrawDepthPass();
@@ -53,21 +76,51 @@ public:
 	CoordinateSystemRenderPass CoordinateSystemRenderPass;
 
 	BilateralBuffer DepthBuffer, SmoothedDepthBuffer;
-	BilateralBuffer PositionsBuffer;
+	// ray marcher output: hit distance along the ray and octahedral normal
+	BilateralBuffer HitDistanceBuffer;
 	BilateralBuffer NormalsBuffer;
+	// selected ray cost metric, normalized for the heatmap
+	BilateralBuffer CostBuffer;
+
+	// recorded in two phases, before and after the ray march
+	enum Phase
+	{
+		PreMarching = 0,
+		PostMarching = 1,
+	};
+
+	RenderGraph Graph;
+
+	struct
+	{
+		RenderGraph::Resource Depth;
+		RenderGraph::Resource SmoothedDepth;
+		RenderGraph::Resource GaussIntermediate; // transient
+		RenderGraph::Resource HitDistance;
+		RenderGraph::Resource Normals;
+		RenderGraph::Resource Cost;
+	} Targets;
 
 	VertexBuffer VertexBuffer;
 
+	// particle buffers of the dataset frames, see ParticleBufferCache
+	ParticleBufferCache ParticleCache;
+	vk::DeviceSize ParticleCacheBudget = 512 * 1024 * 1024;
+	uint32_t ParticleCachePrefetch = 2;
+
 	Dataset* Dataset = nullptr;
 
-	uint32_t NumVertices = 0;
+	vk::Buffer ParticleBuffer;
+	uint32_t NumParticles = 0;
 
 	Camera3D Camera;
 	CameraController3D CameraController;
 
 	RayMarcher m_RayMarcher;
 
-	glm::vec4* m_Positions;
-	glm::vec4* m_Normals;
+	RendererBenchmark Benchmark;
+
+	float* m_HitDistances;
+	uint32_t* m_Normals;
 	float* m_Depth;
 };
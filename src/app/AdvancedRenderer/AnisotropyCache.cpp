@@ -0,0 +1,70 @@
+#include <engine/hzpch.h>
+
+#include "AnisotropyCache.h"
+
+// the two lower bits of an entry's state hold the status, the rest the generation
+#define MAX_GENERATION (UINT32_MAX >> 2)
+
+void AnisotropyCache::Reset(size_t numCells)
+{
+	if (numCells != m_NumCells)
+	{
+		m_Entries = std::make_unique<Entry[]>(numCells);
+		m_NumCells = numCells;
+
+		for (size_t i = 0; i < numCells; i++)
+			m_Entries[i].State.store(0, std::memory_order_relaxed);
+
+		m_Generation = 0;
+	}
+
+	if (++m_Generation > MAX_GENERATION)
+	{
+		// wrap around, old generations could become valid again
+		for (size_t i = 0; i < m_NumCells; i++)
+			m_Entries[i].State.store(0, std::memory_order_relaxed);
+
+		m_Generation = 1;
+	}
+
+	m_NumPublished = 0;
+}
+
+bool AnisotropyCache::Get(uint32_t cell, glm::mat3& G, float& detG) const
+{
+	const Entry& entry = m_Entries[cell];
+
+	if (entry.State.load(std::memory_order_acquire) != ((m_Generation << 2) | StateReady))
+		return false;
+
+	G = entry.G;
+	detG = entry.detG;
+
+	return true;
+}
+
+bool AnisotropyCache::Claim(uint32_t cell)
+{
+	Entry& entry = m_Entries[cell];
+
+	uint32_t state = entry.State.load(std::memory_order_relaxed);
+
+	// already claimed in this generation
+	if ((state >> 2) == m_Generation)
+		return false;
+
+	return entry.State.compare_exchange_strong(state,
+											   (m_Generation << 2) | StateComputing,
+											   std::memory_order_relaxed);
+}
+
+void AnisotropyCache::Publish(uint32_t cell, const glm::mat3& G, float detG)
+{
+	Entry& entry = m_Entries[cell];
+
+	entry.G = G;
+	entry.detG = detG;
+	entry.State.store((m_Generation << 2) | StateReady, std::memory_order_release);
+
+	m_NumPublished.fetch_add(1, std::memory_order_relaxed);
+}
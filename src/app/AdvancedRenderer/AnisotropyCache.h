@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+* Memoizes the WPCA result (G, det(G)) per density grid cell for the
+* approximate anisotropy mode.
+*
+* Each entry is published once: the first thread to touch a cell claims it,
+* computes G and publishes it with a release store, all later readers acquire
+* it. Threads that find a cell claimed but not yet published compute their own
+* result instead of waiting. Entries are tagged with a generation, so that
+* resetting the table does not have to touch them.
+*/
+class AnisotropyCache
+{
+public:
+	// Invalidates all entries and resizes the table to numCells.
+	// Must not be called while the ray marcher is running.
+	void Reset(size_t numCells);
+
+	// Returns true and the memoized result if the cell has been published.
+	bool Get(uint32_t cell, glm::mat3& G, float& detG) const;
+
+	// Returns true for exactly one thread per cell and generation. That thread
+	// has to publish the cell afterwards.
+	bool Claim(uint32_t cell);
+	void Publish(uint32_t cell, const glm::mat3& G, float detG);
+
+	size_t GetNumPublished() const { return m_NumPublished.load(); }
+
+private:
+	enum : uint32_t
+	{
+		StateComputing = 1,
+		StateReady = 2,
+	};
+
+	struct Entry
+	{
+		std::atomic_uint32_t State;
+		float detG;
+		glm::mat3 G;
+	};
+
+	std::unique_ptr<Entry[]> m_Entries;
+	size_t m_NumCells = 0;
+
+	// entries with a different generation are stale, 0 is never used
+	uint32_t m_Generation = 0;
+
+	std::atomic_size_t m_NumPublished = 0;
+};
@@ -3,7 +3,6 @@
 #include "BilateralBuffer.h"
 
 #include <engine/renderer/Renderer.h>
-#include <engine/renderer/objects/Command.h>
 
 // -------------------------------------------------------------------------
 // PUBLIC FUNCTIONS
@@ -54,7 +53,7 @@ void BilateralBuffer::Init(vk::ImageUsageFlags usage, vk::Format format, vk::Ima
 	Format = format;
 	AspectFlags = aspectFlags;
 	Size =
-		4 * sizeof(float) *
+		GetTexelSize(format) *
 		Vulkan.SwapchainExtent.width *
 		Vulkan.SwapchainExtent.height;
 	
@@ -66,18 +65,21 @@ void BilateralBuffer::Init(vk::ImageUsageFlags usage, vk::Format format, vk::Ima
 
 void BilateralBuffer::Exit()
 {
+	CPU.Mapped = nullptr;
+
 	Vulkan.Device.destroyBuffer(CPU.Buffer);
-	Vulkan.Device.freeMemory(CPU.Memory);
+	Vulkan.Allocator.Free(CPU.Allocation);
 
 	Vulkan.Device.destroyImage(GPU.Image);
 	Vulkan.Device.destroyImageView(GPU.ImageView);
-	Vulkan.Device.freeMemory(GPU.Memory);
+	Vulkan.Allocator.Free(GPU.Allocation);
 	Vulkan.Device.destroySampler(GPU.Sampler);
 }
 
-void BilateralBuffer::CopyToGPU()
+void BilateralBuffer::CopyToGPU(vk::CommandBuffer& cmd)
 {
-	OneTimeCommand cmd;
+	HZ_ASSERT(GPU.Layout == vk::ImageLayout::eTransferDstOptimal, "Image has to be in transfer dst layout!");
+
 	vk::BufferImageCopy region;
 
 	region
@@ -97,16 +99,17 @@ void BilateralBuffer::CopyToGPU()
 			1
 		));
 
-	cmd->copyBufferToImage(
+	cmd.copyBufferToImage(
 		CPU.Buffer,
 		GPU.Image,
 		vk::ImageLayout::eTransferDstOptimal,
 		region);
 }
 
-void BilateralBuffer::CopyFromGPU()
+void BilateralBuffer::CopyFromGPU(vk::CommandBuffer& cmd)
 {
-	OneTimeCommand cmd;
+	HZ_ASSERT(GPU.Layout == vk::ImageLayout::eTransferSrcOptimal, "Image has to be in transfer src layout!");
+
 	vk::BufferImageCopy region;
 
 	region
@@ -126,26 +129,50 @@ void BilateralBuffer::CopyFromGPU()
 			1
 		));
 
-	cmd->copyImageToBuffer(
+	cmd.copyImageToBuffer(
 		GPU.Image,
 		vk::ImageLayout::eTransferSrcOptimal,
 		CPU.Buffer,
 		region);
-}
 
-void* BilateralBuffer::MapCPUMemory(vk::DeviceSize offset, vk::DeviceSize size)
-{
-	return Vulkan.Device.mapMemory(CPU.Memory, offset, size);
-}
-
-void BilateralBuffer::UnmapCPUMemory()
-{
-	Vulkan.Device.unmapMemory(CPU.Memory);
+	// make the copy visible to the host once the submission's fence signals
+	vk::BufferMemoryBarrier barrier;
+	barrier
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eHostRead)
+		.setBuffer(CPU.Buffer)
+		.setOffset(0)
+		.setSize(VK_WHOLE_SIZE);
+
+	cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+						vk::PipelineStageFlagBits::eHost,
+						{},
+						{},
+						barrier,
+						{});
 }
 
 // -------------------------------------------------------------------------
 // PRIVATE HELPER FUNCTIONS
 
+vk::DeviceSize BilateralBuffer::GetTexelSize(vk::Format format)
+{
+	switch (format)
+	{
+		case vk::Format::eR32Sfloat:
+		case vk::Format::eR16G16Snorm:
+		case vk::Format::eD32Sfloat:
+			return 4;
+
+		case vk::Format::eR32G32B32A32Sfloat:
+			return 16;
+
+		default:
+			HZ_ASSERT(false, "Unsupported format!");
+			return 0;
+	}
+}
+
 void BilateralBuffer::CreateCPUSide()
 {
 	// buffer
@@ -158,23 +185,15 @@ void BilateralBuffer::CreateCPUSide()
 
 	CPU.Buffer = Vulkan.Device.createBuffer(bufferCreateInfo);
 
-	// memory
-
-	auto requirements = Vulkan.Device.getBufferMemoryRequirements(CPU.Buffer);
-
-	vk::MemoryAllocateInfo allocInfo;
-	allocInfo.setAllocationSize(requirements.size)
-		.setMemoryTypeIndex(Vulkan.FindMemoryType(
-			requirements.memoryTypeBits,
-			vk::MemoryPropertyFlagBits::eHostCoherent |
-			vk::MemoryPropertyFlagBits::eHostVisible
-		));
+	// memory, host-visible allocations stay mapped for their lifetime
 
-	CPU.Memory = Vulkan.Device.allocateMemory(allocInfo);
-
-	// bind memory
+	CPU.Allocation = Vulkan.Allocator.AllocateBuffer(
+		CPU.Buffer,
+		vk::MemoryPropertyFlagBits::eHostCoherent |
+		vk::MemoryPropertyFlagBits::eHostVisible
+	);
 
-	Vulkan.Device.bindBufferMemory(CPU.Buffer, CPU.Memory, 0);
+	CPU.Mapped = CPU.Allocation.Mapped;
 }
 
 void BilateralBuffer::CreateGPUSide()
@@ -206,20 +225,7 @@ void BilateralBuffer::CreateGPUSide()
 
 	// memory
 
-	auto requirements = Vulkan.Device.getImageMemoryRequirements(GPU.Image);
-
-	vk::MemoryAllocateInfo allocInfo;
-	allocInfo.setAllocationSize(requirements.size)
-		.setMemoryTypeIndex(Vulkan.FindMemoryType(
-			requirements.memoryTypeBits,
-			vk::MemoryPropertyFlagBits::eDeviceLocal
-		));
-
-	GPU.Memory = Vulkan.Device.allocateMemory(allocInfo);
-
-	// bind memory
-
-	Vulkan.Device.bindImageMemory(GPU.Image, GPU.Memory, 0);
+	GPU.Allocation = Vulkan.Allocator.AllocateImage(GPU.Image, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
 	// view
 
@@ -263,6 +269,15 @@ void BilateralBuffer::CreateGPUSide()
 void BilateralBuffer::TransitionLayout(vk::ImageLayout newLayout,
 									   vk::AccessFlags accessMask,
 									   vk::PipelineStageFlags stage)
+{
+	TransitionLayout(newLayout, {}, accessMask, stage, stage);
+}
+
+void BilateralBuffer::TransitionLayout(vk::ImageLayout newLayout,
+									   vk::AccessFlags srcAccessMask,
+									   vk::AccessFlags dstAccessMask,
+									   vk::PipelineStageFlags srcStage,
+									   vk::PipelineStageFlags dstStage)
 {
 	if (GPU.Layout == newLayout) return;
 
@@ -274,7 +289,8 @@ void BilateralBuffer::TransitionLayout(vk::ImageLayout newLayout,
 		.setImage(GPU.Image)
 		.setOldLayout(oldLayout)
 		.setNewLayout(GPU.Layout)
-		.setDstAccessMask(accessMask)
+		.setSrcAccessMask(srcAccessMask)
+		.setDstAccessMask(dstAccessMask)
 		.setSubresourceRange(vk::ImageSubresourceRange(
 			AspectFlags, // aspect mask
 			0, // mip map level
@@ -284,8 +300,8 @@ void BilateralBuffer::TransitionLayout(vk::ImageLayout newLayout,
 		));
 
 	Vulkan.CommandBuffer.pipelineBarrier(
-		stage,
-		stage,
+		srcStage,
+		dstStage,
 		{}, // dependency flags
 		{}, // memory barriers
 		{}, // buffer memory barriers
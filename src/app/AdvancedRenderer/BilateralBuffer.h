@@ -1,9 +1,13 @@
 #pragma once
 
+#include <engine/renderer/objects/MemoryAllocator.h>
+
 /**
 * Buffer used for per-pixel geometry information like positions or depth.
 * Can be used as a framebuffer attachment.
-* Can be copied between host and device.
+* Can be copied between host and device. The copies are recorded into a
+* command buffer, their completion is tracked by its submission's fence.
+* The host side is persistently mapped.
 */
 class BilateralBuffer
 {
@@ -19,17 +23,31 @@ public:
 	void Init(vk::ImageUsageFlags usage, vk::Format format, vk::ImageAspectFlags aspectFlags);
 	void Exit();
 
-	void CopyToGPU();
-	void CopyFromGPU();
+	// The image has to be in transfer dst/src layout respectively.
+	void CopyToGPU(vk::CommandBuffer& cmd);
+	void CopyFromGPU(vk::CommandBuffer& cmd);
+
+	void* GetCPUMemory() const { return CPU.Mapped; }
 
-	void* MapCPUMemory(vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
-	void UnmapCPUMemory();
+	// of the allocations, which may be larger than Size
+	vk::DeviceSize GetHostSize() const { return CPU.Allocation.Size; }
+	vk::DeviceSize GetDeviceSize() const { return GPU.Allocation.Size; }
 
 	void TransitionLayout(vk::ImageLayout newLayout,
 						  vk::AccessFlags accessMask,
 						  vk::PipelineStageFlags stage);
 
+	// Transition that also makes prior writes visible, e.g. when an image
+	// rendered to in one pass is sampled in the next.
+	void TransitionLayout(vk::ImageLayout newLayout,
+						  vk::AccessFlags srcAccessMask,
+						  vk::AccessFlags dstAccessMask,
+						  vk::PipelineStageFlags srcStage,
+						  vk::PipelineStageFlags dstStage);
+
 private:
+	static vk::DeviceSize GetTexelSize(vk::Format format);
+
 	void CreateCPUSide();
 	void CreateGPUSide();
 
@@ -37,14 +55,15 @@ public:
 	struct
 	{
 		vk::Buffer Buffer;
-		vk::DeviceMemory Memory;
+		Allocation Allocation;
+		void* Mapped = nullptr;
 	} CPU;
 
 	struct
 	{
 		vk::Image Image;
 		vk::ImageView ImageView;
-		vk::DeviceMemory Memory;
+		Allocation Allocation;
 		vk::Sampler Sampler;
 
 		vk::ImageLayout Layout;
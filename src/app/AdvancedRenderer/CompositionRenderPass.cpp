@@ -33,12 +33,12 @@ void CompositionRenderPass::Init()
 	CreateDescriptorSet();
 
 	CreatePipelineLayout();
-	CreatePipeline();
 
 	CreateUniformBuffer();
 	UpdateUniformsFullscreen();
 
-	UpdateDescriptorSets();
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++)
+		UpdateDescriptorSets(frame);
 }
 
 void CompositionRenderPass::Exit()
@@ -52,7 +52,8 @@ void CompositionRenderPass::Exit()
 	FragmentShader.Destroy();
 
 	UniformBufferFullscreen.Destroy();
-	UniformBuffer.Destroy();
+	for (Buffer& buffer : UniformBuffers)
+		buffer.Destroy();
 }
 
 void CompositionRenderPass::Begin()
@@ -92,7 +93,7 @@ void CompositionRenderPass::Begin()
 		vk::PipelineBindPoint::eGraphics,
 		PipelineLayout,
 		0,
-		DescriptorSet,
+		DescriptorSets[Vulkan.CurrentFrame],
 		{}
 	);
 }
@@ -227,7 +228,7 @@ void CompositionRenderPass::CreatePipeline()
 		.setPViewportState(&viewportState)
 		.setRenderPass(nullptr);
 
-	auto r = Vulkan.Device.createGraphicsPipeline({}, pipelineCreateInfo);
+	auto r = Vulkan.Device.createGraphicsPipeline(Vulkan.PipelineCache, pipelineCreateInfo);
 	HZ_ASSERT(r.result == vk::Result::eSuccess, "Pipeline creation failed!");
 	Pipeline = r.value;
 }
@@ -283,24 +284,29 @@ void CompositionRenderPass::CreateDescriptorSetLayout()
 
 void CompositionRenderPass::CreateDescriptorSet()
 {
+	PerFrame<vk::DescriptorSetLayout> layouts;
+	layouts.fill(DescriptorSetLayout);
+
 	vk::DescriptorSetAllocateInfo info;
 	info.setDescriptorPool(Vulkan.DescriptorPool)
-		.setDescriptorSetCount(1)
-		.setSetLayouts(DescriptorSetLayout);
+		.setSetLayouts(layouts);
 
 	auto r = Vulkan.Device.allocateDescriptorSets(info);
-	HZ_ASSERT(r.size() == 1, "allocateDescriptorSets failed!");
-	DescriptorSet = r.front();
+	HZ_ASSERT(r.size() == MAX_FRAMES_IN_FLIGHT, "allocateDescriptorSets failed!");
+	std::copy(r.begin(), r.end(), DescriptorSets.begin());
 }
 
 void CompositionRenderPass::CreateUniformBuffer()
 {
-	UniformBuffer.Create(
-		sizeof(Uniforms),
-		vk::BufferUsageFlagBits::eUniformBuffer,
-		vk::MemoryPropertyFlagBits::eHostVisible |
-		vk::MemoryPropertyFlagBits::eHostCoherent
-	);
+	for (Buffer& buffer : UniformBuffers)
+	{
+		buffer.Create(
+			sizeof(Uniforms),
+			vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible |
+			vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+	}
 
 	UniformBufferFullscreen.Create(
 		sizeof(UniformsFullscreen),
@@ -320,8 +326,11 @@ void CompositionRenderPass::UpdateUniforms()
 
 	Uniforms.LightDirection = glm::normalize(glm::vec3(0, -1, +1));
 
+	Uniforms.MarchInvProjectionView = Renderer.m_RayMarcher.GetInvProjectionView();
+	Uniforms.MarchCameraPosition = Renderer.m_RayMarcher.GetCameraPosition();
+
 	// copy
-	UniformBuffer.Map(&Uniforms, sizeof(Uniforms));
+	UniformBuffers[Vulkan.CurrentFrame].Map(&Uniforms, sizeof(Uniforms));
 }
 
 void CompositionRenderPass::UpdateUniformsFullscreen()
@@ -333,12 +342,12 @@ void CompositionRenderPass::UpdateUniformsFullscreen()
 	UniformBufferFullscreen.Map(&UniformsFullscreen, sizeof(UniformsFullscreen));
 }
 
-void CompositionRenderPass::UpdateDescriptorSets()
+void CompositionRenderPass::UpdateDescriptorSets(uint32_t frame)
 {
 	// uniforms
 	vk::DescriptorBufferInfo bufferInfo;
 	bufferInfo
-		.setBuffer(UniformBuffer)
+		.setBuffer(UniformBuffers[frame])
 		.setOffset(0)
 		.setRange(VK_WHOLE_SIZE);
 
@@ -349,7 +358,7 @@ void CompositionRenderPass::UpdateDescriptorSets()
 		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 		.setDstArrayElement(0)
 		.setDstBinding(0)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
 	// uniforms fullscreen
 	vk::DescriptorBufferInfo bufferFullscreenInfo;
@@ -365,23 +374,23 @@ void CompositionRenderPass::UpdateDescriptorSets()
 		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 		.setDstArrayElement(0)
 		.setDstBinding(2)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
-	// positions
-	vk::DescriptorImageInfo positionsImageInfo;
-	positionsImageInfo
-		.setImageView(Renderer.PositionsBuffer.GPU.ImageView)
+	// hit distances
+	vk::DescriptorImageInfo hitDistancesImageInfo;
+	hitDistancesImageInfo
+		.setImageView(Renderer.HitDistanceBuffer.GPU.ImageView)
 		.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-		.setSampler(Renderer.PositionsBuffer.GPU.Sampler);
+		.setSampler(Renderer.HitDistanceBuffer.GPU.Sampler);
 
-	vk::WriteDescriptorSet writePositions;
-	writePositions
-		.setImageInfo(positionsImageInfo)
+	vk::WriteDescriptorSet writeHitDistances;
+	writeHitDistances
+		.setImageInfo(hitDistancesImageInfo)
 		.setDescriptorCount(1)
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
 		.setDstArrayElement(0)
 		.setDstBinding(1)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
 	// object normals
 	vk::DescriptorImageInfo normalsImageInfo;
@@ -397,7 +406,7 @@ void CompositionRenderPass::UpdateDescriptorSets()
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
 		.setDstArrayElement(0)
 		.setDstBinding(4)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
 	// smoothed depth
 	vk::DescriptorImageInfo smoothedDepthImageInfo;
@@ -413,13 +422,13 @@ void CompositionRenderPass::UpdateDescriptorSets()
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
 		.setDstArrayElement(0)
 		.setDstBinding(3)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
 	// write
 	std::array<vk::WriteDescriptorSet, 5> writes = {
 		writeUniform,
 		writeUniformFullscreen,
-		writePositions,
+		writeHitDistances,
 		writeNormals,
 		writeSmoothedDepth,
 	};
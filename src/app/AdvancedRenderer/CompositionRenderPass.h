@@ -2,6 +2,7 @@
 
 #include <engine/renderer/objects/Shader.h>
 #include <engine/renderer/objects/Buffer.h>
+#include <engine/renderer/objects/PerFrame.h>
 
 class AdvancedRenderer;
 
@@ -13,6 +14,9 @@ public:
 	void Init();
 	void Exit();
 
+	// Called by the renderer after Init(), concurrently with the other passes.
+	void CreatePipeline();
+
 	void Begin();
 	void End();
 
@@ -20,7 +24,6 @@ private:
 	void CreateShaders();
 
 	void CreatePipelineLayout();
-	void CreatePipeline();
 
 	void CreateDescriptorSetLayout();
 	void CreateDescriptorSet();
@@ -30,14 +33,14 @@ private:
 	void UpdateUniforms();
 	void UpdateUniformsFullscreen();
 
-	void UpdateDescriptorSets();
+	void UpdateDescriptorSets(uint32_t frame);
 
 public:
 	vk::Pipeline Pipeline;
 	vk::PipelineLayout PipelineLayout;
 
 	vk::DescriptorSetLayout DescriptorSetLayout;
-	vk::DescriptorSet DescriptorSet;
+	PerFrame<vk::DescriptorSet> DescriptorSets;
 
 	Shader VertexShader, FragmentShader;
 
@@ -56,9 +59,14 @@ public:
 
 		glm::vec3 LightDirection;
 		float _unused3;
+
+		// camera the hit distances were marched with
+		glm::mat4 MarchInvProjectionView;
+		glm::vec3 MarchCameraPosition;
+		float _unused4;
 	} Uniforms;
 
-	Buffer UniformBuffer;
+	PerFrame<Buffer> UniformBuffers;
 
 	struct
 	{
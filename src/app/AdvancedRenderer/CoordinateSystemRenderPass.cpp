@@ -24,7 +24,6 @@ void CoordinateSystemRenderPass::Init()
 	CreateDescriptorSet();
 
 	CreatePipelineLayout();
-	CreatePipeline();
 
 	CreateUniformBuffer();
 	CreateVertexBuffer();
@@ -44,7 +43,8 @@ void CoordinateSystemRenderPass::Exit()
 
 	VertexBuffer.Destroy();
 
-	UniformBuffer.Destroy();
+	for (Buffer& buffer : UniformBuffers)
+		buffer.Destroy();
 }
 
 void CoordinateSystemRenderPass::Begin()
@@ -84,7 +84,7 @@ void CoordinateSystemRenderPass::Begin()
 		vk::PipelineBindPoint::eGraphics,
 		PipelineLayout,
 		0,
-		DescriptorSet,
+		DescriptorSets[Vulkan.CurrentFrame],
 		{}
 	);
 
@@ -242,7 +242,7 @@ void CoordinateSystemRenderPass::CreatePipeline()
 		.setPViewportState(&viewportState)
 		.setRenderPass(nullptr);
 
-	auto r = Vulkan.Device.createGraphicsPipeline({}, pipelineCreateInfo);
+	auto r = Vulkan.Device.createGraphicsPipeline(Vulkan.PipelineCache, pipelineCreateInfo);
 	HZ_ASSERT(r.result == vk::Result::eSuccess, "Pipeline creation failed!");
 	Pipeline = r.value;
 }
@@ -266,24 +266,29 @@ void CoordinateSystemRenderPass::CreateDescriptorSetLayout()
 
 void CoordinateSystemRenderPass::CreateDescriptorSet()
 {
+	PerFrame<vk::DescriptorSetLayout> layouts;
+	layouts.fill(DescriptorSetLayout);
+
 	vk::DescriptorSetAllocateInfo info;
 	info.setDescriptorPool(Vulkan.DescriptorPool)
-		.setDescriptorSetCount(1)
-		.setSetLayouts(DescriptorSetLayout);
+		.setSetLayouts(layouts);
 
 	auto r = Vulkan.Device.allocateDescriptorSets(info);
-	HZ_ASSERT(r.size() == 1, "allocateDescriptorSets failed!");
-	DescriptorSet = r.front();
+	HZ_ASSERT(r.size() == MAX_FRAMES_IN_FLIGHT, "allocateDescriptorSets failed!");
+	std::copy(r.begin(), r.end(), DescriptorSets.begin());
 }
 
 void CoordinateSystemRenderPass::CreateUniformBuffer()
 {
-	UniformBuffer.Create(
-		sizeof(UniformBuffer),
-		vk::BufferUsageFlagBits::eUniformBuffer,
-		vk::MemoryPropertyFlagBits::eHostVisible |
-		vk::MemoryPropertyFlagBits::eHostCoherent
-	);
+	for (Buffer& buffer : UniformBuffers)
+	{
+		buffer.Create(
+			sizeof(Uniforms),
+			vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible |
+			vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+	}
 }
 
 void CoordinateSystemRenderPass::UpdateUniforms()
@@ -292,15 +297,17 @@ void CoordinateSystemRenderPass::UpdateUniforms()
 	Uniforms.Aspect = Renderer.Camera.Aspect;
 
 	// copy
-	UniformBuffer.Map(&Uniforms, sizeof(Uniforms));
+	UniformBuffers[Vulkan.CurrentFrame].Map(&Uniforms, sizeof(Uniforms));
 }
 
 void CoordinateSystemRenderPass::UpdateDescriptorSets()
 {
+	const uint32_t frame = Vulkan.CurrentFrame;
+
 	// uniforms fullscreen
 	vk::DescriptorBufferInfo uniformBufferInfo;
 	uniformBufferInfo
-		.setBuffer(UniformBuffer)
+		.setBuffer(UniformBuffers[frame])
 		.setOffset(0)
 		.setRange(VK_WHOLE_SIZE);
 
@@ -310,7 +317,7 @@ void CoordinateSystemRenderPass::UpdateDescriptorSets()
 		.setDescriptorCount(1)
 		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 		.setDstArrayElement(0)
-		.setDstSet(DescriptorSet)
+		.setDstSet(DescriptorSets[frame])
 		.setDstBinding(0);
 
 	// write
@@ -2,6 +2,7 @@
 
 #include <engine/renderer/objects/Shader.h>
 #include <engine/renderer/objects/Buffer.h>
+#include <engine/renderer/objects/PerFrame.h>
 #include <engine/renderer/objects/VertexBuffer.h>
 
 class AdvancedRenderer;
@@ -14,6 +15,9 @@ public:
 	void Init();
 	void Exit();
 
+	// Called by the renderer after Init(), concurrently with the other passes.
+	void CreatePipeline();
+
 	void Begin();
 	void End();
 
@@ -23,7 +27,6 @@ private:
 	void CreateVertexBuffer();
 
 	void CreatePipelineLayout();
-	void CreatePipeline();
 
 	void CreateDescriptorSetLayout();
 	void CreateDescriptorSet();
@@ -39,7 +42,7 @@ public:
 	vk::PipelineLayout PipelineLayout;
 
 	vk::DescriptorSetLayout DescriptorSetLayout;
-	vk::DescriptorSet DescriptorSet;
+	PerFrame<vk::DescriptorSet> DescriptorSets;
 
 	Shader VertexShader, FragmentShader;
 
@@ -53,5 +56,5 @@ public:
 		float Aspect;
 	} Uniforms;
 
-	Buffer UniformBuffer;
+	PerFrame<Buffer> UniformBuffers;
 };
@@ -22,7 +22,6 @@ void DepthRenderPass::Init()
 	CreateDescriptorSet();
 
 	CreatePipelineLayout();
-	CreatePipeline();
 
 	CreateUniformBuffer();
 
@@ -39,7 +38,8 @@ void DepthRenderPass::Exit()
 	VertexShader.Destroy();
 	FragmentShader.Destroy();
 
-	UniformBuffer.Destroy();
+	for (Buffer& buffer : UniformBuffers)
+		buffer.Destroy();
 }
 
 void DepthRenderPass::Begin()
@@ -76,7 +76,7 @@ void DepthRenderPass::Begin()
 		vk::PipelineBindPoint::eGraphics,
 		PipelineLayout,
 		0,
-		DescriptorSet,
+		DescriptorSets[Vulkan.CurrentFrame],
 		{}
 	);
 }
@@ -120,8 +120,8 @@ void DepthRenderPass::CreatePipeline()
 	// vertex input
 	vk::PipelineVertexInputStateCreateInfo vertexInputState;
 	vertexInputState
-		.setVertexAttributeDescriptions(AdvancedRenderer::Vertex::Attributes)
-		.setVertexBindingDescriptions(AdvancedRenderer::Vertex::Binding);
+		.setVertexAttributeDescriptions(AdvancedRenderer::ParticleInstance::Attributes)
+		.setVertexBindingDescriptions(AdvancedRenderer::ParticleInstance::Binding);
 
 	// input assembly
 	vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState;
@@ -200,7 +200,7 @@ void DepthRenderPass::CreatePipeline()
 		.setPViewportState(&viewportState)
 		.setRenderPass(nullptr);
 
-	auto r = Vulkan.Device.createGraphicsPipeline({}, pipelineCreateInfo);
+	auto r = Vulkan.Device.createGraphicsPipeline(Vulkan.PipelineCache, pipelineCreateInfo);
 	HZ_ASSERT(r.result == vk::Result::eSuccess, "Pipeline creation failed!");
 	Pipeline = r.value;
 }
@@ -220,24 +220,29 @@ void DepthRenderPass::CreateDescriptorSetLayout()
 
 void DepthRenderPass::CreateDescriptorSet()
 {
+	PerFrame<vk::DescriptorSetLayout> layouts;
+	layouts.fill(DescriptorSetLayout);
+
 	vk::DescriptorSetAllocateInfo info;
 	info.setDescriptorPool(Vulkan.DescriptorPool)
-		.setDescriptorSetCount(1)
-		.setSetLayouts(DescriptorSetLayout);
+		.setSetLayouts(layouts);
 
 	auto r = Vulkan.Device.allocateDescriptorSets(info);
-	HZ_ASSERT(r.size() == 1, "allocateDescriptorSets failed!");
-	DescriptorSet = r.front();
+	HZ_ASSERT(r.size() == MAX_FRAMES_IN_FLIGHT, "allocateDescriptorSets failed!");
+	std::copy(r.begin(), r.end(), DescriptorSets.begin());
 }
 
 void DepthRenderPass::CreateUniformBuffer()
 {
-	UniformBuffer.Create(
-		sizeof(Uniforms),
-		vk::BufferUsageFlagBits::eUniformBuffer,
-		vk::MemoryPropertyFlagBits::eHostVisible |
-		vk::MemoryPropertyFlagBits::eHostCoherent
-	);
+	for (Buffer& buffer : UniformBuffers)
+	{
+		buffer.Create(
+			sizeof(Uniforms),
+			vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible |
+			vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+	}
 }
 
 void DepthRenderPass::UpdateUniforms()
@@ -247,14 +252,16 @@ void DepthRenderPass::UpdateUniforms()
 	Uniforms.Radius = Renderer.Dataset->ParticleRadius;
 
 	// copy
-	UniformBuffer.Map(&Uniforms, sizeof(Uniforms));
+	UniformBuffers[Vulkan.CurrentFrame].Map(&Uniforms, sizeof(Uniforms));
 }
 
 void DepthRenderPass::UpdateDescriptorSets()
 {
+	const uint32_t frame = Vulkan.CurrentFrame;
+
 	vk::DescriptorBufferInfo bufferInfo;
 	bufferInfo
-		.setBuffer(UniformBuffer)
+		.setBuffer(UniformBuffers[frame])
 		.setOffset(0)
 		.setRange(VK_WHOLE_SIZE);
 
@@ -265,7 +272,7 @@ void DepthRenderPass::UpdateDescriptorSets()
 		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 		.setDstArrayElement(0)
 		.setDstBinding(0)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
 	std::array<vk::WriteDescriptorSet, 1> writes = {
 		writeUniform
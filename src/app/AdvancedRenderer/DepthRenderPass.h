@@ -2,6 +2,7 @@
 
 #include <engine/renderer/objects/Shader.h>
 #include <engine/renderer/objects/Buffer.h>
+#include <engine/renderer/objects/PerFrame.h>
 
 class AdvancedRenderer;
 
@@ -13,6 +14,9 @@ public:
 	void Init();
 	void Exit();
 
+	// Called by the renderer after Init(), concurrently with the other passes.
+	void CreatePipeline();
+
 	void Begin();
 	void End();
 
@@ -20,7 +24,6 @@ private:
 	void CreateShaders();
 
 	void CreatePipelineLayout();
-	void CreatePipeline();
 
 	void CreateDescriptorSetLayout();
 	void CreateDescriptorSet();
@@ -36,7 +39,7 @@ public:
 	vk::PipelineLayout PipelineLayout;
 
 	vk::DescriptorSetLayout DescriptorSetLayout;
-	vk::DescriptorSet DescriptorSet;
+	PerFrame<vk::DescriptorSet> DescriptorSets;
 
 	Shader VertexShader, FragmentShader;
 
@@ -50,5 +53,5 @@ public:
 		float Radius; // world space
 	} Uniforms;
 
-	Buffer UniformBuffer;
+	PerFrame<Buffer> UniformBuffers;
 };
@@ -17,11 +17,7 @@ float gauss(float x)
 	return powf(E, -0.5f*x*x);
 }
 
-float radius(int i, int j)
-{
-	return sqrtf(float(i) * float(i) + float(j) * float(j));
-}
-
+// Computes the normalized 1D kernel out[0..N], out[0] being the center weight.
 void ComputeGaussKernel(int N, float* out)
 {
 	PROFILE_FUNCTION();
@@ -30,39 +26,12 @@ void ComputeGaussKernel(int N, float* out)
 
 	for (int i = 0; i <= N; i++)
 	{
-		for (int j = 0; j <= N; j++)
-		{
-			float y = gauss(radius(i, j));
-			out[j + i * (N + 1)] = y;
-
-			if (i == 0 && j == 0)
-				sum += y;
-			else if (i != 0 && j != 0)
-				sum += 4.0f * y;
-			else if (i != 0 || j != 0)
-				sum += 2.0f * y;
-		}
+		out[i] = gauss(float(i));
+		sum += (i == 0) ? out[i] : 2.0f * out[i];
 	}
 
 	for (int i = 0; i <= N; i++)
-		for (int j = 0; j <= N; j++)
-			out[j + i * (N + 1)] /= sum;
-
-#if 0
-	for (int i = 0; i <= N; i++)
-	{
-		for (int j = 0; j <= N; j++)
-		{
-			std::cout << out[j + i * (N + 1)] << ", ";
-		}
-
-		std::cout << std::endl;
-	}
-
-	std::cout << sum << std::endl;
-
-	SPDLOG_INFO("");
-#endif
+		out[i] /= sum;
 }
 
 // --------------------------------------------------------------
@@ -81,18 +50,27 @@ void GaussRenderPass::Init()
 	CreateDescriptorSet();
 
 	CreatePipelineLayout();
-	CreatePipeline();
 
 	CreateUniformBuffer();
 
-	UpdateDescriptorSet();
+	// the horizontal pass reads the depth buffer, the vertical one the intermediate target
+	LinearFiltering = true;
+
+	for (vk::Format format : { vk::Format::eD32Sfloat, vk::Format::eR32Sfloat })
+	{
+		const vk::FormatProperties properties = Vulkan.PhysicalDevice.getFormatProperties(format);
+
+		if (!(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear))
+			LinearFiltering = false;
+	}
 
-	ComputeGaussKernel(Uniforms.GaussN, Uniforms.Kernel);
+	UpdateTaps();
 }
 
 void GaussRenderPass::Exit()
 {
-	UniformBuffer.Destroy();
+	for (Buffer& buffer : UniformBuffers)
+		buffer.Destroy();
 
 	Vulkan.Device.destroyPipeline(Pipeline);
 	Vulkan.Device.destroyPipelineLayout(PipelineLayout);
@@ -102,26 +80,42 @@ void GaussRenderPass::Exit()
 	VertexShader.Destroy();
 	FragmentShader.Destroy();
 
-	UniformBufferFullscreen.Destroy();
+	for (Buffer& buffer : UniformBuffersFullscreen)
+		buffer.Destroy();
 }
 
-void GaussRenderPass::Begin()
+void GaussRenderPass::Begin(Direction direction)
 {
-	// update descriptor set
-	UpdateUniforms();
+	// the render graph transitions the source and the target
+	vk::ImageView target;
+
+	if (direction == Horizontal)
+	{
+		// update uniforms and both descriptor sets once per frame
+		UpdateUniforms();
 
-	UpdateDescriptorSet();
+		UpdateDescriptorSet(Horizontal);
+		UpdateDescriptorSet(Vertical);
 
-	vk::RenderingAttachmentInfo smoothedDepthAttachment;
-	smoothedDepthAttachment
+		PushConstants.Direction = glm::vec2(1.0f, 0.0f);
+		target = Renderer.Graph.GetImageView(Renderer.Targets.GaussIntermediate);
+	}
+	else
+	{
+		PushConstants.Direction = glm::vec2(0.0f, 1.0f);
+		target = Renderer.SmoothedDepthBuffer.GPU.ImageView;
+	}
+
+	vk::RenderingAttachmentInfo targetAttachment;
+	targetAttachment
 		.setLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStoreOp(vk::AttachmentStoreOp::eStore)
-		.setImageView(Renderer.SmoothedDepthBuffer.GPU.ImageView)
+		.setImageView(target)
 		.setImageLayout(vk::ImageLayout::eColorAttachmentOptimal);
 
 	vk::RenderingInfo renderingInfo;
 	renderingInfo
-		.setColorAttachments(smoothedDepthAttachment)
+		.setColorAttachments(targetAttachment)
 		.setLayerCount(1)
 		.setRenderArea(vk::Rect2D({ 0, 0 }, Vulkan.SwapchainExtent ))
 		.setViewMask(0);
@@ -138,9 +132,17 @@ void GaussRenderPass::Begin()
 		vk::PipelineBindPoint::eGraphics,
 		PipelineLayout,
 		0,
-		DescriptorSet,
+		DescriptorSets[Vulkan.CurrentFrame][direction],
 		{}
 	);
+
+	Vulkan.CommandBuffer.pushConstants(
+		PipelineLayout,
+		vk::ShaderStageFlagBits::eFragment,
+		0,
+		sizeof(PushConstants),
+		&PushConstants
+	);
 }
 
 void GaussRenderPass::End()
@@ -154,9 +156,11 @@ void GaussRenderPass::RenderUI()
 
 	if (ImGui::SliderInt("Gauss N", &Uniforms.GaussN, 0, MaxKernelSize - 1))
 	{
-		ComputeGaussKernel(Uniforms.GaussN, Uniforms.Kernel);
+		UpdateTaps();
 	}
 
+	ImGui::Text("Taps per pass: %d", Uniforms.NumTaps * 2 - 1);
+
 	ImGui::End();
 }
 
@@ -165,19 +169,22 @@ void GaussRenderPass::RenderUI()
 
 void GaussRenderPass::CreateUniformBuffer()
 {
-	UniformBuffer.Create(
-		sizeof(Uniforms),
-		vk::BufferUsageFlagBits::eUniformBuffer,
-		vk::MemoryPropertyFlagBits::eHostVisible |
-		vk::MemoryPropertyFlagBits::eHostCoherent
-	);
-
-	UniformBufferFullscreen.Create(
-		sizeof(UniformsFullscreen),
-		vk::BufferUsageFlagBits::eUniformBuffer,
-		vk::MemoryPropertyFlagBits::eHostVisible |
-		vk::MemoryPropertyFlagBits::eHostCoherent
-	);
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++)
+	{
+		UniformBuffers[frame].Create(
+			sizeof(Uniforms),
+			vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible |
+			vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+
+		UniformBuffersFullscreen[frame].Create(
+			sizeof(UniformsFullscreen),
+			vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible |
+			vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+	}
 }
 
 void GaussRenderPass::CreateShaders()
@@ -193,9 +200,16 @@ void GaussRenderPass::CreateShaders()
 
 void GaussRenderPass::CreatePipelineLayout()
 {
+	vk::PushConstantRange pushConstantRange;
+	pushConstantRange
+		.setOffset(0)
+		.setSize(sizeof(PushConstants))
+		.setStageFlags(vk::ShaderStageFlagBits::eFragment);
+
 	vk::PipelineLayoutCreateInfo info;
 	info.setSetLayoutCount(1)
-		.setSetLayouts(DescriptorSetLayout);
+		.setSetLayouts(DescriptorSetLayout)
+		.setPushConstantRanges(pushConstantRange);
 
 	PipelineLayout = Vulkan.Device.createPipelineLayout(info);
 }
@@ -294,7 +308,7 @@ void GaussRenderPass::CreatePipeline()
 		.setPViewportState(&viewportState)
 		.setRenderPass(nullptr);
 
-	auto r = Vulkan.Device.createGraphicsPipeline({}, pipelineCreateInfo);
+	auto r = Vulkan.Device.createGraphicsPipeline(Vulkan.PipelineCache, pipelineCreateInfo);
 	HZ_ASSERT(r.result == vk::Result::eSuccess, "Pipeline creation failed!");
 	Pipeline = r.value;
 }
@@ -334,38 +348,95 @@ void GaussRenderPass::CreateDescriptorSetLayout()
 
 void GaussRenderPass::CreateDescriptorSet()
 {
+	std::array<vk::DescriptorSetLayout, 2 * MAX_FRAMES_IN_FLIGHT> layouts;
+	layouts.fill(DescriptorSetLayout);
+
 	vk::DescriptorSetAllocateInfo info;
 	info.setDescriptorPool(Vulkan.DescriptorPool)
-		.setDescriptorSetCount(1)
-		.setSetLayouts(DescriptorSetLayout);
+		.setSetLayouts(layouts);
 
 	auto r = Vulkan.Device.allocateDescriptorSets(info);
-	HZ_ASSERT(r.size() == 1, "allocateDescriptorSets failed!");
-	DescriptorSet = r.front();
+	HZ_ASSERT(r.size() == layouts.size(), "allocateDescriptorSets failed!");
+
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++)
+		DescriptorSets[frame] = { r[2 * frame + 0], r[2 * frame + 1] };
 }
 
 void GaussRenderPass::UpdateUniforms()
 {
+	// the spread may have changed
+	if (MergedTaps != CanMergeTaps())
+		UpdateTaps();
+
 	// copy
-	UniformBuffer.Map(&Uniforms, sizeof(Uniforms));
+	UniformBuffers[Vulkan.CurrentFrame].Map(&Uniforms, sizeof(Uniforms));
 
 	// fullscreen uniforms
 	UniformsFullscreen.TexelWidth = Spread / float(Vulkan.SwapchainExtent.width);
 	UniformsFullscreen.TexelHeight = Spread / float(Vulkan.SwapchainExtent.height);
 
 	// copy
-	UniformBufferFullscreen.Map(&UniformsFullscreen, sizeof(UniformsFullscreen));
+	UniformBuffersFullscreen[Vulkan.CurrentFrame].Map(&UniformsFullscreen, sizeof(UniformsFullscreen));
 }
 
-void GaussRenderPass::UpdateDescriptorSet()
+void GaussRenderPass::UpdateTaps()
 {
+	const int N = Uniforms.GaussN;
+
+	float kernel[MaxKernelSize];
+	ComputeGaussKernel(N, kernel);
+
+	Uniforms.Taps[0] = glm::vec4(0.0f, kernel[0], 0.0f, 0.0f);
+	Uniforms.NumTaps = 1;
+
+	MergedTaps = CanMergeTaps();
+
+	if (!MergedTaps)
+	{
+		for (int i = 1; i <= N; i++)
+			Uniforms.Taps[Uniforms.NumTaps++] = glm::vec4(float(i), kernel[i], 0.0f, 0.0f);
+	}
+	else
+	{
+		// Two neighboring taps i and i + 1 are merged into one fetch between
+		// them, placed such that the linear filter weighs both texels
+		// correctly. This halves the texture fetches of each pass.
+		for (int i = 1; i <= N; i += 2)
+		{
+			const float w0 = kernel[i];
+			const float w1 = (i + 1 <= N) ? kernel[i + 1] : 0.0f;
+			const float offset = (float(i) * w0 + float(i + 1) * w1) / (w0 + w1);
+
+			Uniforms.Taps[Uniforms.NumTaps++] = glm::vec4(offset, w0 + w1, 0.0f, 0.0f);
+		}
+	}
+
+	HZ_ASSERT(Uniforms.NumTaps <= MaxTaps, "Too many taps!");
+}
+
+// A merged fetch interpolates between two texels, so it needs linear filtering
+// and steps of exactly one texel.
+bool GaussRenderPass::CanMergeTaps() const
+{
+	return LinearFiltering && Spread == 1.0f;
+}
+
+void GaussRenderPass::UpdateDescriptorSet(Direction direction)
+{
+	const uint32_t frame = Vulkan.CurrentFrame;
+	vk::DescriptorSet set = DescriptorSets[frame][direction];
+	const bool horizontal = direction == Horizontal;
+	const vk::ImageView sourceView = horizontal ?
+		Renderer.DepthBuffer.GPU.ImageView :
+		Renderer.Graph.GetImageView(Renderer.Targets.GaussIntermediate);
+	const vk::Sampler sourceSampler = horizontal ? Renderer.DepthBuffer.GPU.Sampler : Renderer.Graph.GetSampler();
+
 	// uniforms
 	vk::DescriptorBufferInfo uniformBufferInfo;
 	uniformBufferInfo
-		.setBuffer(UniformBuffer)
+		.setBuffer(UniformBuffers[frame])
 		.setOffset(0)
-		.setRange(offsetof(decltype(Uniforms), Kernel) +
-				  sizeof(float) * (Uniforms.GaussN + 1) * (Uniforms.GaussN + 1));
+		.setRange(offsetof(decltype(Uniforms), Taps) + sizeof(glm::vec4) * Uniforms.NumTaps);
 
 	vk::WriteDescriptorSet writeUniformBuffer;
 	writeUniformBuffer
@@ -374,14 +445,14 @@ void GaussRenderPass::UpdateDescriptorSet()
 		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 		.setDstArrayElement(0)
 		.setDstBinding(0)
-		.setDstSet(DescriptorSet);
+		.setDstSet(set);
 
 	// depth
 	vk::DescriptorImageInfo depthImageInfo;
 	depthImageInfo
-		.setImageView(Renderer.DepthBuffer.GPU.ImageView)
+		.setImageView(sourceView)
 		.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-		.setSampler(Renderer.DepthBuffer.GPU.Sampler);
+		.setSampler(sourceSampler);
 
 	vk::WriteDescriptorSet writeDepthSampler;
 	writeDepthSampler
@@ -390,12 +461,12 @@ void GaussRenderPass::UpdateDescriptorSet()
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
 		.setDstArrayElement(0)
 		.setDstBinding(1)
-		.setDstSet(DescriptorSet);
+		.setDstSet(set);
 
 	// uniforms fullscreen
 	vk::DescriptorBufferInfo bufferFullscreenInfo;
 	bufferFullscreenInfo
-		.setBuffer(UniformBufferFullscreen)
+		.setBuffer(UniformBuffersFullscreen[frame])
 		.setOffset(0)
 		.setRange(VK_WHOLE_SIZE);
 
@@ -406,7 +477,7 @@ void GaussRenderPass::UpdateDescriptorSet()
 		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 		.setDstArrayElement(0)
 		.setDstBinding(2)
-		.setDstSet(DescriptorSet);
+		.setDstSet(set);
 
 
 	std::array<vk::WriteDescriptorSet, 3> writes = {
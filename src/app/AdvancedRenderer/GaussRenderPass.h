@@ -2,6 +2,9 @@
 
 #include <engine/renderer/objects/Shader.h>
 #include <engine/renderer/objects/Buffer.h>
+#include <engine/renderer/objects/PerFrame.h>
+
+#include "BilateralBuffer.h"
 
 class AdvancedRenderer;
 
@@ -12,10 +15,22 @@ class GaussRenderPass
 public:
 	GaussRenderPass(AdvancedRenderer& renderer);
 
+	// The blur is separable and done in two passes: horizontally from the
+	// depth buffer into an intermediate target, then vertically from there
+	// into the smoothed depth buffer.
+	enum Direction
+	{
+		Horizontal = 0,
+		Vertical = 1,
+	};
+
 	void Init();
 	void Exit();
 
-	void Begin();
+	// Called by the renderer after Init(), concurrently with the other passes.
+	void CreatePipeline();
+
+	void Begin(Direction direction);
 	void End();
 
 	void RenderUI();
@@ -25,31 +40,43 @@ private:
 	void CreateShaders();
 
 	void CreatePipelineLayout();
-	void CreatePipeline();
 
 	void CreateDescriptorSetLayout();
 	void CreateDescriptorSet();
 
-	void UpdateDescriptorSet();
+	void UpdateDescriptorSet(Direction direction);
 	void UpdateUniforms();
+	void UpdateTaps();
+	bool CanMergeTaps() const;
 
 private:
 	constexpr static int MaxKernelSize = 32;
 
+	// center tap plus one tap per neighboring texel, or per pair of them if
+	// they are merged into one linear fetch
+	constexpr static int MaxTaps = MaxKernelSize;
+
 	struct
 	{
 		int GaussN = 8;
-		float _unused[3];
-		float Kernel[MaxKernelSize * MaxKernelSize];
+		int NumTaps;
+		float _unused[2];
+		glm::vec4 Taps[MaxTaps]; // x: offset in texels, y: weight
 	} Uniforms;
 
-	Buffer UniformBuffer;
+	PerFrame<Buffer> UniformBuffers;
 
 	vk::Pipeline Pipeline;
 	vk::PipelineLayout PipelineLayout;
 
 	vk::DescriptorSetLayout DescriptorSetLayout;
-	vk::DescriptorSet DescriptorSet;
+	// per frame in flight and direction
+	PerFrame<std::array<vk::DescriptorSet, 2>> DescriptorSets;
+
+	struct
+	{
+		glm::vec2 Direction;
+	} PushConstants;
 
 	Shader VertexShader, FragmentShader;
 
@@ -61,7 +88,10 @@ private:
 		float TexelHeight;
 	} UniformsFullscreen;
 
-	Buffer UniformBufferFullscreen;
+	PerFrame<Buffer> UniformBuffersFullscreen;
 
 	float Spread = 1.0f;
+
+	bool LinearFiltering = false; // of the formats of both sources
+	bool MergedTaps = false;
 };
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "app/Dataset.h"
+
+// What the renderer holds, for the UI and the benchmark report.
+struct MemoryUsage
+{
+	struct RenderTarget
+	{
+		const char* Name;
+		vk::DeviceSize HostBytes;
+		vk::DeviceSize DeviceBytes;
+	};
+
+	DatasetMemory Frames;
+	std::vector<RenderTarget> RenderTargets;
+	vk::DeviceSize TransientBytes = 0; // device, of the render graph
+	vk::DeviceSize ParticleCacheBytes = 0; // device, resident frames
+
+	vk::DeviceSize GetRenderTargetHostBytes() const
+	{
+		vk::DeviceSize bytes = 0;
+		for (const RenderTarget& target : RenderTargets)
+			bytes += target.HostBytes;
+		return bytes;
+	}
+
+	vk::DeviceSize GetRenderTargetDeviceBytes() const
+	{
+		vk::DeviceSize bytes = 0;
+		for (const RenderTarget& target : RenderTargets)
+			bytes += target.DeviceBytes;
+		return bytes;
+	}
+};
@@ -0,0 +1,176 @@
+#include <engine/hzpch.h>
+
+#include "ParticleBufferCache.h"
+
+#include <engine/renderer/Renderer.h>
+
+#include "app/Dataset.h"
+
+// --------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+void ParticleBufferCache::Init(Dataset* dataset, vk::DeviceSize budget, uint32_t maxPrefetch)
+{
+	m_Dataset = dataset;
+	m_Budget = budget;
+	m_MaxPrefetch = maxPrefetch;
+
+	m_StagingFrameSize = (1 + m_MaxPrefetch) * m_Dataset->MaxParticles * sizeof(Particle);
+	const vk::DeviceSize stagingSize = MAX_FRAMES_IN_FLIGHT * m_StagingFrameSize;
+
+	m_Staging.Create(
+		stagingSize,
+		vk::BufferUsageFlagBits::eTransferSrc,
+		vk::MemoryPropertyFlagBits::eHostVisible |
+		vk::MemoryPropertyFlagBits::eHostCoherent
+	);
+
+	m_StagingMemory = m_Staging.Allocation.Mapped;
+}
+
+void ParticleBufferCache::Exit()
+{
+	for (auto& [frame, entry] : m_Entries)
+		entry.Buffer.Destroy();
+
+	m_Entries.clear();
+	DestroyRetired(true);
+	m_ResidentSize = 0;
+
+	m_StagingMemory = nullptr;
+	m_Staging.Destroy();
+}
+
+void ParticleBufferCache::BeginFrame()
+{
+	m_CurrentUse++;
+
+	// the staging region of this frame in flight is free again
+	m_StagingBegin = Vulkan.CurrentFrame * m_StagingFrameSize;
+	m_StagingOffset = 0;
+
+	DestroyRetired(false);
+}
+
+vk::Buffer ParticleBufferCache::Get(vk::CommandBuffer& cmd, uint32_t frame)
+{
+	auto it = m_Entries.find(frame);
+
+	if (it == m_Entries.end())
+	{
+		if (m_Dataset->Frames[frame].m_Particles.empty())
+			return nullptr;
+
+		// the current frame is always uploaded, even if it exceeds the budget
+		MakeRoom(m_Dataset->Frames[frame].m_Particles.size() * sizeof(Particle));
+		Upload(cmd, frame);
+
+		it = m_Entries.find(frame);
+	}
+
+	it->second.LastUse = m_CurrentUse;
+
+	return it->second.Buffer;
+}
+
+void ParticleBufferCache::Prefetch(vk::CommandBuffer& cmd, uint32_t frame)
+{
+	if (frame >= m_Dataset->Frames.size() || IsResident(frame))
+		return;
+
+	const vk::DeviceSize size = m_Dataset->Frames[frame].m_Particles.size() * sizeof(Particle);
+
+	if (size == 0 || m_StagingOffset + size > m_StagingFrameSize)
+		return;
+
+	if (!MakeRoom(size))
+		return;
+
+	Upload(cmd, frame);
+}
+
+// --------------------------------------------------------------------
+// PRIVATE HELPER FUNCTIONS
+
+void ParticleBufferCache::Upload(vk::CommandBuffer& cmd, uint32_t frame)
+{
+	const std::vector<Particle>& particles = m_Dataset->Frames[frame].m_Particles;
+	const vk::DeviceSize size = particles.size() * sizeof(Particle);
+
+	HZ_ASSERT(m_StagingOffset + size <= m_StagingFrameSize, "Staging buffer exceeded!");
+
+	Entry& entry = m_Entries[frame];
+	entry.LastUse = m_CurrentUse;
+	entry.Buffer.Create(
+		size,
+		vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eDeviceLocal
+	);
+
+	m_ResidentSize += size;
+	m_NumUploads++;
+
+	// stage and record the copy
+	memcpy(m_StagingMemory + m_StagingBegin + m_StagingOffset, particles.data(), size);
+
+	vk::BufferCopy region{ m_StagingBegin + m_StagingOffset, 0, size };
+	cmd.copyBuffer(m_Staging, entry.Buffer, region);
+
+	m_StagingOffset += size;
+
+	vk::BufferMemoryBarrier barrier;
+	barrier
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead)
+		.setBuffer(entry.Buffer)
+		.setOffset(0)
+		.setSize(size);
+
+	cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+						vk::PipelineStageFlagBits::eVertexInput,
+						{},
+						{},
+						barrier,
+						{});
+}
+
+bool ParticleBufferCache::MakeRoom(vk::DeviceSize size)
+{
+	while (m_ResidentSize + size > m_Budget)
+	{
+		auto lru = m_Entries.end();
+
+		for (auto it = m_Entries.begin(); it != m_Entries.end(); ++it)
+		{
+			if (lru == m_Entries.end() || it->second.LastUse < lru->second.LastUse)
+				lru = it;
+		}
+
+		if (lru == m_Entries.end() || lru->second.LastUse == m_CurrentUse)
+			return false;
+
+		// the buffer may still be read by a frame in flight
+		m_ResidentSize -= lru->second.Buffer.Size;
+		m_Retired.push_back(lru->second);
+		m_Entries.erase(lru);
+	}
+
+	return true;
+}
+
+void ParticleBufferCache::DestroyRetired(bool all)
+{
+	// BeginFrame() runs after the frame MAX_FRAMES_IN_FLIGHT uses ago has finished
+	auto finished = [&](const Entry& entry)
+	{
+		return all || entry.LastUse + MAX_FRAMES_IN_FLIGHT <= m_CurrentUse;
+	};
+
+	for (Entry& entry : m_Retired)
+	{
+		if (finished(entry))
+			entry.Buffer.Destroy();
+	}
+
+	m_Retired.erase(std::remove_if(m_Retired.begin(), m_Retired.end(), finished), m_Retired.end());
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <engine/renderer/objects/Buffer.h>
+
+class Dataset;
+
+/*
+* Device-local particle buffers keyed by dataset frame index.
+*
+* Frames stay resident until the VRAM budget is exceeded, then the least
+* recently used ones are evicted. Uploads are recorded into the frame's command
+* buffer through a persistently mapped staging buffer that holds up to
+* 1 + MaxPrefetch frames per frame in flight, so they never block.
+*
+* Evicted buffers may still be read by a frame in flight, they are destroyed
+* once that frame has finished.
+*/
+class ParticleBufferCache
+{
+public:
+	void Init(Dataset* dataset, vk::DeviceSize budget, uint32_t maxPrefetch);
+	void Exit();
+
+	// Must be called once per rendered frame before any Get or Prefetch, after
+	// Renderer::Begin() has waited for the frame in flight.
+	void BeginFrame();
+
+	// Returns the buffer holding the particles of the given frame. Records an
+	// upload into cmd if the frame is not resident.
+	vk::Buffer Get(vk::CommandBuffer& cmd, uint32_t frame);
+
+	// Uploads the given frame ahead of time. Does nothing if it is resident, if
+	// the staging space of this frame is used up or if the budget cannot be
+	// kept without evicting frames used in this frame.
+	void Prefetch(vk::CommandBuffer& cmd, uint32_t frame);
+
+	bool IsResident(uint32_t frame) const { return m_Entries.count(frame) > 0; }
+
+	void SetBudget(vk::DeviceSize budget) { m_Budget = budget; }
+	vk::DeviceSize GetBudget() const { return m_Budget; }
+	vk::DeviceSize GetResidentSize() const { return m_ResidentSize; }
+	size_t GetNumResident() const { return m_Entries.size(); }
+	size_t GetNumUploads() const { return m_NumUploads; }
+
+private:
+	struct Entry
+	{
+		Buffer Buffer;
+		uint64_t LastUse;
+	};
+
+	// destroys retired buffers whose last frame has finished
+	void DestroyRetired(bool all);
+
+	void Upload(vk::CommandBuffer& cmd, uint32_t frame);
+
+	// Evicts least recently used frames until size fits into the budget.
+	// Frames used in the current frame are never evicted, their buffers are
+	// referenced by the command buffer being recorded.
+	bool MakeRoom(vk::DeviceSize size);
+
+private:
+	Dataset* m_Dataset = nullptr;
+
+	std::unordered_map<uint32_t, Entry> m_Entries;
+	std::vector<Entry> m_Retired;
+	vk::DeviceSize m_Budget = 0;
+	vk::DeviceSize m_ResidentSize = 0;
+
+	// one region of m_StagingFrameSize per frame in flight
+	Buffer m_Staging;
+	uint8_t* m_StagingMemory = nullptr;
+	vk::DeviceSize m_StagingFrameSize = 0;
+	vk::DeviceSize m_StagingBegin = 0;
+	vk::DeviceSize m_StagingOffset = 0; // relative to m_StagingBegin
+
+	uint32_t m_MaxPrefetch = 0;
+
+	uint64_t m_CurrentUse = 0;
+	size_t m_NumUploads = 0;
+};
@@ -5,46 +5,56 @@
 #include "app/StackArray.h"
 #include "app/Dataset.h"
 
-#include <engine/renderer/Renderer.h>
+#include <engine/utils/Log.h>
 #include <engine/utils/PerformanceTimer.h>
+#include <engine/utils/Statistics.h>
+
+#include <glm/gtc/packing.hpp>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#include <emmintrin.h>
+	#define RAY_MARCHER_SSE2 1
+#else
+	#define RAY_MARCHER_SSE2 0
+#endif
 
 // ---------------------------------------------------------
 
 //#define MAX_NEIGHBORS 3072
 #define MAX_NEIGHBORS 2*4096
 
+// maximum number of pixels handed to a worker at once
+#define MAX_RUN_LENGTH 64
+
+// of the iso density, above it a step also evaluates the gradient for the normal
+constexpr float NearSurfaceDensity = 0.5f;
+
 struct ThreadLocals
 {
+	// relative extended neighbor positions for WPCA
 	uint32_t NumNeighborsExt;
-	glm::vec3 NeighborPositions_AbsExt[MAX_NEIGHBORS];
+	alignas(64) float NeighborX_RelExt[MAX_NEIGHBORS];
+	alignas(64) float NeighborY_RelExt[MAX_NEIGHBORS];
+	alignas(64) float NeighborZ_RelExt[MAX_NEIGHBORS];
 
+	// relative neighbor positions in SoA layout for the batch kernel evaluations
 	uint32_t NumNeighbors;
-	glm::vec3 NeighborPositions_Rel[MAX_NEIGHBORS];
+	uint32_t NumWPCACalls; // for the cost recording
+	alignas(64) float NeighborX_Rel[MAX_NEIGHBORS];
+	alignas(64) float NeighborY_Rel[MAX_NEIGHBORS];
+	alignas(64) float NeighborZ_Rel[MAX_NEIGHBORS];
+
+	void PushNeighbor(const glm::vec3& r)
+	{
+		NeighborX_Rel[NumNeighbors] = r.x;
+		NeighborY_Rel[NumNeighbors] = r.y;
+		NeighborZ_Rel[NumNeighbors] = r.z;
+		NumNeighbors++;
+	}
 };
 
 // ---------------------------------------------------------
 
-glm::vec3 eigenToGlm(const Eigen::Vector3f& v)
-{
-	return glm::vec3(v.x(), v.y(), v.z());
-}
-
-Eigen::Vector3f glmToEigen(const glm::vec3& v)
-{
-	return Eigen::Vector3f(v.x, v.y, v.z);
-}
-
-Eigen::Matrix3f glmToEigen(const glm::mat3& m)
-{
-	Eigen::Matrix3f r;
-
-	r.col(0) = glmToEigen(m[0]);
-	r.col(1) = glmToEigen(m[1]);
-	r.col(2) = glmToEigen(m[2]);
-
-	return r;
-}
-
 // https://github.com/erich666/GraphicsGems/blob/master/gems/RayBox.c
 
 // https://gist.github.com/DomNomNom/46bb1ce47f68d255fd5d
@@ -61,10 +71,48 @@ glm::vec3 intersectAABB(glm::vec3 rayOrigin, glm::vec3 rayDir, glm::vec3 boxMin,
 	return t >= 0.0f ? rayOrigin + rayDir * t : rayOrigin;
 };
 
+// Octahedral normal encoding, packed as two 16 bit snorm values for the
+// R16G16Snorm normals buffer. Decoded in composition.frag.
+// https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+uint32_t encodeNormal(glm::vec3 n)
+{
+	const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+
+	// degenerate gradients
+	if (!(l1 > 0.0f))
+		return glm::packSnorm2x16(glm::vec2(0.0f));
+
+	n /= l1;
+
+	glm::vec2 e(n.x, n.y);
+
+	if (n.z < 0.0f)
+	{
+		e.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		e.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return glm::packSnorm2x16(e);
+}
+
+glm::vec3 decodeNormal(uint32_t packed)
+{
+	const glm::vec2 e = glm::unpackSnorm2x16(packed);
+
+	glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	const float t = std::max(-n.z, 0.0f);
+
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+
+	return glm::normalize(n);
+}
+
 // ---------------------------------------------------------
 
-RayMarcher::RayMarcher() :
-	m_ThreadPool(std::thread::hardware_concurrency() - 1, sizeof(ThreadLocals))
+RayMarcher::RayMarcher(uint32_t numThreads) :
+	m_ThreadPool(numThreads ? numThreads : std::max(std::thread::hardware_concurrency(), 2u) - 1,
+				 sizeof(ThreadLocals))
 {
 }
 
@@ -74,26 +122,41 @@ void RayMarcher::Exit()
 }
 
 void RayMarcher::Prepare(const VisualizationSettings& settings,
-						 const CameraController3D& camera,
+						 const glm::vec3& cameraPosition,
+						 const glm::mat4& invProjectionView,
+						 uint32_t width,
+						 uint32_t height,
 						 Dataset* dataset,
-						 glm::vec4* positions,
-						 glm::vec4* normals,
+						 float* hitDistances,
+						 uint32_t* normals,
 						 float* depth)
 {
+	// memoized anisotropy depends on the particles and the WPCA parameters
+	const bool invalidateAnisotropy =
+		dataset != m_Dataset ||
+		settings.Frame != m_Settings.Frame ||
+		settings.k_n != m_Settings.k_n ||
+		settings.k_r != m_Settings.k_r ||
+		settings.k_s != m_Settings.k_s ||
+		settings.N_eps != m_Settings.N_eps;
+
 	m_Settings = settings;
 	m_Dataset = dataset;
 
-	m_Width = Vulkan.SwapchainExtent.width;
-	m_Height = Vulkan.SwapchainExtent.height;
-	m_TwoWidthInv = 2.0f / float(Vulkan.SwapchainExtent.width);
-	m_TwoHeightInv = 2.0f / float(Vulkan.SwapchainExtent.height);
+	if (invalidateAnisotropy)
+		m_AnisotropyCache.Reset(m_Dataset->Frames[m_Settings.Frame].m_DensityGrid.m_Nodes.size());
+
+	m_Width = width;
+	m_Height = height;
+	m_TwoWidthInv = 2.0f / float(width);
+	m_TwoHeightInv = 2.0f / float(height);
 
-	m_Positions = positions;
+	m_HitDistances = hitDistances;
 	m_Normals = normals;
 	m_Depth = depth;
 
-	m_CameraPosition = camera.Position;
-	m_InvProjectionView = camera.Camera.GetInvProjectionView();
+	m_CameraPosition = cameraPosition;
+	m_InvProjectionView = invProjectionView;
 
 	m_IsotropicKernel = CubicSplineKernel(m_Dataset->ParticleRadius);
 	m_AnisotropicKernel = AnisotropicKernel(m_Dataset->ParticleRadius);
@@ -101,127 +164,380 @@ void RayMarcher::Prepare(const VisualizationSettings& settings,
 
 void RayMarcher::Start()
 {
-	auto f = m_Settings.EnableAnisotropy ?
-		&RayMarcher::PerPixel_Anisotropic :
-		&RayMarcher::PerPixel_Isotropic;
+	CollectActivePixels();
+
+	MarchFunction f;
+
+	if (m_Settings.EnableAnisotropy && m_Settings.ApproximateAnisotropy)
+	{
+		f = m_Settings.EnableGridSkipping ?
+			SelectMarch<true, true, true>() :
+			SelectMarch<true, false, true>();
+	}
+	else if (m_Settings.EnableAnisotropy)
+	{
+		f = m_Settings.EnableGridSkipping ?
+			SelectMarch<true, true, false>() :
+			SelectMarch<true, false, false>();
+	}
+	else
+	{
+		f = m_Settings.EnableGridSkipping ?
+			SelectMarch<false, true, false>() :
+			SelectMarch<false, false, false>();
+	}
 
 	m_ThreadPool.SetFunction(
-		std::bind(f, this, std::placeholders::_1, std::placeholders::_2));
+		std::bind(f, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 
-	m_ThreadPool.Start(m_Width * m_Height);
+	m_ThreadPool.Start(uint32_t(m_ActiveRuns.size()));
 }
 
-void RayMarcher::WPCA(const glm::vec3& particle,
-					  const glm::vec3* neighborPositions,
-					  uint32_t N,
-					  glm::mat3& G,
-					  bool verbose)
+void RayMarcher::ResetAnisotropyCache()
 {
-	/* Agenda of this function:
-	* 
-	* - get neighbors in extended neighborhood
-	* - compute weighted mean of neighbors
-	* - construct weighted covariance matrix C of neighbor positions
-	* - compute eigenvalues and -vectors of C
-	* 
-	*/
+	m_AnisotropyCache.Reset(m_Dataset->Frames[m_Settings.Frame].m_DensityGrid.m_Nodes.size());
+}
 
-	// get neighbors
-	/*const auto& particles = Dataset->Frames[g_VisualizationSettings.Frame];
-	auto neighborIndices = Dataset->GetNeighborsExt(particle, g_VisualizationSettings.Frame);
-	const auto N = neighborIndices.size();
-	std::vector<glm::vec3> neighborPositions(N);
+RayMarcher::ImageDifference RayMarcher::CompareWithExact()
+{
+	HZ_ASSERT(IsDone(), "The ray marcher is still running!");
 
-	for (size_t i = 0; i < N; i++)
-	neighborPositions[i] = particles[neighborIndices[i]];*/
+	const uint32_t numPixels = m_Width * m_Height;
+	const VisualizationSettings settings = m_Settings;
 
-	// compute weights and mean
-	StackArray<float, MAX_NEIGHBORS> weights(N);
+	auto march = [this]()
+	{
+		const auto begin = std::chrono::high_resolution_clock::now();
 
-	float weightSum = 0.0f;
-	glm::vec3 mean(0);
-	CubicKernel kernel(m_Dataset->ParticleRadiusExt);
+		Start();
+		while (!IsDone())
+			std::this_thread::yield();
 
-	for (size_t j = 0; j < N; j++)
-	{
-		const glm::vec3& x_j = neighborPositions[j];
-		glm::vec3 r = x_j - particle;
+		const auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<float, std::milli>(end - begin).count();
+	};
 
-		float w = kernel.W(r);
-		weights[j] = w;
+	// approximate, starting from an empty table
+	m_Settings.EnableAnisotropy = true;
+	m_Settings.ApproximateAnisotropy = true;
+	m_AnisotropyCache.Reset(m_Dataset->Frames[m_Settings.Frame].m_DensityGrid.m_Nodes.size());
+	const float approximateTime = march();
 
-		weightSum += w;
-		mean += w * x_j;
-	}
+	const std::vector<float> approximateHitDistances(m_HitDistances, m_HitDistances + numPixels);
+	const std::vector<uint32_t> approximateNormals(m_Normals, m_Normals + numPixels);
 
-	const float invWeightSum = 1.0f / weightSum;
-	mean *= invWeightSum;
+	// exact
+	m_Settings.ApproximateAnisotropy = false;
+	const float exactTime = march();
 
-	// compute C
-	Eigen::Matrix3f C;
-	C.setZero();
+	ImageDifference difference = CompareImages(approximateHitDistances.data(), approximateNormals.data(),
+											   m_HitDistances, m_Normals,
+											   m_Depth, numPixels, m_Dataset->ParticleRadius);
+
+	difference.ApproximateTime = approximateTime;
+	difference.ExactTime = exactTime;
+
+	// keep the approximate image
+	std::copy(approximateHitDistances.begin(), approximateHitDistances.end(), m_HitDistances);
+	std::copy(approximateNormals.begin(), approximateNormals.end(), m_Normals);
+
+	m_Settings = settings;
+
+	return difference;
+}
+
+RayMarcher::ImageDifference RayMarcher::CompareImages(const float* hitDistancesA,
+													 const uint32_t* normalsA,
+													 const float* hitDistancesB,
+													 const uint32_t* normalsB,
+													 const float* depth,
+													 uint32_t numPixels,
+													 float particleRadius)
+{
+	ImageDifference difference = {};
 
-	for (size_t j = 0; j < N; j++)
+	uint32_t numActive = 0;
+	uint32_t numMismatches = 0;
+	uint32_t numBothHit = 0;
+
+	for (uint32_t i = 0; i < numPixels; i++)
 	{
-		const glm::vec3& x_j = neighborPositions[j];
+		if (depth[i] == 1.0f)
+			continue;
+
+		numActive++;
+
+		const bool hitA = hitDistancesA[i] != 0.0f;
+		const bool hitB = hitDistancesB[i] != 0.0f;
+
+		if (hitA != hitB)
+		{
+			numMismatches++;
+			continue;
+		}
+
+		if (!hitA)
+			continue;
+
+		numBothHit++;
 
-		Eigen::Vector3f x = glmToEigen(x_j - mean);
-		C += weights[j] * x * x.transpose();
+		// both hits lie on the same ray
+		const float positionError = std::abs(hitDistancesA[i] - hitDistancesB[i]) / particleRadius;
+		const float normalError = glm::degrees(glm::acos(glm::clamp(
+			glm::dot(decodeNormal(normalsA[i]), decodeNormal(normalsB[i])), -1.0f, 1.0f)));
+
+		difference.MeanPositionError += positionError;
+		difference.MaxPositionError = std::max(difference.MaxPositionError, positionError);
+
+		// normals of degenerate gradients are NaN
+		if (!std::isnan(normalError))
+		{
+			difference.MeanNormalError += normalError;
+			difference.MaxNormalError = std::max(difference.MaxNormalError, normalError);
+		}
 	}
 
-	C *= invWeightSum;
+	if (numActive > 0)
+		difference.HitMismatch = float(numMismatches) / float(numActive);
 
-	if (verbose)
+	if (numBothHit > 0)
 	{
-		std::cout << "C:" << std::endl << C << std::endl;
+		difference.MeanPositionError /= float(numBothHit);
+		difference.MeanNormalError /= float(numBothHit);
 	}
 
-	// eigendecomposition
-	Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> solver;
-	solver.computeDirect(C);
+	return difference;
+}
+
+std::vector<RayMarcher::ScalingResult> RayMarcher::MeasureScaling()
+{
+	HZ_ASSERT(IsDone(), "The ray marcher is still running!");
+
+	const uint32_t numThreads = GetNumThreads();
+	const uint32_t maxThreads = GetMaxThreads();
+
+	std::vector<uint32_t> counts;
+	for (uint32_t n = 1; n < maxThreads; n *= 2)
+		counts.push_back(n);
+	counts.push_back(maxThreads);
+
+	std::vector<ScalingResult> results;
+
+	for (uint32_t n : counts)
+	{
+		SetNumThreads(n);
+		ResetAnisotropyCache();
+
+		Start();
+		while (!IsDone())
+			std::this_thread::yield();
+
+		const ThreadPool::JobStats stats = m_ThreadPool.GetJobStats();
+
+		ScalingResult& result = results.emplace_back();
+		result.NumThreads = n;
+		result.Time = float(1e3 * stats.WallTime);
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			const float busy = float(1e3 * stats.BusyTime[i]);
 
-	if (solver.info() != Eigen::Success)
+			result.BusyTime.push_back(busy);
+			result.IdleTime.push_back(std::max(result.Time - busy, 0.0f));
+			result.NumChunks.push_back(stats.NumChunks[i]);
+		}
+	}
+
+	for (ScalingResult& result : results)
 	{
-		SPDLOG_ERROR("Eigen decomposition failed!");
-		return;
+		result.Speedup = result.Time > 0.0f ? results.front().Time / result.Time : 0.0f;
+		result.Efficiency = result.Speedup / float(result.NumThreads);
 	}
 
-	// sort eigenvalues
-	Eigen::Vector3f Sigma = solver.eigenvalues();
-	Eigen::Matrix3f R = solver.eigenvectors();
+	SetNumThreads(numThreads);
+
+	return results;
+}
+
+void RayMarcher::CollectActivePixels()
+{
+	PROFILE_FUNCTION();
+
+	const uint32_t numPixels = m_Width * m_Height;
 
-#if 0
-	// No need to sort. Determining maximum eigenvalue is sufficient.
-	for (uint32_t i = 0; i < 3; i++)
+	// background pixels are never touched by the workers
+	std::memset(m_HitDistances, 0, numPixels * sizeof(float));
+	std::memset(m_Normals, 0, numPixels * sizeof(uint32_t));
+
+	if (m_RecordCost)
+		m_Cost.assign(numPixels, RayCost{});
+	else
+		m_Cost.clear();
+
+	m_ActiveRuns.clear();
+
+	// A pixel is active if its depth is not 1. Blocks of 16 pixels are
+	// compared at once, so that uniform blocks (all background or all
+	// covered) are handled without looking at single pixels.
+	uint32_t runBegin = 0;
+	bool inRun = false;
+	uint32_t i = 0;
+
+#if RAY_MARCHER_SSE2
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (; i + 16 <= numPixels; i += 16)
 	{
-		for (uint32_t j = 0; j < 3 - i - 1; j++)
+		const float* depth = m_Depth + i;
+
+		const uint32_t mask =
+			(_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(depth +  0), one)) <<  0) |
+			(_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(depth +  4), one)) <<  4) |
+			(_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(depth +  8), one)) <<  8) |
+			(_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(depth + 12), one)) << 12);
+
+		if (mask == 0 && !inRun)
+			continue;
+
+		if (mask == 0xFFFF && inRun)
+			continue;
+
+		for (uint32_t j = 0; j < 16; j++)
 		{
-			if (Sigma[j] < Sigma[j + 1])
-			{
-				const float tmp = Sigma(j);
-				Sigma(j) = Sigma(j + 1);
-				Sigma(j + 1) = tmp;
+			const bool active = (mask >> j) & 1;
 
-				const Eigen::Vector3f tmp2 = R.col(j);
-				R.col(j) = R.col(j + 1);
-				R.col(j + 1) = tmp2;
+			if (active && !inRun)
+			{
+				runBegin = i + j;
+				inRun = true;
+			}
+			else if (!active && inRun)
+			{
+				AddActiveRun(runBegin, i + j);
+				inRun = false;
 			}
 		}
 	}
 #endif
 
-#if 0
-	const size_t j = 1;
+	for (; i < numPixels; i++)
+	{
+		const bool active = m_Depth[i] != 1.0f;
+
+		if (active && !inRun)
+		{
+			runBegin = i;
+			inRun = true;
+		}
+		else if (!active && inRun)
+		{
+			AddActiveRun(runBegin, i);
+			inRun = false;
+		}
+	}
 
-	const float tmp = Sigma(j);
-	Sigma(j) = Sigma(j + 1);
-	Sigma(j + 1) = tmp;
+	if (inRun)
+		AddActiveRun(runBegin, numPixels);
 
-	const Eigen::Vector3f tmp2 = R.col(j);
-	R.col(j) = R.col(j + 1);
-	R.col(j + 1) = tmp2;
-#endif
+	// statistics
+	uint32_t numActive = 0;
+	for (const PixelRun& run : m_ActiveRuns)
+		numActive += run.End - run.Begin;
+
+	GlobalStatistics.Sample("Active pixels [%]", 100.0f * float(numActive) / float(numPixels));
+}
 
+void RayMarcher::AddActiveRun(uint32_t begin, uint32_t end)
+{
+	// split long runs, so that the workers stay balanced
+	for (; begin < end; begin += MAX_RUN_LENGTH)
+		m_ActiveRuns.push_back({ begin, std::min(begin + MAX_RUN_LENGTH, end) });
+}
+
+void RayMarcher::WPCA(const float* x,
+					  const float* y,
+					  const float* z,
+					  uint32_t N,
+					  glm::mat3& G,
+					  float& detG)
+{
+	/* Agenda of this function:
+	* 
+	* - compute weighted mean of neighbors
+	* - construct weighted covariance matrix C of neighbor positions
+	* - compute eigenvalues and -vectors of C
+	* - clamp eigenvalues and assemble G
+	*/
+
+	const SymmetricMatrix3 C = ComputeCovariance(x, y, z, N);
+
+	// eigendecomposition, eigenvalues are sorted ascending
+	glm::vec3 Sigma;
+	glm::mat3 R;
+	SolveSymmetricEigen(C, Sigma, R);
+
+	ComputeG(Sigma, R, N, G, detG);
+}
+
+SymmetricMatrix3 RayMarcher::ComputeCovariance(const float* x, const float* y, const float* z, uint32_t N) const
+{
+	// Neighbor positions are given relative to the sample in SoA layout, so
+	// that the accumulation loops can be vectorized.
+
+	// compute weights and mean
+	StackArray<float, MAX_NEIGHBORS> weights(N);
+
+	const float h = m_Dataset->ParticleRadiusExt;
+	const float h_inv = 1.0f / h;
+
+	float weightSum = 0.0f;
+	float meanX = 0.0f, meanY = 0.0f, meanZ = 0.0f;
+
+	for (uint32_t j = 0; j < N; j++)
+	{
+		// CubicKernel::W
+		const float k = glm::sqrt(x[j] * x[j] + y[j] * y[j] + z[j] * z[j]) * h_inv;
+		const float w = k < 1.0f ? 1.0f - k * k * k : 0.0f;
+		weights[j] = w;
+
+		weightSum += w;
+		meanX += w * x[j];
+		meanY += w * y[j];
+		meanZ += w * z[j];
+	}
+
+	const float invWeightSum = 1.0f / weightSum;
+	meanX *= invWeightSum;
+	meanY *= invWeightSum;
+	meanZ *= invWeightSum;
+
+	// compute C
+	SymmetricMatrix3 C = {};
+
+	for (uint32_t j = 0; j < N; j++)
+	{
+		const float w = weights[j];
+		const float dx = x[j] - meanX;
+		const float dy = y[j] - meanY;
+		const float dz = z[j] - meanZ;
+
+		C.xx += w * dx * dx;
+		C.xy += w * dx * dy;
+		C.xz += w * dx * dz;
+		C.yy += w * dy * dy;
+		C.yz += w * dy * dz;
+		C.zz += w * dz * dz;
+	}
+
+	C.xx *= invWeightSum; C.xy *= invWeightSum; C.xz *= invWeightSum;
+	C.yy *= invWeightSum; C.yz *= invWeightSum;
+	C.zz *= invWeightSum;
+
+	return C;
+}
+
+void RayMarcher::ComputeG(glm::vec3 Sigma, const glm::mat3& R, uint32_t N, glm::mat3& G, float& detG) const
+{
 	// prevent extreme deformations for singular matrices
 	// eq. 15 [YT13]
 	const float k_n = m_Settings.k_n;
@@ -230,128 +546,158 @@ void RayMarcher::WPCA(const glm::vec3& particle,
 	const uint32_t N_eps = m_Settings.N_eps;
 
 	if (N <= N_eps)
-		Sigma.setConstant(k_n);
+		Sigma = glm::vec3(k_n);
 	else
-	{
-		const float MINIMUM = std::max(Sigma[0], std::max(Sigma[1], Sigma[2])) / k_r;
-
-		for (size_t k = 0; k < Sigma.size(); k++)
-			Sigma[k] = std::max(Sigma[k], MINIMUM);
-
-		Sigma *= k_s;
-	}
+		Sigma = k_s * glm::max(Sigma, glm::vec3(Sigma[2] / k_r));
 
 	// ??? leave out first R because of eq. 10 in [000]
 	// CANNOT BE LEFT OUT RIGHT NOW
-	Eigen::Matrix3f G_Eigen =
-		m_Dataset->ParticleRadiusInv * R * Sigma.cwiseInverse().asDiagonal() * R.transpose();
+	const glm::vec3 SigmaInv = 1.0f / Sigma;
 
-	G = {
-		eigenToGlm(G_Eigen.col(0)),
-		eigenToGlm(G_Eigen.col(1)),
-		eigenToGlm(G_Eigen.col(2)),
-	};
+	G = m_Dataset->ParticleRadiusInv * R * glm::mat3(
+		SigmaInv.x, 0.0f, 0.0f,
+		0.0f, SigmaInv.y, 0.0f,
+		0.0f, 0.0f, SigmaInv.z) * glm::transpose(R);
+
+	// R is orthonormal, so det(G) only depends on the clamped eigenvalues
+	const float r_inv = m_Dataset->ParticleRadiusInv;
+	detG = r_inv * r_inv * r_inv * SigmaInv.x * SigmaInv.y * SigmaInv.z;
+
+#if !PRODUCTION
+	if (!std::isfinite(detG))
+		SPDLOG_WARN_LIMITED("WPCA of {} neighbors failed, det(G) = {}.", N, detG);
+#endif
 }
 
-void RayMarcher::PerPixel_Isotropic(uint32_t index, void* _locals)
+template <bool Instrumented>
+bool RayMarcher::GetCellAnisotropy(const glm::vec3& position,
+								   ThreadLocals* locals,
+								   glm::mat3& G,
+								   float& detG)
 {
-	ThreadLocals* locals = reinterpret_cast<ThreadLocals*>(_locals);
+	Frame& frame = m_Dataset->Frames[m_Settings.Frame];
+	OctreeNode* node = frame.QueryDensityGrid(position);
 
-	const float z = m_Depth[index];
+	if (!node)
+		return false;
 
-	m_Positions[index] = glm::vec4(0);
-	m_Normals[index] = glm::vec4(0);
-	if (z == 1.0f) return;
+	const uint32_t cell = uint32_t(node - frame.m_DensityGrid.m_Nodes.data());
 
-	auto& frame = m_Dataset->Frames[m_Settings.Frame];
+	if (m_AnisotropyCache.Get(cell, G, detG))
+		return true;
 
-	const glm::vec3 clip(float(index % m_Width) * m_TwoWidthInv - 1.0f,
-						 float(index / m_Width) * m_TwoHeightInv - 1.0f,
-						 z);
+	// The cell is filled together with the unclaimed dense cells after it in
+	// its row, which the neighboring rays likely reach next, so that their
+	// eigen decompositions share one batched solve.
+	const std::vector<OctreeNode>& nodes = frame.m_DensityGrid.m_Nodes;
+	const uint32_t width = uint32_t(frame.m_DensityGrid.m_Width);
 
-	const glm::vec4 worldH = m_InvProjectionView * glm::vec4(clip, 1);
-	glm::vec3 position = glm::vec3(worldH) / worldH.w;
-	const glm::vec3 step = m_Settings.StepSize * glm::normalize(position - m_CameraPosition);
+	uint32_t cells[8] = { cell };
+	uint32_t numCells = 1;
 
-	for (int i = 0; i < m_Settings.MaxSteps; i++)
+	for (uint32_t next = cell + 1; next < cell + 8 && next % width != 0; next++)
 	{
-		// step
-		position += step;
+		if (nodes[next].Flag && m_AnisotropyCache.Claim(next))
+			cells[numCells++] = next;
+	}
 
-		// check density grid
-		OctreeNode* gridNode = nullptr;
+	SymmetricMatrix3x8 C = {};
+	uint32_t numNeighbors[8];
 
-		while ((gridNode = frame.QueryDensityGrid(position)) && gridNode->Flag == false)
-		{
-			if (!(
-				position.x >= gridNode->Min.x &&
-				position.x <= gridNode->Max.x &&
-				position.y >= gridNode->Min.y &&
-				position.y <= gridNode->Max.y &&
-				position.z >= gridNode->Min.z &&
-				position.z <= gridNode->Max.z
-				))
-			{
-				SPDLOG_ERROR("{} {} {}\n{} {} {}\n{} {} {}",
-							 position.x, position.y, position.z,
-							 gridNode->Min.x, gridNode->Min.y, gridNode->Min.z,
-							 gridNode->Max.x, gridNode->Max.y, gridNode->Max.z);
-			}
+	for (uint32_t i = 0; i < numCells; i++)
+	{
+		// Evaluate at the cell center, so that the result does not depend on
+		// which sample touches the cell first.
+		const OctreeNode& cellNode = nodes[cells[i]];
+		const glm::vec3 center = 0.5f * (cellNode.Min + cellNode.Max);
 
-			// skip empty space
-			position = intersectAABB(position, step, gridNode->Min, gridNode->Max) + step;
-			//position += step;
+		const std::vector<unsigned int> neighbors = m_Dataset->GetNeighborsExt(center, m_Settings.Frame);
+		numNeighbors[i] = std::min(neighbors.size(), size_t(MAX_NEIGHBORS));
 
-			//SPDLOG_WARN("skip");
+		for (uint32_t j = 0; j < numNeighbors[i]; j++)
+		{
+			const glm::vec3 r = frame.m_ParticlesExt[neighbors[j]] - center;
+
+			locals->NeighborX_RelExt[j] = r.x;
+			locals->NeighborY_RelExt[j] = r.y;
+			locals->NeighborZ_RelExt[j] = r.z;
 		}
 
-		// find neighbors
-		const std::vector<uint32_t> neighbors =
-			m_Dataset->GetNeighbors(position, m_Settings.Frame);
+		const SymmetricMatrix3 c = ComputeCovariance(
+			locals->NeighborX_RelExt, locals->NeighborY_RelExt, locals->NeighborZ_RelExt, numNeighbors[i]);
 
-		locals->NumNeighbors = std::min(neighbors.size(), size_t(MAX_NEIGHBORS));
+		C.xx[i] = c.xx; C.xy[i] = c.xy; C.xz[i] = c.xz;
+		C.yy[i] = c.yy; C.yz[i] = c.yz;
+		C.zz[i] = c.zz;
+	}
 
-		// store neighbor positions
-		for (uint32_t i = 0; i < locals->NumNeighbors; i++)
-		{
-			const glm::vec3 r = frame.m_Particles[neighbors[i]] - position;
-			locals->NeighborPositions_Rel[i] = r;
-		}
+	// eigendecompositions, eigenvalues are sorted ascending
+	glm::vec3 Sigma[8];
+	glm::mat3 R[8];
 
-		// density
-		float density = 0.0f;
+	if (numCells == 1)
+		SolveSymmetricEigen({ C.xx[0], C.xy[0], C.xz[0], C.yy[0], C.yz[0], C.zz[0] }, Sigma[0], R[0]);
+	else
+		SolveSymmetricEigen8(C, Sigma, R);
 
-		for (uint32_t i = 0; i < locals->NumNeighbors; i++)
-			density += m_IsotropicKernel.W(locals->NeighborPositions_Rel[i]);
+	if constexpr (Instrumented)
+		locals->NumWPCACalls += numCells;
 
-		if (density >= m_Settings.IsoDensity)
-		{
-			// set position
-			m_Positions[index] = glm::vec4(position, 1);
+	ComputeG(Sigma[0], R[0], numNeighbors[0], G, detG);
 
-			// compute object normal
-			glm::vec3 normal(0);
+	// if another thread is already computing this cell, just use our own result
+	if (m_AnisotropyCache.Claim(cell))
+		m_AnisotropyCache.Publish(cell, G, detG);
 
-			for (uint32_t i = 0; i < locals->NumNeighbors; i++)
-				normal += m_IsotropicKernel.gradW(locals->NeighborPositions_Rel[i]);
+	// the other cells are claimed already
+	for (uint32_t i = 1; i < numCells; i++)
+	{
+		glm::mat3 cellG;
+		float cellDetG;
+		ComputeG(Sigma[i], R[i], numNeighbors[i], cellG, cellDetG);
 
-			m_Normals[index] = glm::vec4(glm::normalize(normal), 1);
+		m_AnisotropyCache.Publish(cells[i], cellG, cellDetG);
+	}
 
-			// break
-			i = m_Settings.MaxSteps;
-		}
+	return true;
+}
+
+template <bool Anisotropic, bool GridSkipping, bool Approximate>
+RayMarcher::MarchFunction RayMarcher::SelectMarch() const
+{
+	return m_RecordCost ?
+		&RayMarcher::March<Anisotropic, GridSkipping, Approximate, true> :
+		&RayMarcher::March<Anisotropic, GridSkipping, Approximate, false>;
+}
+
+template <bool Anisotropic, bool GridSkipping, bool Approximate, bool Instrumented>
+void RayMarcher::March(uint32_t beginRun, uint32_t endRun, void* locals)
+{
+	ThreadLocals* _locals = reinterpret_cast<ThreadLocals*>(locals);
+
+	for (uint32_t i = beginRun; i < endRun; i++)
+	{
+		const PixelRun& run = m_ActiveRuns[i];
+
+		for (uint32_t index = run.Begin; index < run.End; index++)
+			PerPixel<Anisotropic, GridSkipping, Approximate, Instrumented>(index, _locals);
 	}
 }
 
-void RayMarcher::PerPixel_Anisotropic(uint32_t index, void* _locals)
+template <bool Anisotropic, bool GridSkipping, bool Approximate, bool Instrumented>
+void RayMarcher::PerPixel(uint32_t index, ThreadLocals* locals)
 {
-	ThreadLocals* locals = reinterpret_cast<ThreadLocals*>(_locals);
+	[[maybe_unused]] RayCost cost = {};
+	[[maybe_unused]] std::chrono::high_resolution_clock::time_point start;
 
-	const float z = m_Depth[index];
+	if constexpr (Instrumented)
+	{
+		locals->NumWPCACalls = 0;
+		start = std::chrono::high_resolution_clock::now();
+	}
 
-	m_Positions[index] = glm::vec4(0);
-	m_Normals[index] = glm::vec4(0);
-	if (z == 1.0f) return;
+	// only active pixels are marched, the output is already cleared
+	const float z = m_Depth[index];
 
 	auto& frame = m_Dataset->Frames[m_Settings.Frame];
 
@@ -363,61 +709,170 @@ void RayMarcher::PerPixel_Anisotropic(uint32_t index, void* _locals)
 	glm::vec3 position = glm::vec3(worldH) / worldH.w;
 	const glm::vec3 step = m_Settings.StepSize * glm::normalize(position - m_CameraPosition);
 
+	const float radiusSquared = m_Dataset->ParticleRadius * m_Dataset->ParticleRadius;
+
+	float previousDensity = 0.0f;
+
 	for (int i = 0; i < m_Settings.MaxSteps; i++)
 	{
 		// step
 		position += step;
 
-#if 1
-		// check density grid
-		OctreeNode* gridNode = nullptr;
+		if constexpr (Instrumented)
+			cost.Steps++;
+
+		if constexpr (GridSkipping)
+		{
+			// check density grid
+			OctreeNode* gridNode = nullptr;
 
-		// skip empty space
-		while ((gridNode = frame.QueryDensityGrid(position)) && gridNode->Flag == false)
-			position = intersectAABB(position, step, gridNode->Min, gridNode->Max) + step;
+			while ((gridNode = frame.QueryDensityGrid(position)) && gridNode->Flag == false)
+			{
+#if !PRODUCTION
+				if (!(
+					position.x >= gridNode->Min.x &&
+					position.x <= gridNode->Max.x &&
+					position.y >= gridNode->Min.y &&
+					position.y <= gridNode->Max.y &&
+					position.z >= gridNode->Min.z &&
+					position.z <= gridNode->Max.z
+					))
+				{
+					SPDLOG_ERROR_LIMITED("{} {} {}\n{} {} {}\n{} {} {}",
+											 position.x, position.y, position.z,
+											 gridNode->Min.x, gridNode->Min.y, gridNode->Min.z,
+											 gridNode->Max.x, gridNode->Max.y, gridNode->Max.z);
+				}
 #endif
 
-		const std::vector<unsigned int> neighbors =
-			m_Dataset->GetNeighborsExt(position, m_Settings.Frame);
-		locals->NumNeighborsExt = std::min(neighbors.size(), size_t(MAX_NEIGHBORS));
-		locals->NumNeighbors = 0;
+				// skip empty space
+				position = intersectAABB(position, step, gridNode->Min, gridNode->Max) + step;
+
+				if constexpr (Instrumented)
+					cost.SkipIterations++;
+			}
+		}
+
+		// compute density
+		glm::mat3 G;
+		float detG;
+		float density = 0.0f;
+
+		bool approximated = false;
+
+		if constexpr (Approximate)
+			approximated = GetCellAnisotropy<Instrumented>(position, locals, G, detG);
 
-		// store neighbor positions
-		for (uint32_t i = 0; i < locals->NumNeighborsExt; i++)
+		if (approximated)
 		{
-			locals->NeighborPositions_AbsExt[i] = frame.m_ParticlesExt[neighbors[i]];
+			const std::vector<uint32_t> neighbors =
+				m_Dataset->GetNeighbors(position, m_Settings.Frame);
+			const uint32_t numNeighbors = std::min(neighbors.size(), size_t(MAX_NEIGHBORS));
+			locals->NumNeighbors = 0;
 
-			const glm::vec3 r = locals->NeighborPositions_AbsExt[i] - position;
+			// store neighbor positions
+			for (uint32_t j = 0; j < numNeighbors; j++)
+				locals->PushNeighbor(frame.m_Particles[neighbors[j]] - position);
 
-			if (glm::dot(r, r) < m_Dataset->ParticleRadius * m_Dataset->ParticleRadius)
-				locals->NeighborPositions_Rel[locals->NumNeighbors++] = r;
+			if constexpr (Instrumented)
+				cost.Neighbors += numNeighbors;
 		}
+		else if constexpr (Anisotropic)
+		{
+			const std::vector<unsigned int> neighbors =
+				m_Dataset->GetNeighborsExt(position, m_Settings.Frame);
+			locals->NumNeighborsExt = std::min(neighbors.size(), size_t(MAX_NEIGHBORS));
+			locals->NumNeighbors = 0;
 
-		// compute G and density
-		glm::mat3 G;
-		float density = 0.0f;
+			// store neighbor positions
+			for (uint32_t j = 0; j < locals->NumNeighborsExt; j++)
+			{
+				const glm::vec3 r = frame.m_ParticlesExt[neighbors[j]] - position;
 
-		WPCA(position, locals->NeighborPositions_AbsExt, locals->NumNeighborsExt, G);
-		const float detG = glm::determinant(G);
+				locals->NeighborX_RelExt[j] = r.x;
+				locals->NeighborY_RelExt[j] = r.y;
+				locals->NeighborZ_RelExt[j] = r.z;
 
-		for (uint32_t i = 0; i < locals->NumNeighbors; i++)
-			density += m_AnisotropicKernel.W(G, detG, locals->NeighborPositions_Rel[i]);
+				if (glm::dot(r, r) < radiusSquared)
+					locals->PushNeighbor(r);
+			}
 
-		if (density >= m_Settings.IsoDensity)
+			WPCA(locals->NeighborX_RelExt, locals->NeighborY_RelExt, locals->NeighborZ_RelExt,
+				 locals->NumNeighborsExt, G, detG);
+
+			if constexpr (Instrumented)
+			{
+				cost.Neighbors += locals->NumNeighborsExt;
+				locals->NumWPCACalls++;
+			}
+		}
+		else
 		{
-			// set position
-			m_Positions[index] = glm::vec4(position, 1);
+			const std::vector<uint32_t> neighbors =
+				m_Dataset->GetNeighbors(position, m_Settings.Frame);
+			const uint32_t numNeighbors = std::min(neighbors.size(), size_t(MAX_NEIGHBORS));
+			locals->NumNeighbors = 0;
 
-			// compute object normal
-			glm::vec3 normal(0);
+			// store neighbor positions
+			for (uint32_t j = 0; j < numNeighbors; j++)
+				locals->PushNeighbor(frame.m_Particles[neighbors[j]] - position);
 
-			for (uint32_t i = 0; i < locals->NumNeighbors; i++)
-				normal += m_AnisotropicKernel.gradW(G, detG, locals->NeighborPositions_Rel[i]);
+			if constexpr (Instrumented)
+				cost.Neighbors += numNeighbors;
+		}
 
-			m_Normals[index] = glm::vec4(glm::normalize(normal), 1);
+		// Close to the surface the next step is likely a hit, so the density
+		// and the gradient for its normal are summed in one pass.
+		const bool nearSurface = previousDensity >= NearSurfaceDensity * m_Settings.IsoDensity;
+		glm::vec3 normal(0.0f);
 
-			// break
-			i = m_Settings.MaxSteps;
+		if constexpr (Anisotropic)
+		{
+			density = nearSurface ?
+				m_AnisotropicKernel.WgradW(G, detG,
+					locals->NeighborX_Rel, locals->NeighborY_Rel, locals->NeighborZ_Rel, locals->NumNeighbors, normal) :
+				m_AnisotropicKernel.W(G, detG,
+					locals->NeighborX_Rel, locals->NeighborY_Rel, locals->NeighborZ_Rel, locals->NumNeighbors);
 		}
+		else
+		{
+			density = nearSurface ?
+				m_IsotropicKernel.WgradW(
+					locals->NeighborX_Rel, locals->NeighborY_Rel, locals->NeighborZ_Rel, locals->NumNeighbors, normal) :
+				m_IsotropicKernel.W(
+					locals->NeighborX_Rel, locals->NeighborY_Rel, locals->NeighborZ_Rel, locals->NumNeighbors);
+		}
+
+		if (density >= m_Settings.IsoDensity)
+		{
+			// set distance along the ray, the position is reconstructed from it
+			m_HitDistances[index] = glm::length(position - m_CameraPosition);
+
+			// compute object normal, unless the step already did
+			if (!nearSurface)
+			{
+				if constexpr (Anisotropic)
+					normal = m_AnisotropicKernel.gradW(G, detG,
+						locals->NeighborX_Rel, locals->NeighborY_Rel, locals->NeighborZ_Rel, locals->NumNeighbors);
+				else
+					normal = m_IsotropicKernel.gradW(
+						locals->NeighborX_Rel, locals->NeighborY_Rel, locals->NeighborZ_Rel, locals->NumNeighbors);
+			}
+
+			m_Normals[index] = encodeNormal(normal);
+
+			break;
+		}
+
+		previousDensity = density;
+	}
+
+	if constexpr (Instrumented)
+	{
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		cost.WPCACalls = locals->NumWPCACalls;
+		cost.Time = std::chrono::duration<float, std::micro>(end - start).count();
+		m_Cost[index] = cost;
 	}
 }
@@ -1,13 +1,34 @@
 #pragma once
 
 #include "app/Kernel.h"
-
-#include <engine/camera/Camera3D.h>
-#include <engine/camera/CameraController3D.h>
-
+#include "app/SymmetricEigenSolver.h"
 #include "app/ThreadPool.h"
 
+#include "AnisotropyCache.h"
+
 class Dataset;
+struct ThreadLocals;
+
+// octahedral encoding of the normals buffer
+uint32_t encodeNormal(glm::vec3 n);
+glm::vec3 decodeNormal(uint32_t packed);
+
+// half-open range of consecutive pixels that need to be marched
+struct PixelRun
+{
+	uint32_t Begin;
+	uint32_t End;
+};
+
+// what marching a single pixel cost, recorded only if enabled
+struct RayCost
+{
+	uint32_t Steps;
+	uint32_t SkipIterations; // empty grid cells skipped
+	uint32_t Neighbors; // summed over all steps
+	uint32_t WPCACalls;
+	float Time; // in microseconds
+};
 
 struct VisualizationSettings
 {
@@ -17,7 +38,9 @@ struct VisualizationSettings
 	float StepSize;
 	float IsoDensity;
 
+	bool EnableGridSkipping;
 	bool EnableAnisotropy;
+	bool ApproximateAnisotropy; // WPCA once per density grid cell
 
 	float k_n;
 	float k_r;
@@ -28,47 +51,161 @@ struct VisualizationSettings
 class RayMarcher
 {
 public:
-	RayMarcher();
+	// 0 threads: one less than the hardware threads, the main thread renders
+	RayMarcher(uint32_t numThreads = 0);
 
 	void Exit();
 
+	// The buffers hold width * height pixels. Nothing is read from the
+	// renderer, so that the marcher also runs without a window.
 	void Prepare(const VisualizationSettings& settings,
-				 const CameraController3D& camera,
+				 const glm::vec3& cameraPosition,
+				 const glm::mat4& invProjectionView,
+				 uint32_t width,
+				 uint32_t height,
 				 Dataset* dataset,
-				 glm::vec4* positions,
-				 glm::vec4* normals,
+				 float* hitDistances,
+				 uint32_t* normals,
 				 float* depth);
 
 	void Start();
 
+	// Forgets the anisotropy memoized by earlier jobs, e.g. to measure a
+	// cold march. Call after Prepare.
+	void ResetAnisotropyCache();
+
 	bool IsDone() { return m_ThreadPool.IsDone(); }
 
-private:
-	void WPCA(const glm::vec3& particle,
-			  const glm::vec3* neighborPositions,
+	// Workers that march, takes effect with the next Start().
+	void SetNumThreads(uint32_t numThreads) { m_ThreadPool.SetNumActiveThreads(numThreads); }
+	uint32_t GetNumThreads() const { return m_ThreadPool.GetNumActiveThreads(); }
+	uint32_t GetMaxThreads() const { return m_ThreadPool.GetNumThreads(); }
+
+	// Takes effect with the next Start(). Recording costs a clock read per pixel.
+	void SetCostRecording(bool enabled) { m_RecordCost = enabled; }
+	bool IsCostRecording() const { return m_RecordCost; }
+
+	// per pixel of the last job, empty if it was not recorded
+	const std::vector<RayCost>& GetCost() const { return m_Cost; }
+
+	// camera of the last prepared job, needed to reconstruct hit positions
+	const glm::mat4& GetInvProjectionView() const { return m_InvProjectionView; }
+	const glm::vec3& GetCameraPosition() const { return m_CameraPosition; }
+
+	struct ImageDifference
+	{
+		float HitMismatch;		 // fraction of active pixels hit by only one of the paths
+		float MeanPositionError; // in particle radii
+		float MaxPositionError;  // in particle radii
+		float MeanNormalError;	 // in degrees
+		float MaxNormalError;	 // in degrees
+
+		float ApproximateTime;	 // in ms
+		float ExactTime;		 // in ms
+	};
+
+	// Marches the last prepared job with approximate and with exact anisotropy
+	// and compares both images. The approximate result is kept in the output
+	// buffers. Blocks until both have finished.
+	ImageDifference CompareWithExact();
+
+	// Compares two outputs of marches with the same camera and depth, pixels
+	// with a depth of 1 are inactive. Fills in the errors, not the times.
+	static ImageDifference CompareImages(const float* hitDistancesA,
+										 const uint32_t* normalsA,
+										 const float* hitDistancesB,
+										 const uint32_t* normalsB,
+										 const float* depth,
+										 uint32_t numPixels,
+										 float particleRadius);
+
+	struct ScalingResult
+	{
+		uint32_t NumThreads;
+		float Time;		  // in ms, of the workers only
+		float Speedup;	  // over one thread
+		float Efficiency; // speedup per thread
+
+		// in ms, per worker
+		std::vector<float> BusyTime;
+		std::vector<float> IdleTime;
+		std::vector<uint32_t> NumChunks;
+	};
+
+	// Marches the last prepared job with 1, 2, 4, ... up to all workers, each
+	// with an empty anisotropy cache. The number of threads is restored and
+	// the image of the last run is kept. Blocks until all have finished.
+	std::vector<ScalingResult> MeasureScaling();
+
+	// Neighbor positions relative to the sample, in SoA layout. Uses the
+	// settings and dataset of the last prepared job. Public for the
+	// benchmarks, the marcher calls it per step or per density grid cell.
+	void WPCA(const float* x,
+			  const float* y,
+			  const float* z,
 			  uint32_t N,
 			  glm::mat3& G,
-			  bool verbose = false);
+			  float& detG);
 
-	void PerPixel_Isotropic(uint32_t index, void* locals);
-	void PerPixel_Anisotropic(uint32_t index, void* locals);
+private:
+
+	// Clears the output buffers and collects the runs of pixels covered by
+	// particles, so that only those are dispatched to the thread pool.
+	void CollectActivePixels();
+	void AddActiveRun(uint32_t begin, uint32_t end);
+
+	// The marcher is specialized at compile time on its configuration and
+	// selected once per job in Start(), so that no settings are branched on
+	// and no indirect call is made per pixel.
+	using MarchFunction = void (RayMarcher::*)(uint32_t, uint32_t, void*);
+
+	template <bool Anisotropic, bool GridSkipping, bool Approximate>
+	MarchFunction SelectMarch() const;
+
+	template <bool Anisotropic, bool GridSkipping, bool Approximate, bool Instrumented>
+	void March(uint32_t beginRun, uint32_t endRun, void* locals);
+
+	template <bool Anisotropic, bool GridSkipping, bool Approximate, bool Instrumented>
+	void PerPixel(uint32_t index, ThreadLocals* locals);
+
+	// The two halves of WPCA around the eigen decomposition, so that several
+	// decompositions can be solved together.
+	SymmetricMatrix3 ComputeCovariance(const float* x, const float* y, const float* z, uint32_t N) const;
+	void ComputeG(glm::vec3 Sigma, const glm::mat3& R, uint32_t N, glm::mat3& G, float& detG) const;
+
+	// Looks up or computes G for the density grid cell containing position.
+	// Returns false outside of the grid.
+	template <bool Instrumented>
+	bool GetCellAnisotropy(const glm::vec3& position,
+						   ThreadLocals* locals,
+						   glm::mat3& G,
+						   float& detG);
 
 private:
 	VisualizationSettings m_Settings;
-	Dataset* m_Dataset;
+	Dataset* m_Dataset = nullptr;
 
 	uint32_t m_Width;
 	uint32_t m_Height;
 	float m_TwoWidthInv;
 	float m_TwoHeightInv;
 
-	glm::mat4 m_InvProjectionView;
-	glm::vec3 m_CameraPosition;
+	glm::mat4 m_InvProjectionView = glm::mat4(1.0f);
+	glm::vec3 m_CameraPosition = glm::vec3(0.0f);
 
-	glm::vec4* m_Positions;
-	glm::vec4* m_Normals;
+	// Outputs: distance from the camera to the hit along the pixel's ray, 0
+	// if missed, and the octahedrally encoded normal.
+	float* m_HitDistances;
+	uint32_t* m_Normals;
 	float* m_Depth;
 
+	std::vector<PixelRun> m_ActiveRuns;
+
+	bool m_RecordCost = false;
+	std::vector<RayCost> m_Cost;
+
+	AnisotropyCache m_AnisotropyCache;
+
 	CubicSplineKernel m_IsotropicKernel;
 	AnisotropicKernel m_AnisotropicKernel;
 
@@ -0,0 +1,217 @@
+#include <engine/hzpch.h>
+
+#include "RendererBenchmark.h"
+
+#include <engine/camera/CameraController3D.h>
+#include <engine/renderer/Renderer.h>
+#include <engine/utils/Statistics.h>
+
+#include <fstream>
+
+// name in the report, statistics entry
+static const std::pair<const char*, const char*> s_Phases[] = {
+	{ "frame", "Frame time [ms]" },
+	{ "pre_march", "Pre-marching [ms]" },
+	{ "march", "Ray march [ms]" },
+	{ "particle_upload", "GPU Particle upload" },
+	{ "hit_upload", "GPU Hit upload" },
+	{ "composition", "GPU Composition" },
+};
+
+// ------------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+void RendererBenchmark::Start(const Config& config, const VisualizationSettings& settings, const MemoryUsage& memory)
+{
+	m_Config = config;
+	m_Settings = settings;
+	m_Memory = memory;
+
+	// counts as finished, so that an unattended run still exits
+	if (!m_Config.CameraPath.empty() && !Path.Load(m_Config.CameraPath))
+	{
+		m_Finished = true;
+		return;
+	}
+
+	RecordingPath = false;
+
+	const uint32_t numFrames = uint32_t(m_Config.LastFrame - m_Config.FirstFrame + 1);
+	m_NumMarches = Path.IsEmpty() ? numFrames : uint32_t(Path.GetSize());
+
+	m_NumMarched = 0;
+	m_NumFrames = 0;
+	m_MarchInFlight = false;
+	m_Finished = false;
+	m_PeakDeviceMemory = 0;
+
+	GlobalStatistics.ResetHistograms();
+
+	m_StartTime = std::chrono::steady_clock::now();
+	m_Running = true;
+
+	SPDLOG_INFO("Benchmark of {} marches over frames {} to {} started.",
+				m_NumMarches,
+				m_Config.FirstFrame,
+				m_Config.LastFrame);
+}
+
+void RendererBenchmark::Stop()
+{
+	if (!m_Running)
+		return;
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+
+	m_Running = false;
+	m_Finished = true;
+
+	WriteReport(seconds);
+}
+
+void RendererBenchmark::OnFrame()
+{
+	if (!m_Running)
+		return;
+
+	m_NumFrames++;
+
+	const MemoryStats stats = Vulkan.Allocator.GetStats();
+	m_PeakDeviceMemory = std::max(m_PeakDeviceMemory, stats.BlockBytes + stats.OwnBytes);
+}
+
+void RendererBenchmark::BeginMarch(CameraController3D& controller, VisualizationSettings& settings)
+{
+	if (!m_Running)
+		return;
+
+	const int numFrames = m_Config.LastFrame - m_Config.FirstFrame + 1;
+
+	settings = m_Settings;
+	settings.Frame = m_Config.FirstFrame + int(m_NumMarched % numFrames);
+
+	if (!Path.IsEmpty())
+		Path.Apply(controller, m_NumMarched);
+
+	m_MarchInFlight = true;
+}
+
+void RendererBenchmark::EndMarch()
+{
+	// a march started before the benchmark does not count
+	if (!m_Running || !m_MarchInFlight)
+		return;
+
+	m_MarchInFlight = false;
+
+	if (++m_NumMarched >= m_NumMarches)
+		Stop();
+}
+
+// ------------------------------------------------------------------------
+// PRIVATE HELPER FUNCTIONS
+
+bool RendererBenchmark::WriteReport(double seconds) const
+{
+	const std::filesystem::path& path = m_Config.Output;
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Could not write benchmark report to '{}'!", path.string());
+		return false;
+	}
+
+	constexpr double MB = 1024.0 * 1024.0;
+	const VisualizationSettings& s = m_Settings;
+
+	file << "{\n"
+		 << "\t\"marches\": " << m_NumMarched << ",\n"
+		 << "\t\"frames\": " << m_NumFrames << ",\n"
+		 << "\t\"seconds\": " << seconds << ",\n"
+		 << "\t\"frames_per_second\": " << double(m_NumFrames) / seconds << ",\n"
+		 << "\t\"marches_per_second\": " << double(m_NumMarched) / seconds << ",\n"
+		 << "\t\"first_frame\": " << m_Config.FirstFrame << ",\n"
+		 << "\t\"last_frame\": " << m_Config.LastFrame << ",\n"
+		 << "\t\"camera_keyframes\": " << Path.GetSize() << ",\n"
+		 << "\t\"resolution\": [" << Vulkan.SwapchainExtent.width << ", " << Vulkan.SwapchainExtent.height << "],\n"
+		 << "\t\"peak_process_memory_mb\": " << double(Utils::GetPeakProcessMemory()) / MB << ",\n"
+		 << "\t\"peak_device_memory_mb\": " << double(m_PeakDeviceMemory) / MB << ",\n";
+
+	file << std::boolalpha
+		 << "\t\"settings\": { "
+		 << "\"max_steps\": " << s.MaxSteps
+		 << ", \"step_size\": " << s.StepSize
+		 << ", \"iso_density\": " << s.IsoDensity
+		 << ", \"grid_skipping\": " << s.EnableGridSkipping
+		 << ", \"anisotropy\": " << s.EnableAnisotropy
+		 << ", \"approximate_anisotropy\": " << s.ApproximateAnisotropy
+		 << ", \"k_n\": " << s.k_n
+		 << ", \"k_r\": " << s.k_r
+		 << ", \"k_s\": " << s.k_s
+		 << ", \"N_eps\": " << s.N_eps << " },\n";
+
+	// in megabytes, the searches are estimates
+	auto writeFrameMemory = [&](const char* name, const FrameMemory& m) {
+		file << "\t\t\"" << name << "\": { "
+			 << "\"particles\": " << double(m.Particles) / MB
+			 << ", \"particles_ext\": " << double(m.ParticlesExt) / MB
+			 << ", \"search\": " << double(m.Search) / MB
+			 << ", \"search_ext\": " << double(m.SearchExt) / MB
+			 << ", \"density_grid\": " << double(m.DensityGrid) / MB
+			 << ", \"total\": " << double(m.GetTotal()) / MB << " },\n";
+	};
+
+	file << "\t\"memory_mb\": {\n"
+		 << "\t\t\"resident_frames\": " << m_Memory.Frames.NumFrames << ",\n";
+
+	writeFrameMemory("dataset", m_Memory.Frames.Total);
+	writeFrameMemory("largest_frame", m_Memory.Frames.Largest);
+
+	file << "\t\t\"render_targets\": {";
+
+	for (const MemoryUsage::RenderTarget& target : m_Memory.RenderTargets)
+	{
+		file << " \"" << target.Name << "\": { "
+			 << "\"host\": " << double(target.HostBytes) / MB
+			 << ", \"device\": " << double(target.DeviceBytes) / MB << " },";
+	}
+
+	file << " \"transients\": { \"host\": 0, \"device\": " << double(m_Memory.TransientBytes) / MB << " } },\n"
+		 << "\t\t\"particle_cache\": " << double(m_Memory.ParticleCacheBytes) / MB << "\n"
+		 << "\t},\n";
+
+	// in milliseconds
+	file << "\t\"phases\": {";
+
+	const char* separator = "\n";
+
+	for (const auto& [name, entryName] : s_Phases)
+	{
+		const Statistics::Entry& entry = GlobalStatistics.Get(entryName);
+
+		file << separator
+			 << "\t\t\"" << name << "\": { "
+			 << "\"samples\": " << entry.TotalSamples
+			 << ", \"mean\": " << entry.GetTotalAverage()
+			 << ", \"p50\": " << entry.GetPercentile(0.50f)
+			 << ", \"p95\": " << entry.GetPercentile(0.95f)
+			 << ", \"p99\": " << entry.GetPercentile(0.99f)
+			 << ", \"max\": " << entry.TotalMax << " }";
+
+		separator = ",\n";
+	}
+
+	file << "\n\t}\n}\n";
+
+	SPDLOG_INFO("Benchmark finished: {} marches, {} frames in {:.2f} s ({:.1f} frames/s), report in '{}'.",
+				m_NumMarched,
+				m_NumFrames,
+				seconds,
+				double(m_NumFrames) / seconds,
+				path.string());
+
+	return true;
+}
+
+// ------------------------------------------------------------------------
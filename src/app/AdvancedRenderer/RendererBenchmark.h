@@ -0,0 +1,70 @@
+#pragma once
+
+#include <engine/camera/CameraPath.h>
+
+#include "MemoryUsage.h"
+#include "RayMarcher.h"
+
+class CameraController3D;
+
+/*
+* Replays a camera path over a range of dataset frames with fixed settings
+* and reports the timings of the render phases as JSON.
+*
+* Every march takes the next keyframe and the next dataset frame, so that a
+* path gives the same marches no matter how fast a build runs. The phase
+* timings are the histograms of GlobalStatistics, which are reset when the
+* benchmark starts.
+*/
+class RendererBenchmark
+{
+public:
+	struct Config
+	{
+		std::filesystem::path CameraPath; // empty: the recorded path, or the current camera
+		int FirstFrame = 0;
+		int LastFrame = 0; // inclusive
+		std::filesystem::path Output;
+		bool ExitWhenDone = false;
+	};
+
+public:
+	// The memory usage goes into the report, the process peak is taken at the end.
+	void Start(const Config& config, const VisualizationSettings& settings, const MemoryUsage& memory);
+	void Stop(); // and writes the report
+
+	bool IsRunning() const { return m_Running; }
+	bool ShouldExit() const { return m_Finished && m_Config.ExitWhenDone; }
+
+	uint32_t GetNumMarched() const { return m_NumMarched; }
+	uint32_t GetNumMarches() const { return m_NumMarches; }
+
+	// once per rendered frame
+	void OnFrame();
+
+	// Sets the camera and settings of the next march before it is prepared.
+	void BeginMarch(CameraController3D& controller, VisualizationSettings& settings);
+	void EndMarch();
+
+	CameraPath Path;
+	bool RecordingPath = false;
+
+private:
+	bool WriteReport(double seconds) const;
+
+private:
+	Config m_Config;
+	VisualizationSettings m_Settings;
+	MemoryUsage m_Memory;
+
+	bool m_Running = false;
+	bool m_Finished = false;
+	bool m_MarchInFlight = false;
+
+	uint32_t m_NumMarches = 0;
+	uint32_t m_NumMarched = 0;
+	uint32_t m_NumFrames = 0;
+
+	std::chrono::steady_clock::time_point m_StartTime;
+	vk::DeviceSize m_PeakDeviceMemory = 0;
+};
@@ -31,7 +31,6 @@ void ShowImageRenderPass::Init()
 	CreateDescriptorSet();
 
 	CreatePipelineLayout();
-	CreatePipeline();
 
 	CreateUniformBuffer();
 
@@ -48,7 +47,8 @@ void ShowImageRenderPass::Exit()
 	VertexShader.Destroy();
 	FragmentShader.Destroy();
 
-	UniformBufferFullscreen.Destroy();
+	for (Buffer& buffer : UniformBuffersFullscreen)
+		buffer.Destroy();
 }
 
 void ShowImageRenderPass::Begin()
@@ -89,9 +89,17 @@ void ShowImageRenderPass::Begin()
 		vk::PipelineBindPoint::eGraphics,
 		PipelineLayout,
 		0,
-		DescriptorSet,
+		DescriptorSets[Vulkan.CurrentFrame],
 		{}
 	);
+
+	Vulkan.CommandBuffer.pushConstants(
+		PipelineLayout,
+		vk::ShaderStageFlagBits::eFragment,
+		0,
+		sizeof(PushConstants),
+		&PushConstants
+	);
 }
 
 void ShowImageRenderPass::End()
@@ -115,9 +123,16 @@ void ShowImageRenderPass::CreateShaders()
 
 void ShowImageRenderPass::CreatePipelineLayout()
 {
+	vk::PushConstantRange pushConstantRange;
+	pushConstantRange
+		.setOffset(0)
+		.setSize(sizeof(PushConstants))
+		.setStageFlags(vk::ShaderStageFlagBits::eFragment);
+
 	vk::PipelineLayoutCreateInfo info;
 	info.setSetLayoutCount(1)
-		.setSetLayouts(DescriptorSetLayout);
+		.setSetLayouts(DescriptorSetLayout)
+		.setPushConstantRanges(pushConstantRange);
 
 	PipelineLayout = Vulkan.Device.createPipelineLayout(info);
 }
@@ -218,7 +233,7 @@ void ShowImageRenderPass::CreatePipeline()
 		.setPViewportState(&viewportState)
 		.setRenderPass(nullptr);
 
-	auto r = Vulkan.Device.createGraphicsPipeline({}, pipelineCreateInfo);
+	auto r = Vulkan.Device.createGraphicsPipeline(Vulkan.PipelineCache, pipelineCreateInfo);
 	HZ_ASSERT(r.result == vk::Result::eSuccess, "Pipeline creation failed!");
 	Pipeline = r.value;
 }
@@ -250,24 +265,29 @@ void ShowImageRenderPass::CreateDescriptorSetLayout()
 
 void ShowImageRenderPass::CreateDescriptorSet()
 {
+	PerFrame<vk::DescriptorSetLayout> layouts;
+	layouts.fill(DescriptorSetLayout);
+
 	vk::DescriptorSetAllocateInfo info;
 	info.setDescriptorPool(Vulkan.DescriptorPool)
-		.setDescriptorSetCount(1)
-		.setSetLayouts(DescriptorSetLayout);
+		.setSetLayouts(layouts);
 
 	auto r = Vulkan.Device.allocateDescriptorSets(info);
-	HZ_ASSERT(r.size() == 1, "allocateDescriptorSets failed!");
-	DescriptorSet = r.front();
+	HZ_ASSERT(r.size() == MAX_FRAMES_IN_FLIGHT, "allocateDescriptorSets failed!");
+	std::copy(r.begin(), r.end(), DescriptorSets.begin());
 }
 
 void ShowImageRenderPass::CreateUniformBuffer()
 {
-	UniformBufferFullscreen.Create(
-		sizeof(UniformsFullscreen),
-		vk::BufferUsageFlagBits::eUniformBuffer,
-		vk::MemoryPropertyFlagBits::eHostVisible |
-		vk::MemoryPropertyFlagBits::eHostCoherent
-	);
+	for (Buffer& buffer : UniformBuffersFullscreen)
+	{
+		buffer.Create(
+			sizeof(UniformsFullscreen),
+			vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible |
+			vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+	}
 }
 
 void ShowImageRenderPass::UpdateUniformsFullscreen()
@@ -276,15 +296,17 @@ void ShowImageRenderPass::UpdateUniformsFullscreen()
 	UniformsFullscreen.TexelHeight = float(1.0f) / float(Vulkan.SwapchainExtent.height);
 
 	// copy
-	UniformBufferFullscreen.Map(&UniformsFullscreen, sizeof(UniformsFullscreen));
+	UniformBuffersFullscreen[Vulkan.CurrentFrame].Map(&UniformsFullscreen, sizeof(UniformsFullscreen));
 }
 
 void ShowImageRenderPass::UpdateDescriptorSets()
 {
+	const uint32_t frame = Vulkan.CurrentFrame;
+
 	// uniforms fullscreen
 	vk::DescriptorBufferInfo bufferFullscreenInfo;
 	bufferFullscreenInfo
-		.setBuffer(UniformBufferFullscreen)
+		.setBuffer(UniformBuffersFullscreen[frame])
 		.setOffset(0)
 		.setRange(VK_WHOLE_SIZE);
 
@@ -295,7 +317,7 @@ void ShowImageRenderPass::UpdateDescriptorSets()
 		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 		.setDstArrayElement(0)
 		.setDstBinding(2)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
 	// smoothed depth
 	vk::DescriptorImageInfo depthImageInfo;
@@ -311,7 +333,7 @@ void ShowImageRenderPass::UpdateDescriptorSets()
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
 		.setDstArrayElement(0)
 		.setDstBinding(0)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
 	// write
 	std::array<vk::WriteDescriptorSet, 2> writes = {
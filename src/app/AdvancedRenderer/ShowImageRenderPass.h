@@ -2,17 +2,28 @@
 
 #include <engine/renderer/objects/Shader.h>
 #include <engine/renderer/objects/Buffer.h>
+#include <engine/renderer/objects/PerFrame.h>
 
 class AdvancedRenderer;
 
 class ShowImageRenderPass
 {
+public:
+	enum Mode
+	{
+		Inverted = 0, // 1 - r as gray, for depth
+		Heatmap = 1,  // r in [0, 1] as color
+	};
+
 public:
 	ShowImageRenderPass(AdvancedRenderer& renderer);
 
 	void Init();
 	void Exit();
 
+	// Called by the renderer after Init(), concurrently with the other passes.
+	void CreatePipeline();
+
 	void Begin();
 	void End();
 
@@ -20,7 +31,6 @@ private:
 	void CreateShaders();
 
 	void CreatePipelineLayout();
-	void CreatePipeline();
 
 	void CreateDescriptorSetLayout();
 	void CreateDescriptorSet();
@@ -36,7 +46,7 @@ public:
 	vk::PipelineLayout PipelineLayout;
 
 	vk::DescriptorSetLayout DescriptorSetLayout;
-	vk::DescriptorSet DescriptorSet;
+	PerFrame<vk::DescriptorSet> DescriptorSets;
 
 	Shader VertexShader, FragmentShader;
 
@@ -48,8 +58,13 @@ public:
 		float TexelHeight;
 	} UniformsFullscreen;
 
-	Buffer UniformBufferFullscreen;
+	PerFrame<Buffer> UniformBuffersFullscreen;
 
 	vk::ImageView ImageView;
 	vk::Sampler Sampler;
+
+	struct
+	{
+		int Mode = Inverted;
+	} PushConstants;
 };
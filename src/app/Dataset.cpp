@@ -4,6 +4,35 @@
 
 #include "app/Utils.h"
 
+#include <random>
+
+// -------------------------------------------------------------------
+
+size_t FrameMemory::GetTotal() const
+{
+	return Particles + ParticlesExt + Search + SearchExt + DensityGrid;
+}
+
+FrameMemory& FrameMemory::operator+=(const FrameMemory& other)
+{
+	Particles += other.Particles;
+	ParticlesExt += other.ParticlesExt;
+	Search += other.Search;
+	SearchExt += other.SearchExt;
+	DensityGrid += other.DensityGrid;
+
+	return *this;
+}
+
+// A point set keeps the current and the previous hash key (three ints each)
+// and the sort table entry of every point, the hash table the index of every
+// point in its cell. Neighbor lists are never stored, as find_neighbors is
+// only used for single positions.
+static size_t EstimateSearchMemory(size_t numPoints)
+{
+	return numPoints * (2 * 3 * sizeof(int) + sizeof(uint32_t) + sizeof(uint32_t));
+}
+
 // -------------------------------------------------------------------
 
 Frame::Frame(Dataset* dataset,
@@ -75,6 +104,22 @@ void Frame::BuildSearch()
 	}
 }
 
+FrameMemory Frame::GetMemoryUsage() const
+{
+	FrameMemory memory;
+
+	memory.Particles = m_Particles.capacity() * sizeof(Particle);
+	memory.ParticlesExt = m_ParticlesExt.capacity() * sizeof(Particle);
+	memory.Search = EstimateSearchMemory(m_Particles.size());
+	memory.SearchExt = EstimateSearchMemory(m_ParticlesExt.size());
+
+	memory.DensityGrid = m_DensityGrid.m_Nodes.capacity() * sizeof(OctreeNode);
+	for (const OctreeNode& node : m_DensityGrid.m_Nodes)
+		memory.DensityGrid += node.ParticleIndices.capacity() * sizeof(uint32_t);
+
+	return memory;
+}
+
 void Frame::ComputeAABB()
 {
 	m_Max = m_Particles[0];
@@ -230,7 +275,8 @@ void Dataset::makeCube(Dataset& r,
 					   float extent,
 					   size_t numParticles,
 					   float particleRadius,
-					   float particleRadiusMultiplier)
+					   float particleRadiusMultiplier,
+					   std::optional<uint32_t> seed)
 {
 	r.ParticleRadius = particleRadius;
 	r.ParticleRadiusExt = particleRadiusMultiplier * particleRadius;
@@ -239,14 +285,24 @@ void Dataset::makeCube(Dataset& r,
 	r.m_IsotropicKernel = CubicSplineKernel(r.ParticleRadius);
 	r.m_AnisotropicKernel = AnisotropicKernel(r.ParticleRadius);
 
+	// The output of mt19937 is fixed by the standard, that of the
+	// distributions is not, so seeded values are mapped by hand.
+	std::mt19937 engine(seed.value_or(0));
+	auto random = [&]() {
+		if (!seed)
+			return RandomFloat(-extent, extent);
+
+		const float u = float(engine() >> 8) * (1.0f / 16777216.0f);
+		return -extent + 2.0f * extent * u;
+	};
+
 	std::vector<Particle> particles;
+	particles.reserve(numParticles + 1);
+
 	for (size_t i = 0; i < numParticles; i++)
 	{
-		particles.push_back({
-			RandomFloat(-extent, extent),
-			RandomFloat(-extent, extent),
-			RandomFloat(-extent, extent),
-		});
+		// braced lists are evaluated from left to right
+		particles.push_back({ random(), random(), random() });
 	}
 
 	particles.push_back({
@@ -289,6 +345,23 @@ std::vector<uint32_t> Dataset::GetNeighborsExt(const glm::vec3& p, uint32_t fram
 	return neighbors[0];
 }
 
+DatasetMemory Dataset::GetMemoryUsage() const
+{
+	DatasetMemory memory;
+	memory.NumFrames = Frames.size();
+
+	for (const Frame& frame : Frames)
+	{
+		const FrameMemory frameMemory = frame.GetMemoryUsage();
+
+		memory.Total += frameMemory;
+		if (frameMemory.GetTotal() > memory.Largest.GetTotal())
+			memory.Largest = frameMemory;
+	}
+
+	return memory;
+}
+
 void Dataset::ReadFile(Partio::ParticlesDataMutable* file)
 {
 	Partio::ParticleAttribute attrPosition;
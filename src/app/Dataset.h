@@ -34,6 +34,28 @@ public:
 	uint32_t m_Width, m_Height, m_Depth;
 };
 
+// Bytes held by a frame. The neighborhood searches are estimated, because
+// CompactNSearch does not expose the size of its hash tables.
+struct FrameMemory
+{
+	size_t Particles = 0;
+	size_t ParticlesExt = 0;
+	size_t Search = 0;
+	size_t SearchExt = 0;
+	size_t DensityGrid = 0; // nodes and their particle indices
+
+	size_t GetTotal() const;
+
+	FrameMemory& operator+=(const FrameMemory& other);
+};
+
+struct DatasetMemory
+{
+	FrameMemory Total; // of all frames
+	FrameMemory Largest;
+	size_t NumFrames = 0; // resident in host memory
+};
+
 class Frame
 {
 public:
@@ -51,6 +73,9 @@ public:
 	void ComputeAABB();
 	void BuildDensityGrid(float isoDensity);
 
+	// Walks all density grid nodes, not meant to be called every frame.
+	FrameMemory GetMemoryUsage() const;
+
 	std::vector<Particle> m_Particles;
 	CompactNSearch::NeighborhoodSearch m_Search;
 	
@@ -75,18 +100,22 @@ public:
 			float particleRadiusMultiplier,
 			int count = -1);
 
-	// generates a fluid block by randomly sampling a cube
+	// generates a fluid block by randomly sampling a cube, the same one on
+	// every platform for a given seed
 	static void makeCube(Dataset& dataset,
 						 float extent,
 						 size_t numParticles,
 						 float particleRadius,
-						 float particleRadiusMultiplier);
+						 float particleRadiusMultiplier,
+						 std::optional<uint32_t> seed = {});
 
 	~Dataset();
 
 	std::vector<uint32_t> GetNeighbors(const glm::vec3& position, uint32_t index);
 	std::vector<uint32_t> GetNeighborsExt(const glm::vec3& position, uint32_t frame);
 
+	DatasetMemory GetMemoryUsage() const;
+
 	float ParticleRadius;
 	float ParticleRadiusExt;
 	float ParticleRadiusInv;
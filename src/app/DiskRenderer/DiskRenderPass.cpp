@@ -39,7 +39,8 @@ void DiskRenderPass::Exit()
 	VertexShader.Destroy();
 	FragmentShader.Destroy();
 
-	UniformBuffer.Destroy();
+	for (Buffer& buffer : UniformBuffers)
+		buffer.Destroy();
 }
 
 void DiskRenderPass::Begin()
@@ -87,7 +88,7 @@ void DiskRenderPass::Begin()
 		vk::PipelineBindPoint::eGraphics,
 		PipelineLayout,
 		0,
-		DescriptorSet,
+		DescriptorSets[Vulkan.CurrentFrame],
 		{}
 	);
 }
@@ -131,8 +132,8 @@ void DiskRenderPass::CreatePipeline()
 	// vertex input
 	vk::PipelineVertexInputStateCreateInfo vertexInputState;
 	vertexInputState
-		.setVertexAttributeDescriptions(DiskRenderer::Vertex::Attributes)
-		.setVertexBindingDescriptions(DiskRenderer::Vertex::Binding);
+		.setVertexAttributeDescriptions(DiskRenderer::ParticleInstance::Attributes)
+		.setVertexBindingDescriptions(DiskRenderer::ParticleInstance::Binding);
 
 	// input assembly
 	vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState;
@@ -216,7 +217,7 @@ void DiskRenderPass::CreatePipeline()
 		.setPViewportState(&viewportState)
 		.setRenderPass(nullptr);
 
-	auto r = Vulkan.Device.createGraphicsPipeline({}, pipelineCreateInfo);
+	auto r = Vulkan.Device.createGraphicsPipeline(Vulkan.PipelineCache, pipelineCreateInfo);
 	HZ_ASSERT(r.result == vk::Result::eSuccess, "Pipeline creation failed!");
 	Pipeline = r.value;
 }
@@ -236,24 +237,29 @@ void DiskRenderPass::CreateDescriptorSetLayout()
 
 void DiskRenderPass::CreateDescriptorSet()
 {
+	PerFrame<vk::DescriptorSetLayout> layouts;
+	layouts.fill(DescriptorSetLayout);
+
 	vk::DescriptorSetAllocateInfo info;
 	info.setDescriptorPool(Vulkan.DescriptorPool)
-		.setDescriptorSetCount(1)
-		.setSetLayouts(DescriptorSetLayout);
+		.setSetLayouts(layouts);
 
 	auto r = Vulkan.Device.allocateDescriptorSets(info);
-	HZ_ASSERT(r.size() == 1, "allocateDescriptorSets failed!");
-	DescriptorSet = r.front();
+	HZ_ASSERT(r.size() == MAX_FRAMES_IN_FLIGHT, "allocateDescriptorSets failed!");
+	std::copy(r.begin(), r.end(), DescriptorSets.begin());
 }
 
 void DiskRenderPass::CreateUniformBuffer()
 {
-	UniformBuffer.Create(
-		sizeof(Uniforms),
-		vk::BufferUsageFlagBits::eUniformBuffer,
-		vk::MemoryPropertyFlagBits::eHostVisible |
-		vk::MemoryPropertyFlagBits::eHostCoherent
-	);
+	for (Buffer& buffer : UniformBuffers)
+	{
+		buffer.Create(
+			sizeof(Uniforms),
+			vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible |
+			vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+	}
 }
 
 void DiskRenderPass::UpdateUniforms()
@@ -263,14 +269,16 @@ void DiskRenderPass::UpdateUniforms()
 	Uniforms.Radius = Renderer.Dataset->ParticleRadius;
 
 	// copy
-	UniformBuffer.Map(&Uniforms, sizeof(Uniforms));
+	UniformBuffers[Vulkan.CurrentFrame].Map(&Uniforms, sizeof(Uniforms));
 }
 
 void DiskRenderPass::UpdateDescriptorSets()
 {
+	const uint32_t frame = Vulkan.CurrentFrame;
+
 	vk::DescriptorBufferInfo bufferInfo;
 	bufferInfo
-		.setBuffer(UniformBuffer)
+		.setBuffer(UniformBuffers[frame])
 		.setOffset(0)
 		.setRange(VK_WHOLE_SIZE);
 
@@ -281,7 +289,7 @@ void DiskRenderPass::UpdateDescriptorSets()
 		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 		.setDstArrayElement(0)
 		.setDstBinding(0)
-		.setDstSet(DescriptorSet);
+		.setDstSet(DescriptorSets[frame]);
 
 	std::array<vk::WriteDescriptorSet, 1> writes = {
 		writeUniform
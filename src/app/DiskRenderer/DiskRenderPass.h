@@ -2,6 +2,7 @@
 
 #include <engine/renderer/objects/Shader.h>
 #include <engine/renderer/objects/Buffer.h>
+#include <engine/renderer/objects/PerFrame.h>
 
 class DiskRenderer;
 
@@ -38,7 +39,7 @@ public:
 	vk::PipelineLayout PipelineLayout;
 
 	vk::DescriptorSetLayout DescriptorSetLayout;
-	vk::DescriptorSet DescriptorSet;
+	PerFrame<vk::DescriptorSet> DescriptorSets;
 
 	Shader VertexShader, FragmentShader;
 
@@ -52,5 +53,5 @@ public:
 		float Radius; // world space
 	} Uniforms;
 
-	Buffer UniformBuffer;
+	PerFrame<Buffer> UniformBuffers;
 };
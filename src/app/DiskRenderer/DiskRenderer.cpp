@@ -15,21 +15,14 @@
 
 // ------------------------------------------------------------------------
 
-decltype(DiskRenderer::Vertex::Attributes) DiskRenderer::Vertex::Attributes = {
-	// uint32_t location
-	// uint32_t binding
-	// Format format = Format::eUndefined
-	// uint32_t offset
-	vk::VertexInputAttributeDescription{ 0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, Position) },
-	vk::VertexInputAttributeDescription{ 1, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, UV) },
+decltype(DiskRenderer::ParticleInstance::Attributes) DiskRenderer::ParticleInstance::Attributes = {
+	vk::VertexInputAttributeDescription{ 0, 0, vk::Format::eR32G32B32Sfloat, 0 },
 };
 
-const int bla = offsetof(DiskRenderer::Vertex, UV);
-
-decltype(DiskRenderer::Vertex::Binding) DiskRenderer::Vertex::Binding = vk::VertexInputBindingDescription{
+decltype(DiskRenderer::ParticleInstance::Binding) DiskRenderer::ParticleInstance::Binding = vk::VertexInputBindingDescription{
 	0, // uint32_t binding
-	sizeof(DiskRenderer::Vertex), // uint32_t stride
-	vk::VertexInputRate::eVertex, // VertexInputRate inputRate
+	sizeof(Particle), // uint32_t stride
+	vk::VertexInputRate::eInstance, // VertexInputRate inputRate
 };
 
 // ------------------------------------------------------------------------
@@ -51,7 +44,10 @@ void DiskRenderer::Init(::Dataset* dataset)
 	DiskRenderPass.Init();
 	//CoordinateSystemRenderPass.Init();
 
-	VertexBuffer.Create(6 * Dataset->MaxParticles * sizeof(Vertex));
+	for (VertexBuffer& buffer : ParticleBuffers)
+		buffer.Create(Dataset->MaxParticles * sizeof(Particle));
+
+	UploadedFrames.fill(-1);
 
 	// init camera
 	Camera = Camera3D(
@@ -66,8 +62,12 @@ void DiskRenderer::Init(::Dataset* dataset)
 
 void DiskRenderer::Exit()
 {
+	// frames in flight may still use the resources
+	Vulkan.Device.waitIdle();
+
 	delete Dataset;
-	VertexBuffer.Destroy();
+	for (VertexBuffer& buffer : ParticleBuffers)
+		buffer.Destroy();
 
 	//CoordinateSystemRenderPass.Exit();
 	DiskRenderPass.Exit();
@@ -95,6 +95,19 @@ void DiskRenderer::Render()
 									vk::PipelineStageFlagBits::eEarlyFragmentTests |
 									vk::PipelineStageFlagBits::eLateFragmentTests);
 
+	// the depth buffer is shared by all frames in flight, the previous one may still test against it
+	vk::MemoryBarrier depthBarrier(vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+								   vk::AccessFlagBits::eDepthStencilAttachmentRead |
+								   vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+	Vulkan.CommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eLateFragmentTests,
+										 vk::PipelineStageFlagBits::eEarlyFragmentTests |
+										 vk::PipelineStageFlagBits::eLateFragmentTests,
+										 {},
+										 depthBarrier,
+										 {},
+										 {});
+
 	TransitionImageLayout(Vulkan.CommandBuffer,
 						  Vulkan.SwapchainImages[Vulkan.CurrentImageIndex],
 						  vk::ImageLayout::eUndefined,
@@ -130,40 +143,40 @@ void DiskRenderer::CollectRenderData()
 {
 	PROFILE_FUNCTION();
 
-	NumVertices = 0;
+	const Frame& frame = Dataset->Frames[CurrentFrame];
+	NumParticles = uint32_t(frame.m_Particles.size());
 
-	Vertex* target = reinterpret_cast<Vertex*>(
-		Vulkan.Device.mapMemory(VertexBuffer.BufferCPU.Memory, 0, VertexBuffer.BufferCPU.Size));
+	VertexBuffer& particleBuffer = ParticleBuffers[Vulkan.CurrentFrame];
+	int& uploadedFrame = UploadedFrames[Vulkan.CurrentFrame];
 
-	for (auto& particle : Dataset->Frames[CurrentFrame].m_Particles)
-	{
-		glm::vec3 x = CameraController.System[0];
-		glm::vec3 y = CameraController.System[1];
-
-		glm::vec3 p = particle;
-		const float R = Dataset->ParticleRadius;
-
-		glm::vec3 topLeft     = p + R * (-x + y);
-		glm::vec3 topRight    = p + R * (+x + y);
-		glm::vec3 bottomLeft  = p + R * (-x - y);
-		glm::vec3 bottomRight = p + R * (+x - y);
-
-		target[NumVertices++] = { topLeft, { 0, 0 } };
-		target[NumVertices++] = { bottomLeft, { 0, 1 } };
-		target[NumVertices++] = { topRight, { 1, 0 } };
-		target[NumVertices++] = { topRight, { 1, 0 } };
-		target[NumVertices++] = { bottomLeft, { 0, 1 } };
-		target[NumVertices++] = { bottomRight, { 1, 1 } };
-	}
+	// positions only change with the dataset frame, the camera is applied in the shader
+	if (CurrentFrame == uploadedFrame || NumParticles == 0)
+		return;
 
-	Vulkan.Device.unmapMemory(VertexBuffer.BufferCPU.Memory);
+	const vk::DeviceSize size = NumParticles * sizeof(Particle);
+	particleBuffer.Stage((void*)frame.m_Particles.data(), size);
 
-	// copy
-	if (NumVertices > 0)
-	{
-		OneTimeCommand cmd;
-		VertexBuffer.Copy(cmd);
-	}
+	// The copy is recorded into the frame's command buffer ahead of the disk
+	// pass, the staging buffer is not reused before the frame has finished.
+	vk::BufferCopy region{ 0, 0, size };
+	Vulkan.CommandBuffer.copyBuffer(particleBuffer.BufferCPU, particleBuffer.BufferGPU, region);
+
+	vk::BufferMemoryBarrier barrier;
+	barrier
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead)
+		.setBuffer(particleBuffer.BufferGPU)
+		.setOffset(0)
+		.setSize(size);
+
+	Vulkan.CommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+										 vk::PipelineStageFlagBits::eVertexInput,
+										 {},
+										 {},
+										 barrier,
+										 {});
+
+	uploadedFrame = CurrentFrame;
 }
 
 void DiskRenderer::DrawParticles()
@@ -171,10 +184,11 @@ void DiskRenderer::DrawParticles()
 	vk::DeviceSize offset = 0;
 	Vulkan.CommandBuffer.bindVertexBuffers(
 		0,
-		VertexBuffer.BufferGPU.Buffer,
+		ParticleBuffers[Vulkan.CurrentFrame].BufferGPU.Buffer,
 		offset);
 
-	Vulkan.CommandBuffer.draw(NumVertices, 1, 0, 0);
+	// one billboard of two triangles per particle
+	Vulkan.CommandBuffer.draw(6, NumParticles, 0, 0);
 }
 
 float DiskRenderer::ComputeDensity(const glm::vec3& x)
@@ -14,12 +14,11 @@ class Event;
 class DiskRenderer
 {
 public:
-	struct Vertex
+	// Particles are drawn as instanced billboards. Each instance reads one
+	// position, the quad is expanded in disk.vert.
+	struct ParticleInstance
 	{
-		glm::vec3 Position;
-		glm::vec2 UV;
-
-		static const std::array<vk::VertexInputAttributeDescription, 2> Attributes;
+		static const std::array<vk::VertexInputAttributeDescription, 1> Attributes;
 		static const vk::VertexInputBindingDescription Binding;
 	};
 
@@ -48,12 +47,15 @@ public:
 
 	BilateralBuffer DepthBuffer;
 
-	VertexBuffer VertexBuffer;
+	// one per frame in flight, so that uploading a new dataset frame never
+	// touches buffers still read by the previous frame
+	PerFrame<VertexBuffer> ParticleBuffers;
+	PerFrame<int> UploadedFrames;
 
 	Dataset* Dataset = nullptr;
 	int CurrentFrame = 0;
 
-	uint32_t NumVertices = 0;
+	uint32_t NumParticles = 0;
 
 	Camera3D Camera;
 	CameraController3D CameraController;
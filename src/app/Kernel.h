@@ -2,6 +2,31 @@
 
 class Dataset;
 
+// Instruction set used by the batch kernel evaluations. The best level
+// supported by the CPU is selected at startup; lower levels can be forced,
+// e.g. to compare against the scalar fallback.
+enum class KernelSimdLevel
+{
+    Scalar,
+    AVX2,
+    AVX512,
+};
+
+KernelSimdLevel GetKernelSimdLevel();
+KernelSimdLevel GetMaxKernelSimdLevel();
+void SetKernelSimdLevel(KernelSimdLevel level);
+const char* KernelSimdLevelToString(KernelSimdLevel level);
+
+// Kernel constants shared by the batch evaluations.
+struct KernelBatchParams
+{
+    float G[9]; // column-major, only used by the anisotropic kernel
+    float h;
+    float h_squared;
+    float h_inv;
+    float sig;
+};
+
 class CubicSplineKernel
 {
 public:
@@ -13,6 +38,15 @@ public:
 
     glm::vec3 gradW(const glm::vec3& r);
 
+    // Batch evaluations over n relative positions given as SoA arrays.
+    // These return sums over all neighbors (see KernelBatch.cpp).
+    float W(const float* x, const float* y, const float* z, uint32_t n) const;
+    glm::vec3 gradW(const float* x, const float* y, const float* z, uint32_t n) const;
+    float WgradW(const float* x, const float* y, const float* z, uint32_t n, glm::vec3& grad) const;
+
+private:
+    KernelBatchParams GetBatchParams() const;
+
 private:
     float h;
     float h_squared;
@@ -34,6 +68,21 @@ public:
                     const float detG,
                     const glm::vec3& r);
 
+    // Batch evaluations over n relative (untransformed) positions given as
+    // SoA arrays. These return sums over all neighbors (see KernelBatch.cpp).
+    float W(const glm::mat3& G, const float detG,
+            const float* x, const float* y, const float* z, uint32_t n) const;
+
+    glm::vec3 gradW(const glm::mat3& G, const float detG,
+                    const float* x, const float* y, const float* z, uint32_t n) const;
+
+    float WgradW(const glm::mat3& G, const float detG,
+                 const float* x, const float* y, const float* z, uint32_t n,
+                 glm::vec3& grad) const;
+
+private:
+    KernelBatchParams GetBatchParams(const glm::mat3& G, const float detG) const;
+
 private:
     float h;
     float h_squared;
@@ -55,3 +104,105 @@ private:
     float h;
     float h_inv;
 };
+
+// -------------------------------------------------------------------
+// Kernel evaluations are defined inline so that the ray marcher can inline
+// them into its neighbor loops.
+
+inline float CubicSplineKernel::W(const glm::vec3& r)
+{
+    float q = glm::dot(r, r);
+
+    if (q >= h_squared)
+        return 0.0f;
+
+    q = glm::sqrt(q) * h_inv;
+
+    if (q >= 0.5f)
+    {
+        const float q_ = 1.0f - q;
+        return sig_d * (2.0f * q_ * q_ * q_);
+    }
+    
+    return sig_d * (6.0f * (q * q * q - q * q) + 1.0f);
+}
+
+inline glm::vec3 CubicSplineKernel::gradW(const glm::vec3& r)
+{
+    const float rn = glm::dot(r, r);
+
+    if (rn >= h_squared)
+        return glm::vec3(0);
+
+    const float r_length = glm::sqrt(rn);
+    const float q = r_length * h_inv;
+    const glm::vec3 gradQ = glm::normalize(r) / (r_length * h);
+
+    if (q >= 0.5f)
+    {
+        float q_ = 1.0f - q;
+        return -sig_d * gradQ * (6.0f * q_ * q_);
+    }
+
+    return sig_d * gradQ * (6.0f * (3.0f * q * q - 2.0f * q));
+}
+
+// -------------------------------------------------------------------
+
+inline float AnisotropicKernel::W(const glm::mat3& G,
+                                  const float detG,
+                                  const glm::vec3& _r)
+{
+    const glm::vec3 r = G * _r;
+
+    float q = glm::dot(r, r);
+
+    if (q >= h_squared)
+        return 0.0f;
+
+    q = glm::sqrt(q) * h_inv;
+
+    if (q >= 0.5f)
+    {
+        const float q_ = 1.0f - q;
+        return sig * detG * (2.0f * q_ * q_ * q_);
+    }
+
+    return sig * detG * (6.0f * (q * q * q - q * q) + 1.0f);
+}
+
+inline glm::vec3 AnisotropicKernel::gradW(const glm::mat3& G,
+                                          const float detG,
+                                          const glm::vec3& _r)
+{
+    const glm::vec3 r = G * _r;
+
+    const float rn = glm::dot(r, r);
+
+    if (rn >= h_squared)
+        return glm::vec3(0);
+
+    const float r_length = glm::sqrt(rn);
+    const float q = r_length * h_inv;
+    const glm::vec3 gradQ = glm::normalize(r) / (r_length * h);
+
+    if (q >= 0.5f)
+    {
+        float q_ = 1.0f - q;
+        return -sig * detG * gradQ * (6.0f * q_ * q_);
+    }
+
+    return sig * detG * gradQ * (6.0f * (3.0f * q * q - 2.0f * q));
+}
+
+// -------------------------------------------------------------------
+
+inline float CubicKernel::W(const glm::vec3& r)
+{
+    float d = glm::length(r);
+    
+    if (d >= h) return 0.0f;
+    
+    float k = d * h_inv;
+    return 1.0f - k * k * k;
+}
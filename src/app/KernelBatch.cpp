@@ -0,0 +1,496 @@
+#include <engine/hzpch.h>
+
+#include "Kernel.h"
+#include "Simd.h"
+
+/*
+* Batch evaluation of the SPH kernels over SoA neighbor arrays.
+*
+* All variants evaluate the piecewise cubic spline branchlessly: both pieces
+* are computed for every lane and blended, and lanes outside of the support
+* (or past the end of the arrays) are masked to zero. The instruction set is
+* chosen once at startup from the features reported by the CPU.
+*/
+
+// -------------------------------------------------------------------
+
+enum KernelBatchMode
+{
+    BatchW = 1,
+    BatchGradW = 2,
+    BatchWGradW = BatchW | BatchGradW,
+};
+
+using KernelBatchFunction = float(*)(const KernelBatchParams& p,
+                                     const float* x,
+                                     const float* y,
+                                     const float* z,
+                                     uint32_t n,
+                                     glm::vec3* grad);
+
+// -------------------------------------------------------------------
+// SCALAR
+
+template <bool Transform, int Mode>
+static float KernelBatch_Scalar(const KernelBatchParams& p,
+                                const float* x,
+                                const float* y,
+                                const float* z,
+                                uint32_t n,
+                                glm::vec3* grad)
+{
+    float sumW = 0.0f;
+    float gx = 0.0f, gy = 0.0f, gz = 0.0f;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        float rx = x[i], ry = y[i], rz = z[i];
+
+        if constexpr (Transform)
+        {
+            const float tx = p.G[0] * rx + p.G[3] * ry + p.G[6] * rz;
+            const float ty = p.G[1] * rx + p.G[4] * ry + p.G[7] * rz;
+            const float tz = p.G[2] * rx + p.G[5] * ry + p.G[8] * rz;
+            rx = tx; ry = ty; rz = tz;
+        }
+
+        const float rn = rx * rx + ry * ry + rz * rz;
+        const bool inside = rn < p.h_squared;
+
+        const float q = std::sqrt(rn) * p.h_inv;
+        const float q_ = 1.0f - q;
+        const bool outer = q >= 0.5f;
+
+        if constexpr ((Mode & BatchW) != 0)
+        {
+            const float w = outer ?
+                2.0f * q_ * q_ * q_ :
+                6.0f * (q * q * q - q * q) + 1.0f;
+
+            sumW += inside ? w : 0.0f;
+        }
+
+        if constexpr ((Mode & BatchGradW) != 0)
+        {
+            const float f = outer ?
+                -6.0f * q_ * q_ :
+                6.0f * (3.0f * q * q - 2.0f * q);
+
+            // gradQ = normalize(r) / (|r| h) = r / (|r|^2 h)
+            const float s = (inside && rn > 0.0f) ? f / (rn * p.h) : 0.0f;
+
+            gx += s * rx;
+            gy += s * ry;
+            gz += s * rz;
+        }
+    }
+
+    if constexpr ((Mode & BatchGradW) != 0)
+        *grad = p.sig * glm::vec3(gx, gy, gz);
+
+    return p.sig * sumW;
+}
+
+// -------------------------------------------------------------------
+// AVX2
+
+#if SIMD_X86
+
+SIMD_TARGET_AVX2
+static inline float HorizontalSum_AVX2(__m256 v)
+{
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+
+    __m128 shuf = _mm_movehdup_ps(lo);
+    __m128 sums = _mm_add_ps(lo, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+
+    return _mm_cvtss_f32(sums);
+}
+
+template <bool Transform, int Mode>
+SIMD_TARGET_AVX2
+static float KernelBatch_AVX2(const KernelBatchParams& p,
+                              const float* x,
+                              const float* y,
+                              const float* z,
+                              uint32_t n,
+                              glm::vec3* grad)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 six = _mm256_set1_ps(6.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 h = _mm256_set1_ps(p.h);
+    const __m256 h_squared = _mm256_set1_ps(p.h_squared);
+    const __m256 h_inv = _mm256_set1_ps(p.h_inv);
+    const __m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    __m256 sumW = zero;
+    __m256 gx = zero, gy = zero, gz = zero;
+
+    for (uint32_t i = 0; i < n; i += 8)
+    {
+        __m256 rx, ry, rz;
+        __m256 valid;
+
+        if (n - i >= 8)
+        {
+            rx = _mm256_loadu_ps(x + i);
+            ry = _mm256_loadu_ps(y + i);
+            rz = _mm256_loadu_ps(z + i);
+            valid = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        }
+        else
+        {
+            const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(int(n - i)), laneIndices);
+            rx = _mm256_maskload_ps(x + i, mask);
+            ry = _mm256_maskload_ps(y + i, mask);
+            rz = _mm256_maskload_ps(z + i, mask);
+            valid = _mm256_castsi256_ps(mask);
+        }
+
+        if constexpr (Transform)
+        {
+            const __m256 tx = _mm256_fmadd_ps(_mm256_set1_ps(p.G[0]), rx,
+                              _mm256_fmadd_ps(_mm256_set1_ps(p.G[3]), ry,
+                              _mm256_mul_ps(_mm256_set1_ps(p.G[6]), rz)));
+            const __m256 ty = _mm256_fmadd_ps(_mm256_set1_ps(p.G[1]), rx,
+                              _mm256_fmadd_ps(_mm256_set1_ps(p.G[4]), ry,
+                              _mm256_mul_ps(_mm256_set1_ps(p.G[7]), rz)));
+            const __m256 tz = _mm256_fmadd_ps(_mm256_set1_ps(p.G[2]), rx,
+                              _mm256_fmadd_ps(_mm256_set1_ps(p.G[5]), ry,
+                              _mm256_mul_ps(_mm256_set1_ps(p.G[8]), rz)));
+            rx = tx; ry = ty; rz = tz;
+        }
+
+        const __m256 rn = _mm256_fmadd_ps(rx, rx, _mm256_fmadd_ps(ry, ry, _mm256_mul_ps(rz, rz)));
+        const __m256 inside = _mm256_and_ps(valid, _mm256_cmp_ps(rn, h_squared, _CMP_LT_OQ));
+
+        const __m256 q = _mm256_mul_ps(_mm256_sqrt_ps(rn), h_inv);
+        const __m256 q_ = _mm256_sub_ps(one, q);
+        const __m256 outer = _mm256_cmp_ps(q, half, _CMP_GE_OQ);
+
+        if constexpr ((Mode & BatchW) != 0)
+        {
+            // 6 (q^3 - q^2) + 1 = 6 q^2 (q - 1) + 1
+            const __m256 q2 = _mm256_mul_ps(q, q);
+            const __m256 wInner = _mm256_fmadd_ps(_mm256_mul_ps(six, q2), _mm256_sub_ps(q, one), one);
+            const __m256 wOuter = _mm256_mul_ps(two, _mm256_mul_ps(q_, _mm256_mul_ps(q_, q_)));
+            const __m256 w = _mm256_blendv_ps(wInner, wOuter, outer);
+
+            sumW = _mm256_add_ps(sumW, _mm256_and_ps(w, inside));
+        }
+
+        if constexpr ((Mode & BatchGradW) != 0)
+        {
+            // 6 (3 q^2 - 2 q) = 6 q (3 q - 2)
+            const __m256 fInner = _mm256_mul_ps(_mm256_mul_ps(six, q), _mm256_fmsub_ps(three, q, two));
+            const __m256 fOuter = _mm256_mul_ps(_mm256_set1_ps(-6.0f), _mm256_mul_ps(q_, q_));
+            const __m256 f = _mm256_blendv_ps(fInner, fOuter, outer);
+
+            const __m256 mask = _mm256_and_ps(inside, _mm256_cmp_ps(rn, zero, _CMP_GT_OQ));
+            const __m256 s = _mm256_and_ps(_mm256_div_ps(f, _mm256_mul_ps(rn, h)), mask);
+
+            gx = _mm256_fmadd_ps(s, rx, gx);
+            gy = _mm256_fmadd_ps(s, ry, gy);
+            gz = _mm256_fmadd_ps(s, rz, gz);
+        }
+    }
+
+    if constexpr ((Mode & BatchGradW) != 0)
+    {
+        *grad = p.sig * glm::vec3(HorizontalSum_AVX2(gx),
+                                  HorizontalSum_AVX2(gy),
+                                  HorizontalSum_AVX2(gz));
+    }
+
+    if constexpr ((Mode & BatchW) != 0)
+        return p.sig * HorizontalSum_AVX2(sumW);
+
+    return 0.0f;
+}
+
+// -------------------------------------------------------------------
+// AVX-512
+
+template <bool Transform, int Mode>
+SIMD_TARGET_AVX512
+static float KernelBatch_AVX512(const KernelBatchParams& p,
+                                const float* x,
+                                const float* y,
+                                const float* z,
+                                uint32_t n,
+                                glm::vec3* grad)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 three = _mm512_set1_ps(3.0f);
+    const __m512 six = _mm512_set1_ps(6.0f);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 h = _mm512_set1_ps(p.h);
+    const __m512 h_squared = _mm512_set1_ps(p.h_squared);
+    const __m512 h_inv = _mm512_set1_ps(p.h_inv);
+
+    __m512 sumW = zero;
+    __m512 gx = zero, gy = zero, gz = zero;
+
+    for (uint32_t i = 0; i < n; i += 16)
+    {
+        const __mmask16 valid = n - i >= 16 ?
+            __mmask16(0xFFFF) :
+            __mmask16((1u << (n - i)) - 1u);
+
+        __m512 rx = _mm512_maskz_loadu_ps(valid, x + i);
+        __m512 ry = _mm512_maskz_loadu_ps(valid, y + i);
+        __m512 rz = _mm512_maskz_loadu_ps(valid, z + i);
+
+        if constexpr (Transform)
+        {
+            const __m512 tx = _mm512_fmadd_ps(_mm512_set1_ps(p.G[0]), rx,
+                              _mm512_fmadd_ps(_mm512_set1_ps(p.G[3]), ry,
+                              _mm512_mul_ps(_mm512_set1_ps(p.G[6]), rz)));
+            const __m512 ty = _mm512_fmadd_ps(_mm512_set1_ps(p.G[1]), rx,
+                              _mm512_fmadd_ps(_mm512_set1_ps(p.G[4]), ry,
+                              _mm512_mul_ps(_mm512_set1_ps(p.G[7]), rz)));
+            const __m512 tz = _mm512_fmadd_ps(_mm512_set1_ps(p.G[2]), rx,
+                              _mm512_fmadd_ps(_mm512_set1_ps(p.G[5]), ry,
+                              _mm512_mul_ps(_mm512_set1_ps(p.G[8]), rz)));
+            rx = tx; ry = ty; rz = tz;
+        }
+
+        const __m512 rn = _mm512_fmadd_ps(rx, rx, _mm512_fmadd_ps(ry, ry, _mm512_mul_ps(rz, rz)));
+        const __mmask16 inside = _mm512_mask_cmp_ps_mask(valid, rn, h_squared, _CMP_LT_OQ);
+
+        const __m512 q = _mm512_mul_ps(_mm512_sqrt_ps(rn), h_inv);
+        const __m512 q_ = _mm512_sub_ps(one, q);
+        const __mmask16 outer = _mm512_cmp_ps_mask(q, half, _CMP_GE_OQ);
+
+        if constexpr ((Mode & BatchW) != 0)
+        {
+            const __m512 q2 = _mm512_mul_ps(q, q);
+            const __m512 wInner = _mm512_fmadd_ps(_mm512_mul_ps(six, q2), _mm512_sub_ps(q, one), one);
+            const __m512 wOuter = _mm512_mul_ps(two, _mm512_mul_ps(q_, _mm512_mul_ps(q_, q_)));
+            const __m512 w = _mm512_mask_blend_ps(outer, wInner, wOuter);
+
+            sumW = _mm512_mask_add_ps(sumW, inside, sumW, w);
+        }
+
+        if constexpr ((Mode & BatchGradW) != 0)
+        {
+            const __m512 fInner = _mm512_mul_ps(_mm512_mul_ps(six, q), _mm512_fmsub_ps(three, q, two));
+            const __m512 fOuter = _mm512_mul_ps(_mm512_set1_ps(-6.0f), _mm512_mul_ps(q_, q_));
+            const __m512 f = _mm512_mask_blend_ps(outer, fInner, fOuter);
+
+            const __mmask16 mask = _mm512_mask_cmp_ps_mask(inside, rn, zero, _CMP_GT_OQ);
+            const __m512 s = _mm512_maskz_div_ps(mask, f, _mm512_mul_ps(rn, h));
+
+            gx = _mm512_fmadd_ps(s, rx, gx);
+            gy = _mm512_fmadd_ps(s, ry, gy);
+            gz = _mm512_fmadd_ps(s, rz, gz);
+        }
+    }
+
+    if constexpr ((Mode & BatchGradW) != 0)
+    {
+        *grad = p.sig * glm::vec3(_mm512_reduce_add_ps(gx),
+                                  _mm512_reduce_add_ps(gy),
+                                  _mm512_reduce_add_ps(gz));
+    }
+
+    if constexpr ((Mode & BatchW) != 0)
+        return p.sig * _mm512_reduce_add_ps(sumW);
+
+    return 0.0f;
+}
+
+#endif
+
+// -------------------------------------------------------------------
+// DISPATCH
+
+// [transform][mode - 1]
+using KernelBatchTable = KernelBatchFunction[2][3];
+
+#define KERNEL_BATCH_TABLE(f) { \
+        { &f<false, BatchW>, &f<false, BatchGradW>, &f<false, BatchWGradW> }, \
+        { &f<true, BatchW>, &f<true, BatchGradW>, &f<true, BatchWGradW> }, \
+    }
+
+static const KernelBatchTable s_KernelBatch_Scalar = KERNEL_BATCH_TABLE(KernelBatch_Scalar);
+
+#if SIMD_X86
+static const KernelBatchTable s_KernelBatch_AVX2 = KERNEL_BATCH_TABLE(KernelBatch_AVX2);
+static const KernelBatchTable s_KernelBatch_AVX512 = KERNEL_BATCH_TABLE(KernelBatch_AVX512);
+#endif
+
+static KernelSimdLevel DetectKernelSimdLevel()
+{
+#if SIMD_X86
+    #if defined(_MSC_VER)
+        int info[4];
+
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        const bool fma = (info[2] & (1 << 12)) != 0;
+
+        if (maxLeaf < 7 || !osxsave || !avx || !fma)
+            return KernelSimdLevel::Scalar;
+
+        // check that the OS saves YMM (and ZMM) registers
+        const unsigned long long xcr0 = _xgetbv(0);
+        const bool osAVX = (xcr0 & 0x6) == 0x6;
+        const bool osAVX512 = (xcr0 & 0xE6) == 0xE6;
+
+        __cpuidex(info, 7, 0);
+        const bool avx2 = (info[1] & (1 << 5)) != 0;
+        const bool avx512f = (info[1] & (1 << 16)) != 0;
+
+        if (avx512f && osAVX512)
+            return KernelSimdLevel::AVX512;
+
+        if (avx2 && osAVX)
+            return KernelSimdLevel::AVX2;
+    #else
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512f"))
+            return KernelSimdLevel::AVX512;
+
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return KernelSimdLevel::AVX2;
+    #endif
+#endif
+
+    return KernelSimdLevel::Scalar;
+}
+
+static const KernelBatchTable* SelectKernelBatchTable(KernelSimdLevel level)
+{
+    switch (level)
+    {
+#if SIMD_X86
+        case KernelSimdLevel::AVX512: return &s_KernelBatch_AVX512;
+        case KernelSimdLevel::AVX2: return &s_KernelBatch_AVX2;
+#endif
+        default: return &s_KernelBatch_Scalar;
+    }
+}
+
+static const KernelSimdLevel s_MaxKernelSimdLevel = DetectKernelSimdLevel();
+static std::atomic<KernelSimdLevel> s_KernelSimdLevel = s_MaxKernelSimdLevel;
+static std::atomic<const KernelBatchTable*> s_KernelBatch = SelectKernelBatchTable(s_MaxKernelSimdLevel);
+
+static const KernelBatchTable* GetKernelBatchTable()
+{
+    return s_KernelBatch.load(std::memory_order_relaxed);
+}
+
+KernelSimdLevel GetKernelSimdLevel()
+{
+    return s_KernelSimdLevel.load();
+}
+
+KernelSimdLevel GetMaxKernelSimdLevel()
+{
+    return s_MaxKernelSimdLevel;
+}
+
+void SetKernelSimdLevel(KernelSimdLevel level)
+{
+    level = std::min(level, s_MaxKernelSimdLevel);
+
+    s_KernelSimdLevel.store(level);
+    s_KernelBatch.store(SelectKernelBatchTable(level));
+}
+
+const char* KernelSimdLevelToString(KernelSimdLevel level)
+{
+    switch (level)
+    {
+        case KernelSimdLevel::AVX512: return "AVX-512";
+        case KernelSimdLevel::AVX2: return "AVX2";
+        default: return "Scalar";
+    }
+}
+
+// -------------------------------------------------------------------
+// CubicSplineKernel
+
+KernelBatchParams CubicSplineKernel::GetBatchParams() const
+{
+    KernelBatchParams p;
+    p.h = h;
+    p.h_squared = h_squared;
+    p.h_inv = h_inv;
+    p.sig = sig_d;
+
+    return p;
+}
+
+float CubicSplineKernel::W(const float* x, const float* y, const float* z, uint32_t n) const
+{
+    return (*GetKernelBatchTable())[0][BatchW - 1](GetBatchParams(), x, y, z, n, nullptr);
+}
+
+glm::vec3 CubicSplineKernel::gradW(const float* x, const float* y, const float* z, uint32_t n) const
+{
+    glm::vec3 grad;
+    (*GetKernelBatchTable())[0][BatchGradW - 1](GetBatchParams(), x, y, z, n, &grad);
+    return grad;
+}
+
+float CubicSplineKernel::WgradW(const float* x, const float* y, const float* z, uint32_t n, glm::vec3& grad) const
+{
+    return (*GetKernelBatchTable())[0][BatchWGradW - 1](GetBatchParams(), x, y, z, n, &grad);
+}
+
+// -------------------------------------------------------------------
+// AnisotropicKernel
+
+KernelBatchParams AnisotropicKernel::GetBatchParams(const glm::mat3& G, const float detG) const
+{
+    KernelBatchParams p;
+
+    for (int c = 0; c < 3; c++)
+        for (int r = 0; r < 3; r++)
+            p.G[3 * c + r] = G[c][r];
+
+    p.h = h;
+    p.h_squared = h_squared;
+    p.h_inv = h_inv;
+    p.sig = sig * detG;
+
+    return p;
+}
+
+float AnisotropicKernel::W(const glm::mat3& G, const float detG,
+                           const float* x, const float* y, const float* z, uint32_t n) const
+{
+    return (*GetKernelBatchTable())[1][BatchW - 1](GetBatchParams(G, detG), x, y, z, n, nullptr);
+}
+
+glm::vec3 AnisotropicKernel::gradW(const glm::mat3& G, const float detG,
+                                   const float* x, const float* y, const float* z, uint32_t n) const
+{
+    glm::vec3 grad;
+    (*GetKernelBatchTable())[1][BatchGradW - 1](GetBatchParams(G, detG), x, y, z, n, &grad);
+    return grad;
+}
+
+float AnisotropicKernel::WgradW(const glm::mat3& G, const float detG,
+                                const float* x, const float* y, const float* z, uint32_t n,
+                                glm::vec3& grad) const
+{
+    return (*GetKernelBatchTable())[1][BatchWGradW - 1](GetBatchParams(G, detG), x, y, z, n, &grad);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// x86 instruction sets of the SIMD code paths. The level used at runtime is
+// selected once from the CPU features, see KernelSimdLevel in Kernel.h.
+#if defined(_M_X64) || defined(__x86_64__)
+    #define SIMD_X86 1
+
+    #include <immintrin.h>
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+
+        // MSVC emits AVX code for intrinsics without any per-function setup.
+        #define SIMD_TARGET_AVX2
+        #define SIMD_TARGET_AVX512
+    #else
+        #define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+        #define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+    #endif
+#else
+    #define SIMD_X86 0
+#endif
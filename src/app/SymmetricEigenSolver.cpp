@@ -0,0 +1,607 @@
+#include <engine/hzpch.h>
+
+#include "SymmetricEigenSolver.h"
+
+#include "app/Kernel.h"
+#include "app/Simd.h"
+#include "app/Utils.h"
+
+/*
+* Closed-form solver after D. Eberly, "A Robust Eigensolver for 3x3 Symmetric
+* Matrices". The eigenvalues are the roots of the characteristic polynomial,
+* computed with the trigonometric formula. The eigenvector of the most distinct
+* eigenvalue is the largest cross product of two rows of (A - lambda I), the
+* second one is solved for in its orthogonal complement and the third one
+* completes the basis.
+*/
+
+// ---------------------------------------------------------
+
+static inline glm::vec3 Multiply(const SymmetricMatrix3& A, const glm::vec3& v)
+{
+	return glm::vec3(
+		A.xx * v.x + A.xy * v.y + A.xz * v.z,
+		A.xy * v.x + A.yy * v.y + A.yz * v.z,
+		A.xz * v.x + A.yz * v.y + A.zz * v.z
+	);
+}
+
+static inline glm::vec3 ComputeEigenvector0(const SymmetricMatrix3& A, float lambda)
+{
+	const glm::vec3 r0(A.xx - lambda, A.xy, A.xz);
+	const glm::vec3 r1(A.xy, A.yy - lambda, A.yz);
+	const glm::vec3 r2(A.xz, A.yz, A.zz - lambda);
+
+	const glm::vec3 r0xr1 = glm::cross(r0, r1);
+	const glm::vec3 r0xr2 = glm::cross(r0, r2);
+	const glm::vec3 r1xr2 = glm::cross(r1, r2);
+
+	const float d0 = glm::dot(r0xr1, r0xr1);
+	const float d1 = glm::dot(r0xr2, r0xr2);
+	const float d2 = glm::dot(r1xr2, r1xr2);
+
+	if (d0 >= d1 && d0 >= d2)
+		return r0xr1 / glm::sqrt(d0);
+
+	if (d1 >= d2)
+		return r0xr2 / glm::sqrt(d1);
+
+	return r1xr2 / glm::sqrt(d2);
+}
+
+static inline void ComputeOrthogonalComplement(const glm::vec3& W, glm::vec3& U, glm::vec3& V)
+{
+	if (glm::abs(W.x) > glm::abs(W.y))
+	{
+		const float invLength = 1.0f / glm::sqrt(W.x * W.x + W.z * W.z);
+		U = glm::vec3(-W.z * invLength, 0.0f, W.x * invLength);
+	}
+	else
+	{
+		const float invLength = 1.0f / glm::sqrt(W.y * W.y + W.z * W.z);
+		U = glm::vec3(0.0f, W.z * invLength, -W.y * invLength);
+	}
+
+	V = glm::cross(W, U);
+}
+
+static inline glm::vec3 ComputeEigenvector1(const SymmetricMatrix3& A,
+											const glm::vec3& evec0,
+											float lambda)
+{
+	glm::vec3 U, V;
+	ComputeOrthogonalComplement(evec0, U, V);
+
+	// 2x2 restriction of (A - lambda I) to span(U, V)
+	const glm::vec3 AU = Multiply(A, U);
+	const glm::vec3 AV = Multiply(A, V);
+
+	float m00 = glm::dot(U, AU) - lambda;
+	float m01 = glm::dot(U, AV);
+	float m11 = glm::dot(V, AV) - lambda;
+
+	const float absM00 = glm::abs(m00);
+	const float absM01 = glm::abs(m01);
+	const float absM11 = glm::abs(m11);
+
+	if (absM00 >= absM11)
+	{
+		if (glm::max(absM00, absM01) <= 0.0f)
+			return U;
+
+		if (absM00 >= absM01)
+		{
+			m01 /= m00;
+			m00 = 1.0f / glm::sqrt(1.0f + m01 * m01);
+			m01 *= m00;
+		}
+		else
+		{
+			m00 /= m01;
+			m01 = 1.0f / glm::sqrt(1.0f + m00 * m00);
+			m00 *= m01;
+		}
+
+		return m01 * U - m00 * V;
+	}
+	else
+	{
+		if (glm::max(absM11, absM01) <= 0.0f)
+			return U;
+
+		if (absM11 >= absM01)
+		{
+			m01 /= m11;
+			m11 = 1.0f / glm::sqrt(1.0f + m01 * m01);
+			m01 *= m11;
+		}
+		else
+		{
+			m11 /= m01;
+			m01 = 1.0f / glm::sqrt(1.0f + m11 * m11);
+			m11 *= m01;
+		}
+
+		return m11 * U - m01 * V;
+	}
+}
+
+static inline void Solve(SymmetricMatrix3 A, glm::vec3& eigenvalues, glm::mat3& R)
+{
+	// scale to [-1, 1] to avoid over- and underflow
+	const float maxAbs = glm::max(
+		glm::max(glm::max(glm::abs(A.xx), glm::abs(A.xy)), glm::max(glm::abs(A.xz), glm::abs(A.yy))),
+		glm::max(glm::abs(A.yz), glm::abs(A.zz)));
+
+	if (maxAbs <= 0.0f)
+	{
+		eigenvalues = glm::vec3(0);
+		R = glm::mat3(1);
+		return;
+	}
+
+	const float invMaxAbs = 1.0f / maxAbs;
+	A.xx *= invMaxAbs; A.xy *= invMaxAbs; A.xz *= invMaxAbs;
+	A.yy *= invMaxAbs; A.yz *= invMaxAbs;
+	A.zz *= invMaxAbs;
+
+	const float offDiagonal = A.xy * A.xy + A.xz * A.xz + A.yz * A.yz;
+
+	if (offDiagonal > 0.0f)
+	{
+		const float q = (A.xx + A.yy + A.zz) / 3.0f;
+		const float b00 = A.xx - q;
+		const float b11 = A.yy - q;
+		const float b22 = A.zz - q;
+		const float p = glm::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2.0f * offDiagonal) / 6.0f);
+
+		// det((A - q I) / p) / 2
+		const float c00 = b11 * b22 - A.yz * A.yz;
+		const float c01 = A.xy * b22 - A.yz * A.xz;
+		const float c02 = A.xy * A.yz - b11 * A.xz;
+		const float halfDet = glm::clamp(
+			0.5f * (b00 * c00 - A.xy * c01 + A.xz * c02) / (p * p * p), -1.0f, 1.0f);
+
+		const float angle = glm::acos(halfDet) / 3.0f;
+		const float twoThirdsPi = 2.09439510239319549f;
+		const float beta2 = 2.0f * glm::cos(angle);
+		const float beta0 = 2.0f * glm::cos(angle + twoThirdsPi);
+		const float beta1 = -(beta0 + beta2);
+
+		eigenvalues = glm::vec3(q + p * beta0, q + p * beta1, q + p * beta2);
+
+		// start with the eigenvalue that is farthest from the other two
+		if (halfDet >= 0.0f)
+		{
+			R[2] = ComputeEigenvector0(A, eigenvalues[2]);
+			R[1] = ComputeEigenvector1(A, R[2], eigenvalues[1]);
+			R[0] = glm::cross(R[1], R[2]);
+		}
+		else
+		{
+			R[0] = ComputeEigenvector0(A, eigenvalues[0]);
+			R[1] = ComputeEigenvector1(A, R[0], eigenvalues[1]);
+			R[2] = glm::cross(R[0], R[1]);
+		}
+	}
+	else
+	{
+		// already diagonal, only sort
+		eigenvalues = glm::vec3(A.xx, A.yy, A.zz);
+		R = glm::mat3(1);
+
+		for (int i = 0; i < 2; i++)
+		{
+			for (int j = 0; j < 2 - i; j++)
+			{
+				if (eigenvalues[j] > eigenvalues[j + 1])
+				{
+					std::swap(eigenvalues[j], eigenvalues[j + 1]);
+					std::swap(R[j], R[j + 1]);
+				}
+			}
+		}
+	}
+
+	eigenvalues *= maxAbs;
+}
+
+// ---------------------------------------------------------
+// AVX2
+//
+// Solve in 8 lanes: every branch of the scalar solver is evaluated for all
+// lanes and blended. Only the trigonometric step is done per lane. Zero and
+// diagonal matrices are rare and solved with the scalar code afterwards.
+
+#if SIMD_X86
+
+namespace
+{
+	struct Vec3x8
+	{
+		__m256 x, y, z;
+	};
+
+	struct Matrix3x8
+	{
+		__m256 xx, xy, xz;
+		__m256 yy, yz;
+		__m256 zz;
+	};
+}
+
+SIMD_TARGET_AVX2 static inline __m256 Abs8(__m256 a)
+{
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+}
+
+SIMD_TARGET_AVX2 static inline __m256 Dot8(const Vec3x8& a, const Vec3x8& b)
+{
+	return _mm256_fmadd_ps(a.x, b.x, _mm256_fmadd_ps(a.y, b.y, _mm256_mul_ps(a.z, b.z)));
+}
+
+SIMD_TARGET_AVX2 static inline Vec3x8 Cross8(const Vec3x8& a, const Vec3x8& b)
+{
+	return {
+		_mm256_fmsub_ps(a.y, b.z, _mm256_mul_ps(a.z, b.y)),
+		_mm256_fmsub_ps(a.z, b.x, _mm256_mul_ps(a.x, b.z)),
+		_mm256_fmsub_ps(a.x, b.y, _mm256_mul_ps(a.y, b.x)),
+	};
+}
+
+SIMD_TARGET_AVX2 static inline Vec3x8 Scale8(const Vec3x8& a, __m256 s)
+{
+	return { _mm256_mul_ps(a.x, s), _mm256_mul_ps(a.y, s), _mm256_mul_ps(a.z, s) };
+}
+
+// mask ? a : b
+SIMD_TARGET_AVX2 static inline Vec3x8 Select8(__m256 mask, const Vec3x8& a, const Vec3x8& b)
+{
+	return {
+		_mm256_blendv_ps(b.x, a.x, mask),
+		_mm256_blendv_ps(b.y, a.y, mask),
+		_mm256_blendv_ps(b.z, a.z, mask),
+	};
+}
+
+SIMD_TARGET_AVX2 static inline Vec3x8 Multiply8(const Matrix3x8& A, const Vec3x8& v)
+{
+	return {
+		_mm256_fmadd_ps(A.xx, v.x, _mm256_fmadd_ps(A.xy, v.y, _mm256_mul_ps(A.xz, v.z))),
+		_mm256_fmadd_ps(A.xy, v.x, _mm256_fmadd_ps(A.yy, v.y, _mm256_mul_ps(A.yz, v.z))),
+		_mm256_fmadd_ps(A.xz, v.x, _mm256_fmadd_ps(A.yz, v.y, _mm256_mul_ps(A.zz, v.z))),
+	};
+}
+
+SIMD_TARGET_AVX2 static inline Vec3x8 ComputeEigenvector0_8(const Matrix3x8& A, __m256 lambda)
+{
+	const Vec3x8 r0 = { _mm256_sub_ps(A.xx, lambda), A.xy, A.xz };
+	const Vec3x8 r1 = { A.xy, _mm256_sub_ps(A.yy, lambda), A.yz };
+	const Vec3x8 r2 = { A.xz, A.yz, _mm256_sub_ps(A.zz, lambda) };
+
+	const Vec3x8 r0xr1 = Cross8(r0, r1);
+	const Vec3x8 r0xr2 = Cross8(r0, r2);
+	const Vec3x8 r1xr2 = Cross8(r1, r2);
+
+	const __m256 d0 = Dot8(r0xr1, r0xr1);
+	const __m256 d1 = Dot8(r0xr2, r0xr2);
+	const __m256 d2 = Dot8(r1xr2, r1xr2);
+
+	const __m256 pick0 = _mm256_and_ps(_mm256_cmp_ps(d0, d1, _CMP_GE_OQ), _mm256_cmp_ps(d0, d2, _CMP_GE_OQ));
+	const __m256 pick1 = _mm256_cmp_ps(d1, d2, _CMP_GE_OQ);
+
+	const Vec3x8 v = Select8(pick0, r0xr1, Select8(pick1, r0xr2, r1xr2));
+	const __m256 d = _mm256_blendv_ps(_mm256_blendv_ps(d2, d1, pick1), d0, pick0);
+
+	return Scale8(v, _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(d)));
+}
+
+SIMD_TARGET_AVX2 static inline Vec3x8 ComputeEigenvector1_8(const Matrix3x8& A, const Vec3x8& W, __m256 lambda)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	// orthogonal complement of W
+	const __m256 xGreater = _mm256_cmp_ps(Abs8(W.x), Abs8(W.y), _CMP_GT_OQ);
+
+	const __m256 invLengthX = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_fmadd_ps(W.x, W.x, _mm256_mul_ps(W.z, W.z))));
+	const __m256 invLengthY = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_fmadd_ps(W.y, W.y, _mm256_mul_ps(W.z, W.z))));
+
+	const Vec3x8 UX = { _mm256_sub_ps(zero, _mm256_mul_ps(W.z, invLengthX)), zero, _mm256_mul_ps(W.x, invLengthX) };
+	const Vec3x8 UY = { zero, _mm256_mul_ps(W.z, invLengthY), _mm256_sub_ps(zero, _mm256_mul_ps(W.y, invLengthY)) };
+
+	const Vec3x8 U = Select8(xGreater, UX, UY);
+	const Vec3x8 V = Cross8(W, U);
+
+	// 2x2 restriction of (A - lambda I) to span(U, V)
+	const __m256 m00 = _mm256_sub_ps(Dot8(U, Multiply8(A, U)), lambda);
+	const __m256 m01 = Dot8(U, Multiply8(A, V));
+	const __m256 m11 = _mm256_sub_ps(Dot8(V, Multiply8(A, V)), lambda);
+
+	// The scalar solver normalizes (m00, m01) or (m11, m01), whichever
+	// diagonal entry is larger, through the ratio of its smaller to its larger
+	// component. The sign follows the larger component.
+	const __m256 useM00 = _mm256_cmp_ps(Abs8(m00), Abs8(m11), _CMP_GE_OQ);
+	const __m256 a = _mm256_blendv_ps(m11, m00, useM00);
+	const __m256 b = m01;
+
+	const __m256 aLarger = _mm256_cmp_ps(Abs8(a), Abs8(b), _CMP_GE_OQ);
+	const __m256 large = _mm256_blendv_ps(b, a, aLarger);
+	const __m256 small = _mm256_blendv_ps(a, b, aLarger);
+
+	const __m256 ratio = _mm256_div_ps(small, large);
+	const __m256 length = _mm256_mul_ps(Abs8(large), _mm256_sqrt_ps(_mm256_fmadd_ps(ratio, ratio, one)));
+	const __m256 sign = _mm256_blendv_ps(one, _mm256_set1_ps(-1.0f), _mm256_cmp_ps(large, zero, _CMP_LT_OQ));
+	const __m256 scale = _mm256_div_ps(sign, length);
+
+	const __m256 aNormalized = _mm256_mul_ps(a, scale);
+	const __m256 bNormalized = _mm256_mul_ps(b, scale);
+
+	// m01 U - m00 V, or m11 U - m01 V
+	const __m256 u = _mm256_blendv_ps(aNormalized, bNormalized, useM00);
+	const __m256 v = _mm256_blendv_ps(bNormalized, aNormalized, useM00);
+
+	const Vec3x8 result = {
+		_mm256_fnmadd_ps(v, V.x, _mm256_mul_ps(u, U.x)),
+		_mm256_fnmadd_ps(v, V.y, _mm256_mul_ps(u, U.y)),
+		_mm256_fnmadd_ps(v, V.z, _mm256_mul_ps(u, U.z)),
+	};
+
+	// a vanishing restriction leaves U
+	const __m256 vanishing = _mm256_cmp_ps(_mm256_max_ps(Abs8(a), Abs8(b)), zero, _CMP_LE_OQ);
+
+	return Select8(vanishing, U, result);
+}
+
+SIMD_TARGET_AVX2 static void Solve8_AVX2(const SymmetricMatrix3x8& in, glm::vec3 eigenvalues[8], glm::mat3 R[8])
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	Matrix3x8 A = {
+		_mm256_load_ps(in.xx), _mm256_load_ps(in.xy), _mm256_load_ps(in.xz),
+		_mm256_load_ps(in.yy), _mm256_load_ps(in.yz),
+		_mm256_load_ps(in.zz),
+	};
+
+	// scale to [-1, 1] to avoid over- and underflow
+	const __m256 maxAbs = _mm256_max_ps(
+		_mm256_max_ps(_mm256_max_ps(Abs8(A.xx), Abs8(A.xy)), _mm256_max_ps(Abs8(A.xz), Abs8(A.yy))),
+		_mm256_max_ps(Abs8(A.yz), Abs8(A.zz)));
+
+	const __m256 vanishing = _mm256_cmp_ps(maxAbs, zero, _CMP_LE_OQ);
+	const __m256 invMaxAbs = _mm256_div_ps(one, _mm256_blendv_ps(maxAbs, one, vanishing));
+
+	A.xx = _mm256_mul_ps(A.xx, invMaxAbs); A.xy = _mm256_mul_ps(A.xy, invMaxAbs); A.xz = _mm256_mul_ps(A.xz, invMaxAbs);
+	A.yy = _mm256_mul_ps(A.yy, invMaxAbs); A.yz = _mm256_mul_ps(A.yz, invMaxAbs);
+	A.zz = _mm256_mul_ps(A.zz, invMaxAbs);
+
+	const __m256 offDiagonal = _mm256_fmadd_ps(A.xy, A.xy, _mm256_fmadd_ps(A.xz, A.xz, _mm256_mul_ps(A.yz, A.yz)));
+	const __m256 scalar = _mm256_or_ps(vanishing, _mm256_cmp_ps(offDiagonal, zero, _CMP_LE_OQ));
+
+	const __m256 q = _mm256_mul_ps(_mm256_add_ps(A.xx, _mm256_add_ps(A.yy, A.zz)), _mm256_set1_ps(1.0f / 3.0f));
+	const __m256 b00 = _mm256_sub_ps(A.xx, q);
+	const __m256 b11 = _mm256_sub_ps(A.yy, q);
+	const __m256 b22 = _mm256_sub_ps(A.zz, q);
+
+	const __m256 pSquared6 = _mm256_fmadd_ps(b00, b00, _mm256_fmadd_ps(b11, b11,
+		_mm256_fmadd_ps(b22, b22, _mm256_add_ps(offDiagonal, offDiagonal))));
+	const __m256 p = _mm256_blendv_ps(_mm256_sqrt_ps(_mm256_mul_ps(pSquared6, _mm256_set1_ps(1.0f / 6.0f))), one, scalar);
+
+	// det((A - q I) / p) / 2
+	const __m256 c00 = _mm256_fmsub_ps(b11, b22, _mm256_mul_ps(A.yz, A.yz));
+	const __m256 c01 = _mm256_fmsub_ps(A.xy, b22, _mm256_mul_ps(A.yz, A.xz));
+	const __m256 c02 = _mm256_fmsub_ps(A.xy, A.yz, _mm256_mul_ps(b11, A.xz));
+	const __m256 det = _mm256_fmadd_ps(A.xz, c02, _mm256_fmsub_ps(b00, c00, _mm256_mul_ps(A.xy, c01)));
+	const __m256 halfDet = _mm256_min_ps(_mm256_max_ps(
+		_mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), det), _mm256_mul_ps(p, _mm256_mul_ps(p, p))),
+		_mm256_set1_ps(-1.0f)), one);
+
+	alignas(32) float halfDets[8], betas0[8], betas2[8];
+	_mm256_store_ps(halfDets, halfDet);
+
+	for (int i = 0; i < 8; i++)
+	{
+		const float angle = std::acos(halfDets[i]) / 3.0f;
+		const float twoThirdsPi = 2.09439510239319549f;
+		betas2[i] = 2.0f * std::cos(angle);
+		betas0[i] = 2.0f * std::cos(angle + twoThirdsPi);
+	}
+
+	const __m256 beta0 = _mm256_load_ps(betas0);
+	const __m256 beta2 = _mm256_load_ps(betas2);
+	const __m256 beta1 = _mm256_sub_ps(zero, _mm256_add_ps(beta0, beta2));
+
+	const __m256 lambda0 = _mm256_fmadd_ps(p, beta0, q);
+	const __m256 lambda1 = _mm256_fmadd_ps(p, beta1, q);
+	const __m256 lambda2 = _mm256_fmadd_ps(p, beta2, q);
+
+	// start with the eigenvalue that is farthest from the other two
+	const __m256 positive = _mm256_cmp_ps(halfDet, zero, _CMP_GE_OQ);
+
+	const Vec3x8 first = ComputeEigenvector0_8(A, _mm256_blendv_ps(lambda0, lambda2, positive));
+	const Vec3x8 second = ComputeEigenvector1_8(A, first, lambda1);
+	const Vec3x8 third = Cross8(second, first);
+
+	// positive: R = (second x first, second, first), else (first, second, first x second)
+	const Vec3x8 negatedThird = Scale8(third, _mm256_set1_ps(-1.0f));
+	const Vec3x8 R0 = Select8(positive, third, first);
+	const Vec3x8 R2 = Select8(positive, first, negatedThird);
+
+	alignas(32) float out[12][8];
+	_mm256_store_ps(out[0], _mm256_mul_ps(lambda0, maxAbs));
+	_mm256_store_ps(out[1], _mm256_mul_ps(lambda1, maxAbs));
+	_mm256_store_ps(out[2], _mm256_mul_ps(lambda2, maxAbs));
+	_mm256_store_ps(out[3], R0.x); _mm256_store_ps(out[4], R0.y); _mm256_store_ps(out[5], R0.z);
+	_mm256_store_ps(out[6], second.x); _mm256_store_ps(out[7], second.y); _mm256_store_ps(out[8], second.z);
+	_mm256_store_ps(out[9], R2.x); _mm256_store_ps(out[10], R2.y); _mm256_store_ps(out[11], R2.z);
+
+	const int scalarLanes = _mm256_movemask_ps(scalar);
+
+	for (int i = 0; i < 8; i++)
+	{
+		if (scalarLanes & (1 << i))
+		{
+			Solve({ in.xx[i], in.xy[i], in.xz[i], in.yy[i], in.yz[i], in.zz[i] }, eigenvalues[i], R[i]);
+			continue;
+		}
+
+		eigenvalues[i] = glm::vec3(out[0][i], out[1][i], out[2][i]);
+		R[i][0] = glm::vec3(out[3][i], out[4][i], out[5][i]);
+		R[i][1] = glm::vec3(out[6][i], out[7][i], out[8][i]);
+		R[i][2] = glm::vec3(out[9][i], out[10][i], out[11][i]);
+	}
+}
+
+#endif
+
+// ---------------------------------------------------------
+
+void SolveSymmetricEigen(const SymmetricMatrix3& A, glm::vec3& eigenvalues, glm::mat3& R)
+{
+	Solve(A, eigenvalues, R);
+}
+
+void SolveSymmetricEigen8(const SymmetricMatrix3x8& A, glm::vec3 eigenvalues[8], glm::mat3 R[8])
+{
+#if SIMD_X86
+	// AVX-512 gains nothing over AVX2 for 8 lanes
+	if (GetKernelSimdLevel() >= KernelSimdLevel::AVX2)
+	{
+		Solve8_AVX2(A, eigenvalues, R);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < 8; i++)
+		Solve({ A.xx[i], A.xy[i], A.xz[i], A.yy[i], A.yz[i], A.zz[i] }, eigenvalues[i], R[i]);
+}
+
+// ---------------------------------------------------------
+
+// Random rotation and spectrum, every fourth sample with repeated or
+// vanishing eigenvalues as they occur for planar and linear neighborhoods.
+static glm::mat3 RandomSymmetricMatrix(uint32_t i)
+{
+	const glm::quat rotation = glm::normalize(glm::quat(
+		RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f),
+		RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f)));
+	const glm::mat3 Q = glm::mat3_cast(rotation);
+
+	glm::vec3 lambda(RandomFloat(), RandomFloat(), RandomFloat());
+
+	switch (i % 8)
+	{
+		case 1: lambda.y = lambda.x; break;
+		case 3: lambda.z = 0.0f; break;
+		case 5: lambda.y = lambda.z = 0.0f; break;
+		case 7: lambda = glm::vec3(lambda.x); break;
+	}
+
+	lambda *= std::pow(10.0f, RandomFloat(-6.0f, 2.0f));
+
+	return Q * glm::mat3(
+		lambda.x, 0.0f, 0.0f,
+		0.0f, lambda.y, 0.0f,
+		0.0f, 0.0f, lambda.z) * glm::transpose(Q);
+}
+
+static void AccumulateErrors(const glm::mat3& M,
+							 const glm::vec3& eigenvalues,
+							 const glm::mat3& R,
+							 SymmetricEigenSolverErrors& errors)
+{
+	Eigen::Matrix3f C;
+	C <<
+		M[0][0], M[1][0], M[2][0],
+		M[1][0], M[1][1], M[2][1],
+		M[2][0], M[2][1], M[2][2];
+
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> solver;
+	solver.computeDirect(C);
+
+	const float norm = C.cwiseAbs().maxCoeff();
+
+	if (solver.info() != Eigen::Success || norm <= 0.0f)
+		return;
+
+	const Eigen::Vector3f eigenEigenvalues = solver.eigenvalues();
+
+	// Eigenvectors of repeated eigenvalues are not unique, so they are
+	// compared through the reconstruction R diag(l) R^T instead.
+	const glm::mat3 reconstructed = R * glm::mat3(
+		eigenvalues.x, 0.0f, 0.0f,
+		0.0f, eigenvalues.y, 0.0f,
+		0.0f, 0.0f, eigenvalues.z) * glm::transpose(R);
+
+	const glm::mat3 RtR = glm::transpose(R) * R;
+
+	for (int c = 0; c < 3; c++)
+	{
+		errors.Eigenvalues = std::max(errors.Eigenvalues,
+			std::abs(eigenvalues[c] - eigenEigenvalues[c]) / norm);
+
+		for (int r = 0; r < 3; r++)
+		{
+			errors.Reconstruction = std::max(errors.Reconstruction,
+				std::abs(reconstructed[c][r] - M[c][r]) / norm);
+
+			errors.Orthonormality = std::max(errors.Orthonormality,
+				std::abs(RtR[c][r] - (c == r ? 1.0f : 0.0f)));
+		}
+	}
+}
+
+SymmetricEigenSolverErrors ValidateSymmetricEigenSolver(uint32_t numSamples, bool verbose)
+{
+	SymmetricEigenSolverErrors single = {};
+	SymmetricEigenSolverErrors batched = {};
+
+	for (uint32_t i = 0; i < numSamples; i += 8)
+	{
+		glm::mat3 M[8];
+		SymmetricMatrix3x8 A;
+
+		for (uint32_t lane = 0; lane < 8; lane++)
+		{
+			M[lane] = RandomSymmetricMatrix(i + lane);
+
+			A.xx[lane] = M[lane][0][0]; A.xy[lane] = M[lane][1][0]; A.xz[lane] = M[lane][2][0];
+			A.yy[lane] = M[lane][1][1]; A.yz[lane] = M[lane][2][1];
+			A.zz[lane] = M[lane][2][2];
+		}
+
+		glm::vec3 eigenvalues[8];
+		glm::mat3 R[8];
+		SolveSymmetricEigen8(A, eigenvalues, R);
+
+		for (uint32_t lane = 0; lane < 8; lane++)
+		{
+			AccumulateErrors(M[lane], eigenvalues[lane], R[lane], batched);
+
+			glm::vec3 singleEigenvalues;
+			glm::mat3 singleR;
+			SolveSymmetricEigen({ A.xx[lane], A.xy[lane], A.xz[lane], A.yy[lane], A.yz[lane], A.zz[lane] },
+								singleEigenvalues, singleR);
+
+			AccumulateErrors(M[lane], singleEigenvalues, singleR, single);
+		}
+	}
+
+	if (verbose)
+	{
+		SPDLOG_INFO("Symmetric eigen solver vs. Eigen ({} samples): max. relative eigenvalue error {}, "
+					"max. relative reconstruction error {}, max. orthonormality error {}",
+					numSamples, single.Eigenvalues, single.Reconstruction, single.Orthonormality);
+		SPDLOG_INFO("Symmetric eigen solver, 8 lanes ({}): max. relative eigenvalue error {}, "
+					"max. relative reconstruction error {}, max. orthonormality error {}",
+					KernelSimdLevelToString(GetKernelSimdLevel()),
+					batched.Eigenvalues, batched.Reconstruction, batched.Orthonormality);
+	}
+
+	return {
+		std::max(single.Eigenvalues, batched.Eigenvalues),
+		std::max(single.Reconstruction, batched.Reconstruction),
+		std::max(single.Orthonormality, batched.Orthonormality),
+	};
+}
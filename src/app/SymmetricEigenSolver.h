@@ -0,0 +1,38 @@
+#pragma once
+
+// Upper triangle of a symmetric 3x3 matrix.
+struct SymmetricMatrix3
+{
+	float xx, xy, xz;
+	float yy, yz;
+	float zz;
+};
+
+// Closed-form eigen decomposition of a symmetric 3x3 matrix. Eigenvalues are
+// returned in ascending order, the corresponding eigenvectors are the columns
+// of R and form an orthonormal basis.
+void SolveSymmetricEigen(const SymmetricMatrix3& A, glm::vec3& eigenvalues, glm::mat3& R);
+
+// Upper triangles of 8 symmetric 3x3 matrices, one SIMD lane per matrix.
+struct alignas(32) SymmetricMatrix3x8
+{
+	float xx[8], xy[8], xz[8];
+	float yy[8], yz[8];
+	float zz[8];
+};
+
+// Solves 8 matrices at once, in AVX2 lanes if the batch kernels use AVX2 or
+// AVX-512 (see KernelSimdLevel), one by one otherwise. Same results as
+// SolveSymmetricEigen up to rounding.
+void SolveSymmetricEigen8(const SymmetricMatrix3x8& A, glm::vec3 eigenvalues[8], glm::mat3 R[8]);
+
+struct SymmetricEigenSolverErrors
+{
+	float Eigenvalues; // relative to Eigen's
+	float Reconstruction; // of R diag(l) R^T, relative
+	float Orthonormality; // max. |R^T R - I|
+};
+
+// Compares both solvers against Eigen's SelfAdjointEigenSolver on random and
+// degenerate matrices and returns the maximum errors of either.
+SymmetricEigenSolverErrors ValidateSymmetricEigenSolver(uint32_t numSamples = 10000, bool verbose = true);
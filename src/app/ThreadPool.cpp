@@ -2,14 +2,25 @@
 
 #include "ThreadPool.h"
 
+#include <engine/utils/PerformanceTimer.h>
+
+// thread locals may contain SIMD arrays, so they are cache line aligned
+#define THREAD_LOCALS_ALIGNMENT 64
+
 ThreadPool::ThreadPool(uint32_t numThreads, size_t threadLocalsSize, const F& f) :
 	m_NumThreads(numThreads),
+	m_NumActiveThreads(numThreads),
 	m_Function(f),
 	m_Barrier(numThreads + 1)
 {
+	m_NumWorkersDone = m_NumThreads;
+
+	m_WorkerStates.resize(m_NumThreads);
+
 	m_Threads.resize(m_NumThreads);
 	for (uint32_t i = 0; i < m_NumThreads; i++)
-		m_Threads[i] = std::thread(&ThreadPool::Worker, this, malloc(threadLocalsSize));
+		m_Threads[i] = std::thread(&ThreadPool::Worker, this, i,
+			::operator new(threadLocalsSize, std::align_val_t(THREAD_LOCALS_ALIGNMENT)));
 }
 
 void ThreadPool::Exit()
@@ -22,34 +33,93 @@ void ThreadPool::Exit()
 			m_Threads[i].join();
 }
 
-void ThreadPool::Start(uint32_t problemSize)
+void ThreadPool::Start(uint32_t problemSize, uint32_t chunkSize)
 {
 	m_ProblemSize = problemSize;
+	m_ChunkSize = std::max(chunkSize, 1u);
 	m_ProblemPointer = 0;
+	m_NumWorkersDone = 0;
 
-	m_Barrier.arrive();
+	m_JobStart = std::chrono::high_resolution_clock::now();
+
+	(void)m_Barrier.arrive();
 }
 
 bool ThreadPool::IsDone()
 {
-	return m_ProblemPointer.load() >= m_ProblemSize;
+	// The problem pointer running past the end only means that all work has been
+	// handed out. The last chunks may still be in flight, so wait for the workers.
+	return m_NumWorkersDone.load() >= m_NumThreads;
+}
+
+void ThreadPool::SetNumActiveThreads(uint32_t numThreads)
+{
+	HZ_ASSERT(IsDone(), "The number of threads can not change during a job!");
+
+	m_NumActiveThreads = std::clamp(numThreads, 1u, m_NumThreads);
+}
+
+ThreadPool::JobStats ThreadPool::GetJobStats() const
+{
+	HZ_ASSERT(m_NumWorkersDone.load() >= m_NumThreads, "The job is still running!");
+
+	JobStats stats;
+	stats.BusyTime.resize(m_NumThreads);
+	stats.NumChunks.resize(m_NumThreads);
+
+	auto finished = m_JobStart;
+
+	for (uint32_t i = 0; i < m_NumThreads; i++)
+	{
+		const WorkerState& state = m_WorkerStates[i];
+
+		stats.BusyTime[i] = std::chrono::duration<double>(state.Busy).count();
+		stats.NumChunks[i] = state.NumChunks;
+
+		finished = std::max(finished, state.Finished);
+	}
+
+	stats.WallTime = std::chrono::duration<double>(finished - m_JobStart).count();
+
+	return stats;
 }
 
-void ThreadPool::Worker(void* threadLocals)
+void ThreadPool::Worker(uint32_t index, void* threadLocals)
 {
+	Profiler::SetThreadName("Worker " + std::to_string(index));
+
 	while (true)
 	{
 		// wait
 		m_Barrier.arrive_and_wait();
 
 		if (m_Exit)
-			return;
+			break;
+
+		WorkerState& state = m_WorkerStates[index];
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		state.NumChunks = 0;
 
 		// work
-		uint32_t index;
-		while ((index = m_ProblemPointer.fetch_add(1)) < m_ProblemSize - 1)
-			m_Function(index, threadLocals);
+		if (index < m_NumActiveThreads)
+		{
+			PROFILE_SCOPE("ThreadPool job");
+
+			uint32_t begin;
+			while ((begin = m_ProblemPointer.fetch_add(m_ChunkSize)) < m_ProblemSize)
+			{
+				m_Function(begin, std::min(begin + m_ChunkSize, m_ProblemSize), threadLocals);
+				state.NumChunks++;
+			}
+		}
+
+		// from waking up until running out of work, waiting for the wake-up is idle
+		state.Finished = std::chrono::high_resolution_clock::now();
+		state.Busy = state.NumChunks ? state.Finished - start : std::chrono::high_resolution_clock::duration::zero();
+
+		m_NumWorkersDone.fetch_add(1);
 	}
 
-	free(threadLocals);
+	::operator delete(threadLocals, std::align_val_t(THREAD_LOCALS_ALIGNMENT));
 }
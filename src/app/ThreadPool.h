@@ -7,21 +7,49 @@
 
 class ThreadPool
 {
-	using F = std::function<void(uint32_t, void*)>;
+	// Called with a half-open range [begin, end) of problem indices.
+	using F = std::function<void(uint32_t, uint32_t, void*)>;
+
+public:
+	// of the last job, valid once it is done
+	struct JobStats
+	{
+		double WallTime; // in s, from Start until the last worker finished
+
+		// per worker, in s, the rest of WallTime is idle
+		std::vector<double> BusyTime;
+		std::vector<uint32_t> NumChunks;
+	};
 
 public:
 	ThreadPool(uint32_t numThreads, size_t threadLocalsSize, const F& f = {});
 
 	void Exit();
 
-	void Start(uint32_t problemSize);
+	void Start(uint32_t problemSize, uint32_t chunkSize = 1);
 
 	bool IsDone();
 
 	void SetFunction(const F& f) { m_Function = f; }
 
+	// Only the first numThreads workers take part in the following jobs, the
+	// others wake up and go back to sleep. Clamped to [1, GetNumThreads()].
+	void SetNumActiveThreads(uint32_t numThreads);
+	uint32_t GetNumActiveThreads() const { return m_NumActiveThreads; }
+	uint32_t GetNumThreads() const { return m_NumThreads; }
+
+	JobStats GetJobStats() const;
+
 private:
-	void Worker(void* threadLocals);
+	void Worker(uint32_t index, void* threadLocals);
+
+	// written by its worker only
+	struct alignas(64) WorkerState
+	{
+		std::chrono::high_resolution_clock::duration Busy;
+		std::chrono::high_resolution_clock::time_point Finished;
+		uint32_t NumChunks;
+	};
 
 private:
 	std::condition_variable m_ConditionVariable;
@@ -34,11 +62,17 @@ private:
 	bool m_Started = false;
 
 	uint32_t m_NumThreads;
+	uint32_t m_NumActiveThreads;
 
 	std::vector<std::thread> m_Threads;
 
 	F m_Function;
 
 	uint32_t m_ProblemSize;
+	uint32_t m_ChunkSize = 1;
 	std::atomic_uint32_t m_ProblemPointer = 0;
+	std::atomic_uint32_t m_NumWorkersDone = 0;
+
+	std::vector<WorkerState> m_WorkerStates;
+	std::chrono::high_resolution_clock::time_point m_JobStart;
 };
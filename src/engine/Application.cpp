@@ -12,6 +12,8 @@
 
 void Application::Init()
 {
+	const auto start = PerformanceTimer::Clock::now();
+
 	// init asset manager
 	AssetManager::Init();
 
@@ -60,6 +62,12 @@ void Application::Init()
 
 	// done
 	Data.Running = true;
+
+	// a warm start reuses the pipeline cache and compiled shaders of the last run
+	SPDLOG_INFO("Startup took {} ({} pipeline cache, {} shaders compiled).",
+				PerformanceTimer::Stringify(PerformanceTimer::Clock::now() - start),
+				Renderer::GetInstance().PipelineCacheWarm ? "warm" : "cold",
+				Renderer::GetInstance().NumCompiledShaders);
 }
 
 void Application::Exit()
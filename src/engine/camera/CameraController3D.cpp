@@ -74,6 +74,12 @@ void CameraController3D::ComputeMatrices()
 
 	Position = glm::rotate(glm::quat({ RotationY, RotationX, 0 }), { 0, 0, -R });
 	Orientation = glm::quatLookAt(-glm::normalize(Position), { 0, 1, 0 });
+
+	ComputeView();
+}
+
+void CameraController3D::ComputeView()
+{
 	glm::mat4 orientation = glm::toMat4(glm::inverse(Orientation));
 
 	Camera.View = glm::translate(orientation, -Position);
@@ -14,6 +14,9 @@ public:
 
 	void ComputeMatrices();
 
+	// Computes the camera matrices from Position and Orientation as they are.
+	void ComputeView();
+
 	Camera3D& Camera;
 
 	bool Panning = false;
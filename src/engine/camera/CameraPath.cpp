@@ -0,0 +1,109 @@
+#include "engine/hzpch.h"
+
+#include "engine/camera/CameraPath.h"
+#include "engine/camera/CameraController3D.h"
+
+#include <fstream>
+
+void CameraPath::Record(const CameraController3D& controller)
+{
+	m_Keyframes.push_back({
+		controller.RotationX,
+		controller.RotationY,
+		controller.R,
+		controller.Position,
+		controller.Orientation,
+	});
+}
+
+void CameraPath::Apply(CameraController3D& controller, size_t index) const
+{
+	HZ_ASSERT(index < m_Keyframes.size(), "Keyframe out of range!");
+
+	const Keyframe& keyframe = m_Keyframes[index];
+
+	controller.RotationX = keyframe.RotationX;
+	controller.RotationY = keyframe.RotationY;
+	controller.R = keyframe.R;
+	controller.Position = keyframe.Position;
+	controller.Orientation = keyframe.Orientation;
+
+	controller.ComputeView();
+}
+
+bool CameraPath::Save(const std::filesystem::path& path) const
+{
+	YAML::Emitter out;
+	out.SetFloatPrecision(9);
+
+	out << YAML::BeginMap;
+	out << YAML::Key << "keyframes" << YAML::Value << YAML::BeginSeq;
+
+	for (const Keyframe& k : m_Keyframes)
+	{
+		out << YAML::Flow << YAML::BeginMap;
+		out << YAML::Key << "rotationX" << YAML::Value << k.RotationX;
+		out << YAML::Key << "rotationY" << YAML::Value << k.RotationY;
+		out << YAML::Key << "r" << YAML::Value << k.R;
+		out << YAML::Key << "position" << YAML::Value << YAML::Flow
+			<< YAML::BeginSeq << k.Position.x << k.Position.y << k.Position.z << YAML::EndSeq;
+		out << YAML::Key << "orientation" << YAML::Value << YAML::Flow
+			<< YAML::BeginSeq << k.Orientation.w << k.Orientation.x << k.Orientation.y << k.Orientation.z << YAML::EndSeq;
+		out << YAML::EndMap;
+	}
+
+	out << YAML::EndSeq;
+	out << YAML::EndMap;
+
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Could not write camera path to '{}'!", path.string());
+		return false;
+	}
+
+	file << out.c_str() << "\n";
+
+	SPDLOG_INFO("Saved {} keyframes to '{}'.", m_Keyframes.size(), path.string());
+	return true;
+}
+
+bool CameraPath::Load(const std::filesystem::path& path)
+{
+	std::vector<Keyframe> keyframes;
+
+	try
+	{
+		const YAML::Node root = YAML::LoadFile(path.string());
+
+		for (const YAML::Node& node : root["keyframes"])
+		{
+			Keyframe k;
+			k.RotationX = node["rotationX"].as<float>();
+			k.RotationY = node["rotationY"].as<float>();
+			k.R = node["r"].as<float>();
+
+			const YAML::Node position = node["position"];
+			k.Position = { position[0].as<float>(), position[1].as<float>(), position[2].as<float>() };
+
+			const YAML::Node orientation = node["orientation"];
+			k.Orientation = glm::quat(orientation[0].as<float>(),
+									  orientation[1].as<float>(),
+									  orientation[2].as<float>(),
+									  orientation[3].as<float>());
+
+			keyframes.push_back(k);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		SPDLOG_ERROR("Could not read camera path '{}': {}", path.string(), e.what());
+		return false;
+	}
+
+	m_Keyframes = std::move(keyframes);
+
+	SPDLOG_INFO("Loaded {} keyframes from '{}'.", m_Keyframes.size(), path.string());
+	return true;
+}
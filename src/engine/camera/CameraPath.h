@@ -0,0 +1,38 @@
+#pragma once
+
+class CameraController3D;
+
+/*
+* The state of a CameraController3D, one keyframe per recorded frame. The
+* view is restored from the recorded position and orientation, the rotations
+* and the distance let the controller continue from there.
+*/
+class CameraPath
+{
+public:
+	struct Keyframe
+	{
+		float RotationX;
+		float RotationY;
+		float R;
+
+		glm::vec3 Position;
+		glm::quat Orientation;
+	};
+
+public:
+	void Clear() { m_Keyframes.clear(); }
+	void Record(const CameraController3D& controller);
+
+	// Sets the controller to the keyframe and computes the camera matrices from it.
+	void Apply(CameraController3D& controller, size_t index) const;
+
+	bool Save(const std::filesystem::path& path) const;
+	bool Load(const std::filesystem::path& path);
+
+	size_t GetSize() const { return m_Keyframes.size(); }
+	bool IsEmpty() const { return m_Keyframes.empty(); }
+
+private:
+	std::vector<Keyframe> m_Keyframes;
+};
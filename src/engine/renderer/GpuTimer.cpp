@@ -0,0 +1,153 @@
+#include "engine/hzpch.h"
+#include "engine/renderer/GpuTimer.h"
+#include "engine/renderer/Renderer.h"
+
+#include "engine/utils/PerformanceTimer.h"
+#include "engine/utils/Statistics.h"
+
+// --------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+bool GpuTimer::Init()
+{
+	const auto props = Vulkan.PhysicalDevice.getProperties();
+	const auto families = Vulkan.PhysicalDevice.getQueueFamilyProperties();
+	const uint32_t validBits = families[Vulkan.QueueIndices.GraphicsFamily.value()].timestampValidBits;
+
+	m_Supported = validBits > 0 && props.limits.timestampPeriod > 0.0f;
+
+	if (!m_Supported)
+	{
+		SPDLOG_WARN("Timestamp queries are not supported, GPU timers are disabled.");
+		return true;
+	}
+
+	m_TimestampPeriod = double(props.limits.timestampPeriod);
+	m_TimestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+	vk::QueryPoolCreateInfo info;
+	info.setQueryType(vk::QueryType::eTimestamp)
+		.setQueryCount(2 * MaxScopes);
+
+	for (vk::QueryPool& pool : m_QueryPools)
+	{
+		pool = Vulkan.Device.createQueryPool(info);
+		if (!pool)
+		{
+			SPDLOG_ERROR("Query pool creation failed!");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void GpuTimer::Exit()
+{
+	for (vk::QueryPool& pool : m_QueryPools)
+	{
+		if (pool)
+		{
+			Vulkan.Device.destroyQueryPool(pool);
+			pool = nullptr;
+		}
+	}
+}
+
+void GpuTimer::BeginFrame(vk::CommandBuffer& cmd)
+{
+	if (!m_Supported)
+		return;
+
+	const uint32_t frame = Vulkan.CurrentFrame;
+
+	// the frame's fence has been waited for, its queries are available
+	ReadResults(frame);
+
+	HZ_ASSERT(m_OpenScopes.empty(), "GPU timer scope was not ended!");
+
+	m_Names[frame].clear();
+	cmd.resetQueryPool(m_QueryPools[frame], 0, 2 * MaxScopes);
+}
+
+void GpuTimer::BeginScope(vk::CommandBuffer& cmd, const char* name)
+{
+	if (!m_Supported)
+		return;
+
+	const uint32_t frame = Vulkan.CurrentFrame;
+	const uint32_t scope = uint32_t(m_Names[frame].size());
+
+	// scopes beyond the capacity are not measured
+	m_OpenScopes.push_back(scope);
+
+	if (scope >= MaxScopes)
+		return;
+
+	m_Names[frame].push_back(name);
+	cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_QueryPools[frame], 2 * scope);
+}
+
+void GpuTimer::EndScope(vk::CommandBuffer& cmd)
+{
+	if (!m_Supported)
+		return;
+
+	HZ_ASSERT(!m_OpenScopes.empty(), "No GPU timer scope to end!");
+
+	const uint32_t scope = m_OpenScopes.back();
+	m_OpenScopes.pop_back();
+
+	if (scope >= MaxScopes)
+		return;
+
+	cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_QueryPools[Vulkan.CurrentFrame], 2 * scope + 1);
+}
+
+// --------------------------------------------------------------------
+// PRIVATE HELPER FUNCTIONS
+
+void GpuTimer::ReadResults(uint32_t frame)
+{
+	const std::vector<const char*>& names = m_Names[frame];
+
+	if (names.empty())
+		return;
+
+	const uint32_t numQueries = 2 * uint32_t(names.size());
+
+	auto r = Vulkan.Device.getQueryPoolResults<uint64_t>(m_QueryPools[frame],
+														 0,
+														 numQueries,
+														 numQueries * sizeof(uint64_t),
+														 sizeof(uint64_t),
+														 vk::QueryResultFlagBits::e64);
+
+	// not ready only if a submission was skipped, drop the frame's results
+	if (r.result != vk::Result::eSuccess)
+		return;
+
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		const uint64_t ticks = (r.value[2 * i + 1] - r.value[2 * i]) & m_TimestampMask;
+		const double ns = double(ticks) * m_TimestampPeriod;
+
+		PerformanceTimer::Storage.Timers[names[i]].Add(
+			std::chrono::duration_cast<PerformanceTimer::Duration>(std::chrono::duration<double, std::nano>(ns)));
+
+		GlobalStatistics.Sample(names[i], float(ns * 1e-6));
+	}
+}
+
+// --------------------------------------------------------------------
+
+GpuTimerScope::GpuTimerScope(vk::CommandBuffer& cmd, const char* name) :
+	CommandBuffer(cmd)
+{
+	Vulkan.GpuTimer.BeginScope(CommandBuffer, name);
+}
+
+GpuTimerScope::~GpuTimerScope()
+{
+	Vulkan.GpuTimer.EndScope(CommandBuffer);
+}
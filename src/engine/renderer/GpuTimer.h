@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "objects/PerFrame.h"
+
+/*
+* Measures the GPU time of sections of the frame's command buffer with
+* timestamp queries.
+*
+* Every frame in flight has its own query pool. Its results are read back
+* when the frame slot is reused, i.e. after its fence was waited for, so
+* reading them never stalls. The durations are added to the "Timers" window
+* and sampled into GlobalStatistics in milliseconds.
+*/
+class GpuTimer
+{
+public:
+	constexpr static uint32_t MaxScopes = 32; // per frame
+
+public:
+	bool Init();
+	void Exit();
+
+	// Called by the renderer once the command buffer of the frame has begun.
+	void BeginFrame(vk::CommandBuffer& cmd);
+
+	// name has to be a string literal. Scopes may be nested, but must not
+	// span the end of a command buffer.
+	void BeginScope(vk::CommandBuffer& cmd, const char* name);
+	void EndScope(vk::CommandBuffer& cmd);
+
+private:
+	void ReadResults(uint32_t frame);
+
+private:
+	PerFrame<vk::QueryPool> m_QueryPools;
+	PerFrame<std::vector<const char*>> m_Names; // one per scope
+	std::vector<uint32_t> m_OpenScopes;
+
+	double m_TimestampPeriod = 0.0; // ns per tick
+	uint64_t m_TimestampMask = 0;
+	bool m_Supported = false;
+};
+
+class GpuTimerScope
+{
+public:
+	GpuTimerScope(vk::CommandBuffer& cmd, const char* name);
+	~GpuTimerScope();
+
+	vk::CommandBuffer& CommandBuffer;
+};
+
+#define GPU_PROFILE_SCOPE_LINE2(cmd, name, line) GpuTimerScope gpuTimer_##line(cmd, name)
+#define GPU_PROFILE_SCOPE_LINE(cmd, name, line) GPU_PROFILE_SCOPE_LINE2(cmd, name, line)
+
+#define GPU_PROFILE_SCOPE(cmd, name) GPU_PROFILE_SCOPE_LINE(cmd, name, __LINE__)
@@ -0,0 +1,495 @@
+#include "engine/hzpch.h"
+#include "engine/renderer/RenderGraph.h"
+#include "engine/renderer/Renderer.h"
+#include "engine/renderer/GpuTimer.h"
+
+#include <algorithm>
+
+// --------------------------------------------------------------------
+
+template <typename Flags>
+static bool Contains(Flags flags, Flags subset)
+{
+	return (flags & subset) == subset;
+}
+
+// --------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(Resource resource, Usage usage)
+{
+	m_Graph.AddAccess(m_Pass, resource, usage, false);
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(Resource resource, Usage usage)
+{
+	m_Graph.AddAccess(m_Pass, resource, usage, true);
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SideEffect()
+{
+	m_Graph.m_Passes[m_Pass].SideEffect = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::EnabledIf(std::function<bool()> enabled)
+{
+	m_Graph.m_Passes[m_Pass].Enabled = std::move(enabled);
+	return *this;
+}
+
+// --------------------------------------------------------------------
+
+void RenderGraph::Exit()
+{
+	for (ImageResource& image : m_Resources)
+	{
+		if (!image.Transient)
+			continue;
+
+		Vulkan.Device.destroyImageView(image.ImageView);
+		Vulkan.Device.destroyImage(image.Image);
+	}
+
+	for (Allocation& allocation : m_AliasGroups)
+		Vulkan.Allocator.Free(allocation);
+
+	if (m_Sampler)
+		Vulkan.Device.destroySampler(m_Sampler);
+
+	m_Resources.clear();
+	m_Passes.clear();
+	m_AliasGroups.clear();
+	m_Sampler = nullptr;
+	m_Compiled = false;
+}
+
+RenderGraph::Resource RenderGraph::Import(const char* name,
+										  vk::Image image,
+										  vk::ImageAspectFlags aspect,
+										  vk::ImageLayout* layout)
+{
+	ImageResource& r = m_Resources.emplace_back();
+	r.Name = name;
+	r.Image = image;
+	r.Aspect = aspect;
+	r.Layout = layout;
+
+	return Resource(m_Resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::CreateTransient(const char* name,
+												   vk::Format format,
+												   vk::ImageUsageFlags usage,
+												   vk::ImageAspectFlags aspect)
+{
+	HZ_ASSERT(!m_Compiled, "Transients have to be created before Compile!");
+
+	ImageResource& r = m_Resources.emplace_back();
+	r.Name = name;
+	r.Aspect = aspect;
+	r.Format = format;
+	r.UsageFlags = usage;
+	r.Transient = true;
+
+	return Resource(m_Resources.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const char* name, uint32_t phase, PassFunction execute)
+{
+	HZ_ASSERT(!m_Compiled, "Passes have to be added before Compile!");
+	HZ_ASSERT(m_Passes.empty() || m_Passes.back().Phase <= phase, "Phases have to be added in order!");
+
+	Pass& pass = m_Passes.emplace_back();
+	pass.Name = name;
+	pass.TimerName = std::string("GPU ") + name;
+	pass.Phase = phase;
+	pass.Execute = std::move(execute);
+
+	return PassBuilder(*this, uint32_t(m_Passes.size() - 1));
+}
+
+void RenderGraph::Compile()
+{
+	// lifetimes
+	for (uint32_t i = 0; i < m_Passes.size(); i++)
+	{
+		for (const Access& access : m_Passes[i].Accesses)
+		{
+			ImageResource& r = m_Resources[access.Target];
+			r.FirstPass = std::min(r.FirstPass, i);
+			r.LastPass = std::max(r.LastPass, i);
+		}
+	}
+
+	// images without memory
+	std::vector<Resource> transients;
+
+	for (Resource i = 0; i < m_Resources.size(); i++)
+	{
+		ImageResource& r = m_Resources[i];
+		if (!r.Transient)
+			continue;
+
+		CreateTransientImage(r);
+		r.Layout = &r.OwnLayout;
+
+		if (r.FirstPass != UINT32_MAX)
+			transients.push_back(i);
+		else
+			SPDLOG_WARN("Transient image '{}' is not used by any pass.", r.Name);
+	}
+
+	// greedily put transients with disjoint lifetimes into the same memory
+	std::sort(transients.begin(), transients.end(), [&](Resource a, Resource b) {
+		return m_Resources[a].FirstPass < m_Resources[b].FirstPass;
+	});
+
+	std::vector<std::vector<vk::Image>> groupImages;
+	std::vector<std::vector<Resource>> groupMembers;
+	std::vector<uint32_t> groupTypeBits;
+
+	for (Resource t : transients)
+	{
+		ImageResource& r = m_Resources[t];
+		const uint32_t typeBits = Vulkan.Device.getImageMemoryRequirements(r.Image).memoryTypeBits;
+
+		uint32_t group = 0;
+		for (; group < groupMembers.size(); group++)
+		{
+			if ((groupTypeBits[group] & typeBits) == 0)
+				continue;
+
+			const bool disjoint = std::all_of(groupMembers[group].begin(), groupMembers[group].end(), [&](Resource m) {
+				return m_Resources[m].LastPass < r.FirstPass || r.LastPass < m_Resources[m].FirstPass;
+			});
+
+			if (disjoint)
+				break;
+		}
+
+		if (group == groupMembers.size())
+		{
+			groupImages.emplace_back();
+			groupMembers.emplace_back();
+			groupTypeBits.push_back(UINT32_MAX);
+		}
+
+		groupImages[group].push_back(r.Image);
+		groupMembers[group].push_back(t);
+		groupTypeBits[group] &= typeBits;
+		r.AliasGroup = group;
+	}
+
+	for (const auto& images : groupImages)
+		m_AliasGroups.push_back(Vulkan.Allocator.AllocateAliased(images, vk::MemoryPropertyFlagBits::eDeviceLocal));
+
+	// views need bound memory
+	for (Resource t : transients)
+	{
+		ImageResource& r = m_Resources[t];
+
+		vk::ImageViewCreateInfo viewCreateInfo;
+		viewCreateInfo
+			.setFormat(r.Format)
+			.setImage(r.Image)
+			.setViewType(vk::ImageViewType::e2D)
+			.setSubresourceRange(vk::ImageSubresourceRange(r.Aspect, 0, 1, 0, 1));
+
+		r.ImageView = Vulkan.Device.createImageView(viewCreateInfo);
+	}
+
+	// shared by all transients
+	vk::SamplerCreateInfo samplerCreateInfo;
+	samplerCreateInfo
+		.setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+		.setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+		.setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
+		.setMagFilter(vk::Filter::eLinear)
+		.setMinFilter(vk::Filter::eLinear)
+		.setMipmapMode(vk::SamplerMipmapMode::eNearest)
+		.setUnnormalizedCoordinates(false);
+
+	m_Sampler = Vulkan.Device.createSampler(samplerCreateInfo);
+
+	m_Stats.NumPasses = uint32_t(m_Passes.size());
+	m_Stats.NumTransients = uint32_t(transients.size());
+	m_Stats.NumTransientAllocations = uint32_t(m_AliasGroups.size());
+
+	m_Stats.TransientBytes = 0;
+	for (const Allocation& allocation : m_AliasGroups)
+		m_Stats.TransientBytes += allocation.Size;
+
+	m_Compiled = true;
+}
+
+void RenderGraph::BeginFrame()
+{
+	HZ_ASSERT(m_Compiled, "Render graph is not compiled!");
+
+	m_Frame++;
+	m_Stats.NumLivePasses = 0;
+	m_Stats.NumBarriers = 0;
+
+	// walk backwards, a pass is live if a live pass after it reads what it writes
+	std::vector<bool> read(m_Resources.size(), false);
+
+	for (auto pass = m_Passes.rbegin(); pass != m_Passes.rend(); ++pass)
+	{
+		pass->Live = !pass->Enabled || pass->Enabled();
+
+		if (pass->Live && !pass->SideEffect)
+		{
+			pass->Live = std::any_of(pass->Accesses.begin(), pass->Accesses.end(), [&](const Access& access) {
+				return access.Write && read[access.Target];
+			});
+		}
+
+		if (!pass->Live)
+			continue;
+
+		m_Stats.NumLivePasses++;
+
+		// earlier writes are overwritten, unless this pass reads them as well
+		for (const Access& access : pass->Accesses)
+			read[access.Target] = access.Read || (read[access.Target] && !access.Write);
+	}
+}
+
+void RenderGraph::Execute(vk::CommandBuffer& cmd, uint32_t phase)
+{
+	for (const Pass& pass : m_Passes)
+	{
+		if (pass.Phase != phase || !pass.Live)
+			continue;
+
+		RecordBarriers(cmd, pass);
+
+		GPU_PROFILE_SCOPE(cmd, pass.TimerName.c_str());
+		pass.Execute(cmd);
+	}
+}
+
+void RenderGraph::RenderUI()
+{
+	ImGui::Text("%u of %u passes live, %u barriers",
+				m_Stats.NumLivePasses,
+				m_Stats.NumPasses,
+				m_Stats.NumBarriers);
+
+	ImGui::Text("%u transients in %u allocations, %.1f MB",
+				m_Stats.NumTransients,
+				m_Stats.NumTransientAllocations,
+				float(m_Stats.TransientBytes) / (1024.0f * 1024.0f));
+
+	ImGui::TreePush("render_graph_passes");
+
+	for (const Pass& pass : m_Passes)
+	{
+		if (pass.Live)
+			ImGui::Text("%s", pass.Name);
+		else
+			ImGui::TextDisabled("%s (culled)", pass.Name);
+	}
+
+	ImGui::TreePop();
+}
+
+// --------------------------------------------------------------------
+// PRIVATE HELPER FUNCTIONS
+
+void RenderGraph::GetUsageInfo(Usage usage,
+							   vk::ImageLayout& layout,
+							   vk::PipelineStageFlags& stage,
+							   vk::AccessFlags& access)
+{
+	switch (usage)
+	{
+	case Usage::ColorAttachment:
+		layout = vk::ImageLayout::eColorAttachmentOptimal;
+		stage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+		access = vk::AccessFlagBits::eColorAttachmentWrite;
+		break;
+	case Usage::DepthAttachment:
+		layout = vk::ImageLayout::eDepthAttachmentOptimal;
+		stage = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+		access = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+		break;
+	case Usage::Sampled:
+		layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+		stage = vk::PipelineStageFlagBits::eFragmentShader;
+		access = vk::AccessFlagBits::eShaderRead;
+		break;
+	case Usage::TransferSrc:
+		layout = vk::ImageLayout::eTransferSrcOptimal;
+		stage = vk::PipelineStageFlagBits::eTransfer;
+		access = vk::AccessFlagBits::eTransferRead;
+		break;
+	case Usage::TransferDst:
+		layout = vk::ImageLayout::eTransferDstOptimal;
+		stage = vk::PipelineStageFlagBits::eTransfer;
+		access = vk::AccessFlagBits::eTransferWrite;
+		break;
+	}
+}
+
+void RenderGraph::AddAccess(uint32_t pass, Resource resource, Usage usage, bool write)
+{
+	HZ_ASSERT(resource < m_Resources.size(), "Unknown render graph resource!");
+
+	Access access;
+	access.Target = resource;
+	access.Read = !write;
+	access.Write = write;
+	GetUsageInfo(usage, access.Layout, access.Stage, access.AccessMask);
+
+	std::vector<Access>& accesses = m_Passes[pass].Accesses;
+
+	// a pass that reads and writes an image, e.g. loads an attachment
+	for (Access& other : accesses)
+	{
+		if (other.Target != resource)
+			continue;
+
+		HZ_ASSERT(other.Layout == access.Layout, "A pass has to use an image in a single layout!");
+
+		other.Read |= access.Read;
+		other.Write |= access.Write;
+		other.Stage |= access.Stage;
+		other.AccessMask |= access.AccessMask;
+		return;
+	}
+
+	accesses.push_back(access);
+}
+
+void RenderGraph::CreateTransientImage(ImageResource& image)
+{
+	vk::ImageCreateInfo imageCreateInfo;
+	imageCreateInfo
+		.setExtent(vk::Extent3D(
+			Vulkan.SwapchainExtent.width,
+			Vulkan.SwapchainExtent.height,
+			1
+		))
+		.setFormat(image.Format)
+		.setQueueFamilyIndices(Vulkan.QueueIndices.GraphicsFamily.value())
+		.setImageType(vk::ImageType::e2D)
+		.setInitialLayout(vk::ImageLayout::eUndefined)
+		.setMipLevels(1)
+		.setArrayLayers(1)
+		.setTiling(vk::ImageTiling::eOptimal)
+		.setUsage(image.UsageFlags)
+		.setSharingMode(vk::SharingMode::eExclusive)
+		.setSamples(vk::SampleCountFlagBits::e1);
+
+	image.Image = Vulkan.Device.createImage(imageCreateInfo);
+}
+
+void RenderGraph::RecordBarriers(vk::CommandBuffer& cmd, const Pass& pass)
+{
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	vk::PipelineStageFlags srcStages, dstStages;
+
+	for (const Access& access : pass.Accesses)
+	{
+		ImageResource& r = m_Resources[access.Target];
+
+		// the contents of a transient are discarded on its first use in the frame
+		const bool discard = r.Transient && r.LastFrame != m_Frame;
+		const bool transition = discard || *r.Layout != access.Layout;
+
+		vk::PipelineStageFlags src;
+		vk::AccessFlags srcAccess;
+		bool needed;
+
+		if (discard)
+		{
+			// every previous use of the memory has to be done, also by aliases
+			for (const ImageResource& alias : m_Resources)
+			{
+				if (alias.Transient && alias.AliasGroup == r.AliasGroup)
+				{
+					src |= alias.WriteStages | alias.ReadStages;
+					srcAccess |= alias.WriteAccess;
+				}
+			}
+
+			r.LastFrame = m_Frame;
+			needed = true;
+		}
+		else if (transition || access.Write)
+		{
+			// reads after the last write are ordered after it already
+			src = r.ReadStages ? r.ReadStages : r.WriteStages;
+			srcAccess = r.ReadStages ? vk::AccessFlags() : r.WriteAccess;
+			needed = transition || src;
+		}
+		else
+		{
+			src = r.WriteStages;
+			srcAccess = r.WriteAccess;
+			needed = src && !(Contains(r.VisibleStages, access.Stage) && Contains(r.VisibleAccess, access.AccessMask));
+		}
+
+		if (needed)
+		{
+			barriers.push_back(vk::ImageMemoryBarrier()
+				.setImage(r.Image)
+				.setOldLayout(discard ? vk::ImageLayout::eUndefined : *r.Layout)
+				.setNewLayout(access.Layout)
+				.setSrcAccessMask(srcAccess)
+				.setDstAccessMask(access.AccessMask)
+				.setSubresourceRange(vk::ImageSubresourceRange(r.Aspect, 0, 1, 0, 1)));
+
+			srcStages |= src ? src : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+			dstStages |= access.Stage;
+		}
+
+		*r.Layout = access.Layout;
+
+		if (access.Write)
+		{
+			r.WriteStages = access.Stage;
+			r.WriteAccess = access.AccessMask;
+			r.ReadStages = {};
+			r.VisibleStages = {};
+			r.VisibleAccess = {};
+		}
+		else if (transition)
+		{
+			// the layout transition is the last write, visible to this read
+			r.WriteStages = access.Stage;
+			r.WriteAccess = {};
+			r.ReadStages = access.Stage;
+			r.VisibleStages = access.Stage;
+			r.VisibleAccess = access.AccessMask;
+		}
+		else
+		{
+			r.ReadStages |= access.Stage;
+
+			if (needed)
+			{
+				r.VisibleStages |= access.Stage;
+				r.VisibleAccess |= access.AccessMask;
+			}
+		}
+	}
+
+	if (barriers.empty())
+		return;
+
+	cmd.pipelineBarrier(srcStages,
+						dstStages,
+						{}, // dependency flags
+						{}, // memory barriers
+						{}, // buffer memory barriers
+						barriers);
+
+	m_Stats.NumBarriers += uint32_t(barriers.size());
+}
+
+// --------------------------------------------------------------------
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <functional>
+
+#include "objects/MemoryAllocator.h"
+
+/*
+* A small frame graph. Passes declare which images they read and write, the
+* graph records them in order and derives the barriers in between.
+*
+* Every image keeps track of its layout, its last write and the reads since,
+* so a barrier waits for exactly the stages that touched the image before and
+* only makes writes visible to the stages that need them. The state carries
+* over to the next frame, which orders the passes of consecutive frames in
+* flight as well.
+*
+* Passes are culled each frame if they are disabled, or if nothing live reads
+* what they write and they have no side effect (presenting, host readback).
+* Their barriers disappear with them.
+*
+* Transient images are owned by the graph. Their contents do not survive the
+* frame, and transients that are never live at the same time share memory.
+*
+* A frame may be recorded in several phases, e.g. with host work that waits
+* for the first submission in between. The graph is built once, passes are
+* not added after Compile.
+*/
+class RenderGraph
+{
+public:
+	using Resource = uint32_t;
+	using PassFunction = std::function<void(vk::CommandBuffer& cmd)>;
+
+	enum class Usage
+	{
+		ColorAttachment,
+		DepthAttachment,
+		Sampled, // in the fragment shader
+		TransferSrc,
+		TransferDst,
+	};
+
+	class PassBuilder
+	{
+	public:
+		PassBuilder(RenderGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+		PassBuilder& Read(Resource resource, Usage usage);
+		PassBuilder& Write(Resource resource, Usage usage);
+
+		// The pass is not culled for lack of readers.
+		PassBuilder& SideEffect();
+
+		// Evaluated once per frame in BeginFrame.
+		PassBuilder& EnabledIf(std::function<bool()> enabled);
+
+	private:
+		RenderGraph& m_Graph;
+		uint32_t m_Pass;
+	};
+
+	struct Stats
+	{
+		uint32_t NumPasses = 0;
+		uint32_t NumLivePasses = 0;
+		uint32_t NumBarriers = 0; // image barriers recorded in the last frame
+		uint32_t NumTransients = 0;
+		uint32_t NumTransientAllocations = 0;
+		vk::DeviceSize TransientBytes = 0; // of the aliased allocations
+	};
+
+public:
+	void Exit();
+
+	// The owner keeps layout in sync for its own transfers and asserts.
+	Resource Import(const char* name, vk::Image image, vk::ImageAspectFlags aspect, vk::ImageLayout* layout);
+
+	// Swapchain sized image, created by Compile.
+	Resource CreateTransient(const char* name, vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect);
+
+	// name has to be a string literal, it also names the pass' GPU timer.
+	// Phases have to be added in increasing order.
+	PassBuilder AddPass(const char* name, uint32_t phase, PassFunction execute);
+
+	// Creates and allocates the transient images.
+	void Compile();
+
+	// Evaluates which passes are live this frame.
+	void BeginFrame();
+
+	// Records the live passes of the phase and the barriers before them.
+	void Execute(vk::CommandBuffer& cmd, uint32_t phase);
+
+	vk::ImageView GetImageView(Resource resource) const { return m_Resources[resource].ImageView; }
+	vk::Sampler GetSampler() const { return m_Sampler; }
+	vk::Format GetFormat(Resource resource) const { return m_Resources[resource].Format; }
+
+	const Stats& GetStats() const { return m_Stats; }
+	void RenderUI();
+
+private:
+	struct Access
+	{
+		Resource Target;
+		vk::ImageLayout Layout;
+		vk::PipelineStageFlags Stage;
+		vk::AccessFlags AccessMask;
+		bool Read;
+		bool Write;
+	};
+
+	struct Pass
+	{
+		const char* Name;
+		std::string TimerName;
+		uint32_t Phase;
+		PassFunction Execute;
+		std::function<bool()> Enabled;
+		std::vector<Access> Accesses;
+		bool SideEffect = false;
+		bool Live = false;
+	};
+
+	struct ImageResource
+	{
+		const char* Name;
+		vk::Image Image;
+		vk::ImageView ImageView;
+		vk::ImageAspectFlags Aspect;
+		vk::Format Format = vk::Format::eUndefined;
+		vk::ImageUsageFlags UsageFlags;
+
+		vk::ImageLayout* Layout; // points to OwnLayout for transients
+		vk::ImageLayout OwnLayout = vk::ImageLayout::eUndefined;
+
+		// last write and the reads since, across frames
+		vk::PipelineStageFlags WriteStages;
+		vk::AccessFlags WriteAccess;
+		vk::PipelineStageFlags ReadStages;
+		vk::PipelineStageFlags VisibleStages; // that the last write is visible to
+		vk::AccessFlags VisibleAccess;
+
+		bool Transient = false;
+		uint32_t AliasGroup = UINT32_MAX;
+		uint64_t LastFrame = UINT64_MAX; // transients are discarded on first use in a frame
+
+		uint32_t FirstPass = UINT32_MAX; // lifetime, for aliasing
+		uint32_t LastPass = 0;
+	};
+
+	static void GetUsageInfo(Usage usage, vk::ImageLayout& layout, vk::PipelineStageFlags& stage, vk::AccessFlags& access);
+
+	void AddAccess(uint32_t pass, Resource resource, Usage usage, bool write);
+	void CreateTransientImage(ImageResource& image);
+	void RecordBarriers(vk::CommandBuffer& cmd, const Pass& pass);
+
+private:
+	std::vector<ImageResource> m_Resources;
+	std::vector<Pass> m_Passes;
+
+	std::vector<Allocation> m_AliasGroups; // memory per group of transients
+	vk::Sampler m_Sampler;
+
+	uint64_t m_Frame = 0;
+	bool m_Compiled = false;
+
+	Stats m_Stats;
+};
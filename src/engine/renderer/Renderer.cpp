@@ -1,6 +1,10 @@
 #include "engine/hzpch.h"
 #include "engine/renderer/Renderer.h"
 #include "engine/renderer/objects/Command.h"
+#include "engine/renderer/objects/Shader.h"
+#include "engine/utils/PerformanceTimer.h"
+
+#include <future>
 
 #include <stb_image_write.h>
 
@@ -79,7 +83,7 @@ bool InitImGui()
 		Vulkan.Device,
 		Vulkan.QueueIndices.GraphicsFamily.value(),
 		Vulkan.GraphicsQueue,
-		nullptr,
+		Vulkan.PipelineCache,
 		ImGuiDescriptorPool,
 		/* subpass */ 0,
 		uint32_t(Vulkan.SwapchainImages.size()),
@@ -225,12 +229,17 @@ bool Renderer::Init(int width, int height, int pixelSize, const char* title)
 		return false;
 	}
 
+	// compile stale shaders while the device is being created
+	auto compiledShaders = std::async(std::launch::async, &Shader::CompileStaleShaders);
+
 	if (!InitVulkan())
 	{
 		SPDLOG_ERROR("Failed to initialize vulkan");
 		return false;
 	}
 
+	NumCompiledShaders = compiledShaders.get();
+
 	ImGuiRenderPass.Init();
 
 	if (!InitImGui())
@@ -264,25 +273,16 @@ bool Renderer::Init(int width, int height, int pixelSize, const char* title)
 			return false;
 		}
 
-		// memory
-		auto requirements = Device.getImageMemoryRequirements(m_ScreenshotImage);
-
-		vk::MemoryAllocateInfo allocInfo{
-			requirements.size,
-			Renderer::FindMemoryType(
-				requirements.memoryTypeBits,
-				vk::MemoryPropertyFlagBits::eHostCoherent |
-				vk::MemoryPropertyFlagBits::eHostVisible)
-		};
-
-		m_ScreenshotMemory = Device.allocateMemory(allocInfo);
-		if (!m_ScreenshotMemory)
+		// memory, linear images share blocks with buffers
+		m_ScreenshotAllocation = Allocator.AllocateImage(m_ScreenshotImage,
+														 vk::MemoryPropertyFlagBits::eHostCoherent |
+														 vk::MemoryPropertyFlagBits::eHostVisible,
+														 true);
+		if (!m_ScreenshotAllocation)
 		{
 			SPDLOG_ERROR("Screenshot memory creation failed!");
 			return false;
 		}
-
-		Device.bindImageMemory(m_ScreenshotImage, m_ScreenshotMemory, 0);
 	}
 
 	return true;
@@ -293,7 +293,7 @@ void Renderer::Exit()
 	Device.waitIdle();
 
 	Device.destroyImage(m_ScreenshotImage);
-	Device.freeMemory(m_ScreenshotMemory);
+	Allocator.Free(m_ScreenshotAllocation);
 
 	ImGuiRenderPass.Exit();
 
@@ -308,9 +308,33 @@ void Renderer::Exit()
 
 void Renderer::Begin()
 {
+	FrameData& frame = Frames[CurrentFrame];
+
+	// wait until the last submission of this frame has finished, from here on
+	// its resources are reused
+	{
+		PROFILE_SCOPE("Wait for frame in flight");
+		Device.waitForFences(frame.RenderFinishedFence, true, UINT64_MAX);
+	}
+
+	CommandBuffer = frame.CommandBuffer;
+	ImageAvailableSemaphore = frame.ImageAvailableSemaphore;
+	RenderFinishedSemaphore = frame.RenderFinishedSemaphore;
+	RenderFinishedFence = frame.RenderFinishedFence;
+
 	// acquire image from swap chain
 	CurrentImageIndex = Device.acquireNextImageKHR(Swapchain, UINT64_MAX, ImageAvailableSemaphore).value;
 
+	// the image may still be rendered to by the other frame in flight
+	vk::Fence& imageFence = ImagesInFlight[CurrentImageIndex];
+
+	if (imageFence && imageFence != RenderFinishedFence)
+		Device.waitForFences(imageFence, true, UINT64_MAX);
+
+	imageFence = RenderFinishedFence;
+
+	Device.resetFences(RenderFinishedFence);
+
 	// begin imgui
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -321,6 +345,8 @@ void Renderer::Begin()
 
 	vk::CommandBufferBeginInfo beginInfo;
 	CommandBuffer.begin(beginInfo);
+
+	GpuTimer.BeginFrame(CommandBuffer);
 }
 
 void Renderer::_Screenshot()
@@ -385,8 +411,8 @@ void Renderer::_Screenshot()
 							  vk::PipelineStageFlagBits::eTransfer);
 	}
 
-	// map memory
-	uint8_t* data = reinterpret_cast<uint8_t*>(Device.mapMemory(m_ScreenshotMemory, 0, VK_WHOLE_SIZE));
+	// the memory is persistently mapped
+	uint8_t* data = m_ScreenshotAllocation.Mapped;
 
 	// swizzle color channels, because swapchain format is likely BGRA
 	for (size_t i = 0; i < SwapchainExtent.width * SwapchainExtent.height; i++)
@@ -408,29 +434,30 @@ void Renderer::_Screenshot()
 				   4,
 				   data);
 
-	// unmap
-	Device.unmapMemory(m_ScreenshotMemory);
-
 	screenshotNum++;
 }
 
 void Renderer::End()
 {
 	// render imgui pass
-	RenderImGui();
+	{
+		GPU_PROFILE_SCOPE(CommandBuffer, "GPU ImGui");
+		RenderImGui();
+	}
 
 	// end command buffer
 	CommandBuffer.end();
 
-	// submit
+	// submit, the next frame is recorded while this one renders
 	Submit(true, true);
 
-	WaitForRenderingFinished();
-	GraphicsQueue.waitIdle();
-
 	// screenshot
 	if (m_ShouldScreenshot)
 	{
+		// The fence is not reset here, the next Begin() of this frame waits
+		// on it as well.
+		Device.waitForFences(RenderFinishedFence, true, UINT64_MAX);
+
 		_Screenshot();
 		m_ShouldScreenshot = false;
 	}
@@ -445,10 +472,8 @@ void Renderer::End()
 	if (PresentationQueue.presentKHR(presentInfo) != vk::Result::eSuccess)
 		SPDLOG_WARN("Presentation failed!");
 
-	// ...and wait
-	PresentationQueue.waitIdle();
-
 	CurrentImageIndex = UINT32_MAX;
+	CurrentFrame = (CurrentFrame + 1) % MaxFramesInFlight;
 }
 
 void Renderer::Submit(bool wait, bool signal)
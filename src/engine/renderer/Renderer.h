@@ -9,6 +9,9 @@
 #include <imgui/backends/imgui_impl_vulkan.h>
 
 #include "objects/Image.h"
+#include "objects/MemoryAllocator.h"
+#include "objects/PerFrame.h"
+#include "GpuTimer.h"
 #include "ImGuiRenderPass.h"
 
 struct QueueFamilyIndices
@@ -34,6 +37,21 @@ struct SwapChainSupportDetails
 
 class Renderer
 {
+public:
+	// Number of frames the CPU may record ahead of the GPU. Everything the
+	// host rewrites every frame (uniform buffers, descriptor sets, staging
+	// memory) has to exist once per frame in flight, see PerFrame.
+	constexpr static uint32_t MaxFramesInFlight = MAX_FRAMES_IN_FLIGHT;
+
+	struct FrameData
+	{
+		vk::CommandBuffer CommandBuffer;
+
+		vk::Semaphore ImageAvailableSemaphore;
+		vk::Semaphore RenderFinishedSemaphore;
+		vk::Fence RenderFinishedFence;
+	};
+
 public:
 	static Renderer& GetInstance();
 
@@ -64,8 +82,10 @@ private:
 	bool CreateSwapChainImageViews();
 
 	bool CreateDescriptorPool();
+	bool CreatePipelineCache();
+	void SavePipelineCache();
 	bool CreateCommandPool();
-	bool CreateCommandBuffer();
+	bool CreateCommandBuffers();
 
 	bool CreateSemaphores();
 	bool CreateFences();
@@ -99,6 +119,22 @@ public:
 	vk::CommandPool CommandPool;
 	vk::DescriptorPool DescriptorPool;
 
+	MemoryAllocator Allocator;
+
+	// Persisted in the temp directory between runs. Pipeline creation with it
+	// is thread-safe.
+	vk::PipelineCache PipelineCache;
+	bool PipelineCacheWarm = false; // loaded from a previous run
+
+	uint32_t NumCompiledShaders = 0; // at startup
+
+	PerFrame<FrameData> Frames;
+	uint32_t CurrentFrame = 0;
+
+	// fence of the frame that last rendered to each swapchain image
+	std::vector<vk::Fence> ImagesInFlight;
+
+	// objects of the current frame, set in Begin()
 	vk::CommandBuffer CommandBuffer;
 
 	vk::Semaphore ImageAvailableSemaphore;
@@ -106,13 +142,14 @@ public:
 	vk::Fence RenderFinishedFence;
 
 	ImGuiRenderPass ImGuiRenderPass;
+	GpuTimer GpuTimer;
 
 private:
 	bool m_ShouldScreenshot = false;
 
 	vk::Format m_ScreenshotFormat;
 	vk::Image m_ScreenshotImage;
-	vk::DeviceMemory m_ScreenshotMemory;
+	Allocation m_ScreenshotAllocation;
 
 	void _Screenshot();
 };
@@ -6,6 +6,8 @@
 #include "engine/renderer/objects/Shader.h"
 #include "engine/renderer/objects/Command.h"
 
+#include <fstream>
+
 bool Renderer::CreateSwapChainImageViews()
 {
 	SwapchainImageViews.resize(SwapchainImages.size());
@@ -29,14 +31,15 @@ bool Renderer::CreateSwapChainImageViews()
 
 bool Renderer::CreateDescriptorPool()
 {
+	// render passes allocate their sets once per frame in flight
 	std::array<vk::DescriptorPoolSize, 2> poolSize{
-		vk::DescriptorPoolSize{ vk::DescriptorType::eUniformBuffer, 16 },
-		vk::DescriptorPoolSize{ vk::DescriptorType::eCombinedImageSampler, 32 },
+		vk::DescriptorPoolSize{ vk::DescriptorType::eUniformBuffer, 16 * MaxFramesInFlight },
+		vk::DescriptorPoolSize{ vk::DescriptorType::eCombinedImageSampler, 32 * MaxFramesInFlight },
 	};
 
 	vk::DescriptorPoolCreateInfo info;
 	info.setPoolSizes(poolSize)
-		.setMaxSets(8);
+		.setMaxSets(8 * MaxFramesInFlight);
 
 	DescriptorPool = Device.createDescriptorPool(info);
 	if (!DescriptorPool)
@@ -48,12 +51,90 @@ bool Renderer::CreateDescriptorPool()
 	return true;
 }
 
+static std::filesystem::path GetPipelineCachePath()
+{
+	return AssetManager::GetTempDirectory() / "pipeline_cache.bin";
+}
+
+bool Renderer::CreatePipelineCache()
+{
+	std::vector<char> data;
+
+	std::ifstream file(GetPipelineCachePath(), std::ios::ate | std::ios::binary);
+	if (file.is_open())
+	{
+		data.resize(size_t(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), data.size());
+		file.close();
+	}
+
+	// only reuse a cache written by the same device and driver
+	if (data.size() >= sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		VkPipelineCacheHeaderVersionOne header;
+		memcpy(&header, data.data(), sizeof(header));
+
+		const auto props = PhysicalDevice.getProperties();
+
+		PipelineCacheWarm =
+			header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == props.vendorID &&
+			header.deviceID == props.deviceID &&
+			memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+	}
+
+	if (!PipelineCacheWarm)
+	{
+		if (!data.empty())
+			SPDLOG_INFO("Discarding pipeline cache of another device or driver.");
+
+		data.clear();
+	}
+
+	vk::PipelineCacheCreateInfo info;
+	info.setInitialDataSize(data.size())
+		.setPInitialData(data.data());
+
+	PipelineCache = Device.createPipelineCache(info);
+	if (!PipelineCache)
+	{
+		SPDLOG_ERROR("Pipeline cache creation failed!");
+		return false;
+	}
+
+	return true;
+}
+
+void Renderer::SavePipelineCache()
+{
+	const auto data = Device.getPipelineCacheData(PipelineCache);
+
+	// write to a temporary file first, a truncated cache must never be loaded
+	const auto path = GetPipelineCachePath();
+	auto tempPath = path;
+	tempPath += ".tmp";
+
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		SPDLOG_WARN("Failed to write pipeline cache!");
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	file.close();
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+}
+
 bool CreateFramebufferAttachment(
 	vk::Format format,
 	vk::ImageUsageFlags usage,
 	vk::Image& image,
 	vk::ImageView& view,
-	vk::DeviceMemory& memory
+	Allocation& allocation
 )
 {
 	auto& Device = Renderer::GetInstance().Device;
@@ -87,21 +168,12 @@ bool CreateFramebufferAttachment(
 
 	// memory
 	{
-		auto requirements = Device.getImageMemoryRequirements(image);
-
-		vk::MemoryAllocateInfo allocInfo{
-			requirements.size,
-			Renderer::FindMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)
-		};
-
-		memory = Device.allocateMemory(allocInfo);
-		if (!memory)
+		allocation = Renderer::GetInstance().Allocator.AllocateImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		if (!allocation)
 		{
 			SPDLOG_ERROR("Memory creation failed!");
 			return false;
 		}
-
-		Device.bindImageMemory(image, memory, 0);
 	}
 
 	// create image view
@@ -145,33 +217,39 @@ bool Renderer::CreateCommandPool()
 	return true;
 }
 
-bool Renderer::CreateCommandBuffer()
+bool Renderer::CreateCommandBuffers()
 {
 	vk::CommandBufferAllocateInfo info;
-	info.setCommandBufferCount(1)
+	info.setCommandBufferCount(MaxFramesInFlight)
 		.setCommandPool(CommandPool)
 		.setLevel(vk::CommandBufferLevel::ePrimary);
 
-	CommandBuffer = Device.allocateCommandBuffers(info).front();
+	auto commandBuffers = Device.allocateCommandBuffers(info);
 
-	if (!CommandBuffer)
+	if (commandBuffers.size() != MaxFramesInFlight)
 	{
-		SPDLOG_ERROR("Failed to allocate primary command buffer!");
+		SPDLOG_ERROR("Failed to allocate primary command buffers!");
 		return false;
 	}
 
+	for (uint32_t i = 0; i < MaxFramesInFlight; i++)
+		Frames[i].CommandBuffer = commandBuffers[i];
+
 	return true;
 }
 
 bool Renderer::CreateSemaphores()
 {
-	ImageAvailableSemaphore = Device.createSemaphore({});
-	RenderFinishedSemaphore = Device.createSemaphore({});
-
-	if (!RenderFinishedSemaphore || !ImageAvailableSemaphore)
+	for (FrameData& frame : Frames)
 	{
-		SPDLOG_ERROR("Semaphore creation failed!");
-		return false;
+		frame.ImageAvailableSemaphore = Device.createSemaphore({});
+		frame.RenderFinishedSemaphore = Device.createSemaphore({});
+
+		if (!frame.RenderFinishedSemaphore || !frame.ImageAvailableSemaphore)
+		{
+			SPDLOG_ERROR("Semaphore creation failed!");
+			return false;
+		}
 	}
 
 	return true;
@@ -179,10 +257,20 @@ bool Renderer::CreateSemaphores()
 
 bool Renderer::CreateFences()
 {
-	vk::FenceCreateInfo info;
-	RenderFinishedFence = Device.createFence(info);
+	// signaled, so that the first Begin() of each frame does not block
+	vk::FenceCreateInfo info(vk::FenceCreateFlagBits::eSignaled);
 
-	return RenderFinishedFence;
+	for (FrameData& frame : Frames)
+	{
+		frame.RenderFinishedFence = Device.createFence(info);
+
+		if (!frame.RenderFinishedFence)
+			return false;
+	}
+
+	ImagesInFlight.assign(SwapchainImages.size(), nullptr);
+
+	return true;
 }
 
 // ich habe den besten freund aus hu .
@@ -197,6 +285,10 @@ bool Renderer::InitVulkan()
 
 		VK_KHR_MAINTENANCE2_EXTENSION_NAME,
 		VK_KHR_MULTIVIEW_EXTENSION_NAME,
+
+		// used by the memory allocator
+		VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
+		VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME,
 	};
 
 	if (!CreateInstance()) return false;
@@ -214,12 +306,15 @@ bool Renderer::InitVulkan()
 
 	if (!PickPhysicalDevice()) return false;
 	if (!CreateLogicalDevice()) return false;
+	Allocator.Init();
 	if (!Command::Init()) return false;
 	if (!CreateSwapChain()) return false;
 	if (!CreateSwapChainImageViews()) return false;
 	if (!CreateDescriptorPool()) return false;
+	if (!CreatePipelineCache()) return false;
 	if (!CreateCommandPool()) return false;
-	if (!CreateCommandBuffer()) return false;
+	if (!CreateCommandBuffers()) return false;
+	if (!GpuTimer.Init()) return false;
 	if (!CreateSemaphores()) return false;
 	if (!CreateFences()) return false;
 
@@ -228,17 +323,28 @@ bool Renderer::InitVulkan()
 
 void Renderer::ExitVulkan()
 {
-	Device.destroyFence(RenderFinishedFence);
-	Device.destroySemaphore(RenderFinishedSemaphore);
-	Device.destroySemaphore(ImageAvailableSemaphore);
+	for (FrameData& frame : Frames)
+	{
+		Device.destroyFence(frame.RenderFinishedFence);
+		Device.destroySemaphore(frame.RenderFinishedSemaphore);
+		Device.destroySemaphore(frame.ImageAvailableSemaphore);
+	}
+
 	Device.destroyCommandPool(CommandPool);
 	Device.destroyDescriptorPool(DescriptorPool);
+
+	SavePipelineCache();
+	Device.destroyPipelineCache(PipelineCache);
+
+	GpuTimer.Exit();
+
 	for (auto& framebuffer : SwapchainFramebuffers)
 		Device.destroyFramebuffer(framebuffer);
 	for (auto& view : SwapchainImageViews)
 		Device.destroyImageView(view);
 	Command::Exit();
 	Device.destroySwapchainKHR(Swapchain);
+	Allocator.Exit();
 	Device.destroy();
 	Instance.destroySurfaceKHR(Surface);
 	Instance.destroy();
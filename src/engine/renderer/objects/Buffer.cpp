@@ -16,22 +16,14 @@ bool Buffer::Create(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryP
 		return false;
 	}
 
-	// allocate buffer memory
-	auto requirements = Renderer::GetInstance().Device.getBufferMemoryRequirements(Buffer);
-	vk::MemoryAllocateInfo allocInfo;
-	allocInfo
-		.setAllocationSize(requirements.size)
-		.setMemoryTypeIndex(Renderer::FindMemoryType(requirements.memoryTypeBits, properties));
-
-	Memory = Renderer::GetInstance().Device.allocateMemory(allocInfo);
-	if (!Memory)
+	// allocate and bind buffer memory
+	Allocation = Renderer::GetInstance().Allocator.AllocateBuffer(Buffer, properties);
+	if (!Allocation)
 	{
 		SPDLOG_ERROR("Buffer memory creation failed!");
 		return false;
 	}
 
-	Renderer::GetInstance().Device.bindBufferMemory(Buffer, Memory, 0);
-
 	Size = size;
 
 	return true;
@@ -39,22 +31,18 @@ bool Buffer::Create(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryP
 
 void Buffer::Destroy()
 {
-	if (Memory)
-	{
-		Renderer::GetInstance().Device.freeMemory(Memory);
-		Memory = nullptr;
-	}
-
 	if (Buffer)
 	{
 		Renderer::GetInstance().Device.destroyBuffer(Buffer);
 		Buffer = nullptr;
 	}
+
+	Renderer::GetInstance().Allocator.Free(Allocation);
 }
 
 void Buffer::Map(void* source, vk::DeviceSize size, vk::DeviceSize offset)
 {
-	void* target = Vulkan.Device.mapMemory(Memory, offset, size);
-	memcpy(target, source, size);
-	Vulkan.Device.unmapMemory(Memory);
+	HZ_ASSERT(Allocation.Mapped, "Buffer is not host visible!");
+
+	memcpy(Allocation.Mapped + offset, source, size);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "engine/renderer/objects/MemoryAllocator.h"
+
 class Buffer
 {
 public:
@@ -13,5 +15,5 @@ public:
 	vk::DeviceSize Size;
 
 	vk::Buffer Buffer;
-	vk::DeviceMemory Memory;
+	Allocation Allocation;
 };
@@ -39,21 +39,12 @@ bool DepthBuffer::Create()
 
 	// memory
 	{
-		auto requirements = Renderer::GetInstance().Device.getImageMemoryRequirements(m_Image);
-
-		vk::MemoryAllocateInfo allocInfo{
-			requirements.size,
-			Renderer::FindMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)
-		};
-
-		m_Memory = Renderer::GetInstance().Device.allocateMemory(allocInfo);
-		if (!m_Memory)
+		m_Allocation = Renderer::GetInstance().Allocator.AllocateImage(m_Image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		if (!m_Allocation)
 		{
 			SPDLOG_ERROR("Depth buffer memory creation failed!");
 			return false;
 		}
-
-		Renderer::GetInstance().Device.bindImageMemory(m_Image, m_Memory, 0);
 	}
 
 	// create image view
@@ -95,9 +86,5 @@ void DepthBuffer::Destroy()
 		m_View = nullptr;
 	}
 
-	if (m_Memory)
-	{
-		Renderer::GetInstance().Device.freeMemory(m_Memory);
-		m_Memory = nullptr;
-	}
+	Renderer::GetInstance().Allocator.Free(m_Allocation);
 }
@@ -1,19 +1,21 @@
 #pragma once
 
+#include "engine/renderer/objects/MemoryAllocator.h"
+
 class DepthBuffer
 {
 public:
 	bool Create();
 	void Destroy();
 
-	operator bool() const { return m_Image && m_View && m_Memory; }
+	operator bool() const { return m_Image && m_View && m_Allocation; }
 
 	const vk::Image& GetImage() const { return m_Image; }
 	const vk::ImageView& GetView() const { return m_View; }
-	const vk::DeviceMemory& GetMemory() const { return m_Memory; }
+	const Allocation& GetAllocation() const { return m_Allocation; }
 
 private:
 	vk::Image m_Image;
 	vk::ImageView m_View;
-	vk::DeviceMemory m_Memory;
+	Allocation m_Allocation;
 };
@@ -98,22 +98,13 @@ bool Image::Create(vk::Extent2D dim, uint32_t numChannels, vk::Format format, vk
 	}
 
 	// memory
-	auto requirements = Renderer::GetInstance().Device.getImageMemoryRequirements(TextureImage);
-
-	vk::MemoryAllocateInfo allocInfo{
-		requirements.size,
-		Renderer::FindMemoryType(requirements.memoryTypeBits, properties)
-	};
-	
-	Memory = Renderer::GetInstance().Device.allocateMemory(allocInfo);
-	if (!Memory)
+	Allocation = Renderer::GetInstance().Allocator.AllocateImage(TextureImage, properties);
+	if (!Allocation)
 	{
 		SPDLOG_ERROR("Texture memory creation failed!");
 		return false;
 	}
 
-	Renderer::GetInstance().Device.bindImageMemory(TextureImage, Memory, 0);
-
 	// create image view
 	vk::ComponentMapping mapping{};
 	vk::ImageViewCreateInfo viewInfo;
@@ -265,11 +256,7 @@ void Image::Destroy()
 		TextureImage = nullptr;
 	}
 
-	if (Memory)
-	{
-		Renderer::GetInstance().Device.freeMemory(Memory);
-		Memory = nullptr;
-	}
+	Renderer::GetInstance().Allocator.Free(Allocation);
 
 	if (View)
 	{
@@ -26,7 +26,7 @@ public:
 
 	operator bool()
 	{
-		return TextureImage && StagingBuffer.Buffer && Memory && View && Sampler;
+		return TextureImage && StagingBuffer.Buffer && Allocation && View && Sampler;
 	}
 
 	vk::Extent2D Dimensions;
@@ -36,7 +36,7 @@ public:
 
 	vk::Image TextureImage;
 	Buffer StagingBuffer;
-	vk::DeviceMemory Memory;
+	Allocation Allocation;
 	vk::ImageView View;
 	vk::Sampler Sampler;
 	vk::Filter Filter;
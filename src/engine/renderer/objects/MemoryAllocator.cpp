@@ -0,0 +1,389 @@
+#include "engine/hzpch.h"
+#include "engine/renderer/objects/MemoryAllocator.h"
+#include "engine/renderer/Renderer.h"
+
+#include <map>
+
+#define MAX_BLOCK_SIZE (64ull * 1024 * 1024)
+
+struct MemoryBlock
+{
+	bool Allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+	void Free(vk::DeviceSize offset, vk::DeviceSize size);
+
+	vk::DeviceMemory Memory;
+	vk::DeviceSize Size = 0;
+	vk::DeviceSize Used = 0;
+	uint32_t NumAllocations = 0;
+	uint8_t* Mapped = nullptr;
+
+	uint32_t PoolIndex = 0;
+
+	// offset -> size, adjacent ranges are always merged
+	std::map<vk::DeviceSize, vk::DeviceSize> FreeRanges;
+};
+
+MemoryStats& MemoryStats::operator+=(const MemoryStats& other)
+{
+	NumBlocks += other.NumBlocks;
+	NumAllocations += other.NumAllocations;
+	NumOwnAllocations += other.NumOwnAllocations;
+	BlockBytes += other.BlockBytes;
+	UsedBytes += other.UsedBytes;
+	OwnBytes += other.OwnBytes;
+
+	return *this;
+}
+
+// --------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+void MemoryAllocator::Init()
+{
+	auto memProps = Vulkan.PhysicalDevice.getMemoryProperties();
+
+	m_Pools.resize(2 * memProps.memoryTypeCount);
+	m_OwnStats.resize(memProps.memoryTypeCount);
+
+	for (uint32_t i = 0; i < memProps.memoryTypeCount; i++)
+	{
+		const vk::MemoryType& type = memProps.memoryTypes[i];
+		const vk::DeviceSize heapSize = memProps.memoryHeaps[type.heapIndex].size;
+
+		// small heaps (e.g. the host-visible device-local window) get smaller blocks
+		for (Tiling tiling : { Linear, Optimal })
+		{
+			Pool& pool = GetPool(i, tiling);
+			pool.BlockSize = std::min(MAX_BLOCK_SIZE, heapSize / 8);
+			pool.HostVisible = bool(type.propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+		}
+	}
+}
+
+void MemoryAllocator::Exit()
+{
+	for (Pool& pool : m_Pools)
+	{
+		for (auto& block : pool.Blocks)
+		{
+			if (block->NumAllocations > 0)
+				SPDLOG_WARN("{} allocations still alive in memory block!", block->NumAllocations);
+
+			if (block->Mapped)
+				Vulkan.Device.unmapMemory(block->Memory);
+
+			Vulkan.Device.freeMemory(block->Memory);
+		}
+	}
+
+	for (const MemoryStats& stats : m_OwnStats)
+	{
+		if (stats.NumOwnAllocations > 0)
+			SPDLOG_WARN("{} own allocations still alive!", stats.NumOwnAllocations);
+	}
+
+	m_Pools.clear();
+	m_OwnStats.clear();
+}
+
+Allocation MemoryAllocator::AllocateBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties)
+{
+	vk::BufferMemoryRequirementsInfo2 info(buffer);
+	auto chain = Vulkan.Device.getBufferMemoryRequirements2KHR<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(info);
+
+	const auto& requirements = chain.get<vk::MemoryRequirements2>().memoryRequirements;
+	const auto& dedicated = chain.get<vk::MemoryDedicatedRequirements>();
+
+	vk::MemoryDedicatedAllocateInfo dedicatedInfo({}, buffer);
+
+	Allocation allocation = Allocate(requirements,
+									 properties,
+									 Linear,
+									 dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation,
+									 &dedicatedInfo);
+
+	if (allocation)
+		Vulkan.Device.bindBufferMemory(buffer, allocation.Memory, allocation.Offset);
+
+	return allocation;
+}
+
+Allocation MemoryAllocator::AllocateImage(vk::Image image, vk::MemoryPropertyFlags properties, bool linear)
+{
+	vk::ImageMemoryRequirementsInfo2 info(image);
+	auto chain = Vulkan.Device.getImageMemoryRequirements2KHR<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(info);
+
+	const auto& requirements = chain.get<vk::MemoryRequirements2>().memoryRequirements;
+	const auto& dedicated = chain.get<vk::MemoryDedicatedRequirements>();
+
+	vk::MemoryDedicatedAllocateInfo dedicatedInfo(image, {});
+
+	Allocation allocation = Allocate(requirements,
+									 properties,
+									 linear ? Linear : Optimal,
+									 dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation,
+									 &dedicatedInfo);
+
+	if (allocation)
+		Vulkan.Device.bindImageMemory(image, allocation.Memory, allocation.Offset);
+
+	return allocation;
+}
+
+Allocation MemoryAllocator::AllocateAliased(const std::vector<vk::Image>& images, vk::MemoryPropertyFlags properties)
+{
+	HZ_ASSERT(!images.empty(), "No images to alias!");
+
+	vk::MemoryRequirements requirements;
+	requirements.memoryTypeBits = UINT32_MAX;
+
+	for (vk::Image image : images)
+	{
+		auto r = Vulkan.Device.getImageMemoryRequirements(image);
+
+		requirements.size = std::max(requirements.size, r.size);
+		requirements.alignment = std::max(requirements.alignment, r.alignment);
+		requirements.memoryTypeBits &= r.memoryTypeBits;
+	}
+
+	HZ_ASSERT(requirements.memoryTypeBits != 0, "Images have no memory type in common!");
+
+	// a dedicated allocation may only be bound to a single resource
+	Allocation allocation = Allocate(requirements, properties, Optimal, false, nullptr);
+
+	if (allocation)
+	{
+		for (vk::Image image : images)
+			Vulkan.Device.bindImageMemory(image, allocation.Memory, allocation.Offset);
+	}
+
+	return allocation;
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+	if (!allocation)
+		return;
+
+	if (MemoryBlock* block = allocation.Block)
+	{
+		block->Free(allocation.Offset, allocation.Size);
+
+		// keep one empty block per pool around, so that a resource that is
+		// recreated every frame does not allocate device memory every frame
+		Pool& pool = m_Pools[block->PoolIndex];
+
+		const auto isOtherEmptyBlock = [&](const auto& b) { return b.get() != block && b->NumAllocations == 0; };
+
+		if (block->NumAllocations == 0 &&
+			std::any_of(pool.Blocks.begin(), pool.Blocks.end(), isOtherEmptyBlock))
+		{
+			if (block->Mapped)
+				Vulkan.Device.unmapMemory(block->Memory);
+
+			Vulkan.Device.freeMemory(block->Memory);
+
+			auto it = std::find_if(pool.Blocks.begin(), pool.Blocks.end(),
+								   [&](const auto& b) { return b.get() == block; });
+			pool.Blocks.erase(it);
+		}
+	}
+	else
+	{
+		if (allocation.Mapped)
+			Vulkan.Device.unmapMemory(allocation.Memory);
+
+		Vulkan.Device.freeMemory(allocation.Memory);
+
+		MemoryStats& stats = m_OwnStats[allocation.MemoryType];
+		stats.NumAllocations--;
+		stats.NumOwnAllocations--;
+		stats.OwnBytes -= allocation.Size;
+	}
+
+	allocation = {};
+}
+
+MemoryStats MemoryAllocator::GetStats() const
+{
+	MemoryStats stats;
+
+	for (uint32_t i = 0; i < GetMemoryTypeCount(); i++)
+		stats += GetStats(i);
+
+	return stats;
+}
+
+MemoryStats MemoryAllocator::GetStats(uint32_t memoryType) const
+{
+	MemoryStats stats = m_OwnStats[memoryType];
+
+	for (uint32_t tiling = 0; tiling < 2; tiling++)
+	{
+		for (const auto& block : m_Pools[2 * memoryType + tiling].Blocks)
+		{
+			stats.NumBlocks++;
+			stats.NumAllocations += block->NumAllocations;
+			stats.BlockBytes += block->Size;
+			stats.UsedBytes += block->Used;
+		}
+	}
+
+	return stats;
+}
+
+// --------------------------------------------------------------------
+// PRIVATE HELPER FUNCTIONS
+
+Allocation MemoryAllocator::Allocate(const vk::MemoryRequirements& requirements,
+									 vk::MemoryPropertyFlags properties,
+									 Tiling tiling,
+									 bool dedicated,
+									 const vk::MemoryDedicatedAllocateInfo* dedicatedInfo)
+{
+	const uint32_t memoryType = Renderer::FindMemoryType(requirements.memoryTypeBits, properties);
+	Pool& pool = GetPool(memoryType, tiling);
+
+	if (dedicated || requirements.size > pool.BlockSize / 2)
+		return AllocateOwn(requirements.size, memoryType, dedicated ? dedicatedInfo : nullptr);
+
+	Allocation allocation;
+	allocation.Size = requirements.size;
+	allocation.MemoryType = memoryType;
+
+	auto fill = [&](MemoryBlock* block)
+	{
+		allocation.Memory = block->Memory;
+		allocation.Block = block;
+
+		if (block->Mapped)
+			allocation.Mapped = block->Mapped + allocation.Offset;
+	};
+
+	// first fit
+	for (auto& block : pool.Blocks)
+	{
+		if (block->Allocate(requirements.size, requirements.alignment, allocation.Offset))
+		{
+			fill(block.get());
+			return allocation;
+		}
+	}
+
+	// new block
+	vk::MemoryAllocateInfo allocInfo(pool.BlockSize, memoryType);
+
+	auto block = std::make_unique<MemoryBlock>();
+	block->Memory = Vulkan.Device.allocateMemory(allocInfo);
+	if (!block->Memory)
+	{
+		SPDLOG_ERROR("Memory block allocation failed!");
+		return {};
+	}
+
+	block->Size = pool.BlockSize;
+	block->PoolIndex = uint32_t(&pool - m_Pools.data());
+	block->FreeRanges[0] = pool.BlockSize;
+
+	// host-visible blocks stay mapped, a memory object can only be mapped once
+	if (pool.HostVisible)
+		block->Mapped = reinterpret_cast<uint8_t*>(Vulkan.Device.mapMemory(block->Memory, 0, VK_WHOLE_SIZE));
+
+	block->Allocate(requirements.size, requirements.alignment, allocation.Offset);
+	fill(block.get());
+
+	pool.Blocks.push_back(std::move(block));
+
+	return allocation;
+}
+
+Allocation MemoryAllocator::AllocateOwn(vk::DeviceSize size,
+										uint32_t memoryType,
+										const vk::MemoryDedicatedAllocateInfo* dedicatedInfo)
+{
+	vk::MemoryAllocateInfo allocInfo(size, memoryType);
+	if (dedicatedInfo)
+		allocInfo.setPNext(dedicatedInfo);
+
+	Allocation allocation;
+	allocation.Memory = Vulkan.Device.allocateMemory(allocInfo);
+	if (!allocation.Memory)
+	{
+		SPDLOG_ERROR("Memory allocation failed!");
+		return {};
+	}
+
+	allocation.Size = size;
+	allocation.MemoryType = memoryType;
+
+	if (GetPool(memoryType, Linear).HostVisible)
+		allocation.Mapped = reinterpret_cast<uint8_t*>(Vulkan.Device.mapMemory(allocation.Memory, 0, VK_WHOLE_SIZE));
+
+	MemoryStats& stats = m_OwnStats[memoryType];
+	stats.NumAllocations++;
+	stats.NumOwnAllocations++;
+	stats.OwnBytes += size;
+
+	return allocation;
+}
+
+// --------------------------------------------------------------------
+// MEMORY BLOCK
+
+bool MemoryBlock::Allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset)
+{
+	for (auto it = FreeRanges.begin(); it != FreeRanges.end(); ++it)
+	{
+		const vk::DeviceSize begin = it->first;
+		const vk::DeviceSize end = it->first + it->second;
+		const vk::DeviceSize aligned = (begin + alignment - 1) / alignment * alignment;
+
+		if (aligned + size > end)
+			continue;
+
+		// the alignment padding and the rest stay free
+		FreeRanges.erase(it);
+
+		if (aligned > begin)
+			FreeRanges[begin] = aligned - begin;
+
+		if (aligned + size < end)
+			FreeRanges[aligned + size] = end - (aligned + size);
+
+		offset = aligned;
+		Used += size;
+		NumAllocations++;
+
+		return true;
+	}
+
+	return false;
+}
+
+void MemoryBlock::Free(vk::DeviceSize offset, vk::DeviceSize size)
+{
+	Used -= size;
+	NumAllocations--;
+
+	auto next = FreeRanges.lower_bound(offset);
+
+	if (next != FreeRanges.begin())
+	{
+		auto prev = std::prev(next);
+
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			FreeRanges.erase(prev);
+		}
+	}
+
+	if (next != FreeRanges.end() && offset + size == next->first)
+	{
+		size += next->second;
+		FreeRanges.erase(next);
+	}
+
+	FreeRanges[offset] = size;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+struct MemoryBlock;
+
+// A range of device memory bound to one resource, or to several aliasing
+// resources. Host-visible memory is persistently mapped, never call
+// mapMemory on Memory directly.
+struct Allocation
+{
+	vk::DeviceMemory Memory;
+	vk::DeviceSize Offset = 0;
+	vk::DeviceSize Size = 0;
+	uint8_t* Mapped = nullptr;
+
+	uint32_t MemoryType = UINT32_MAX;
+	MemoryBlock* Block = nullptr; // nullptr if the allocation owns Memory
+
+	operator bool() const { return Memory; }
+};
+
+struct MemoryStats
+{
+	uint32_t NumBlocks = 0;
+	uint32_t NumAllocations = 0;
+	uint32_t NumOwnAllocations = 0;
+
+	vk::DeviceSize BlockBytes = 0; // allocated from the driver for blocks
+	vk::DeviceSize UsedBytes = 0; // handed out from blocks
+	vk::DeviceSize OwnBytes = 0; // allocations with their own device memory
+
+	MemoryStats& operator+=(const MemoryStats& other);
+};
+
+/*
+* Sub-allocates device memory for buffers and images from large blocks per
+* memory type, so that the number of vkAllocateMemory calls stays small.
+*
+* Buffers and optimally tiled images are kept in separate blocks, so that
+* bufferImageGranularity never has to be considered. Resources that the driver
+* prefers to have a dedicated allocation for, and resources larger than half a
+* block, get their own device memory.
+*
+* Not thread-safe, resources are created and destroyed on the main thread.
+*/
+class MemoryAllocator
+{
+public:
+	void Init();
+	void Exit();
+
+	// Allocate memory with the given properties and bind it to the resource.
+	Allocation AllocateBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties);
+	Allocation AllocateImage(vk::Image image, vk::MemoryPropertyFlags properties, bool linear = false);
+
+	// Binds all images to the same memory, sized for the largest of them. For
+	// transient render targets that are never live at the same time. Switching
+	// between them needs a barrier with an undefined old layout, the contents
+	// do not survive.
+	Allocation AllocateAliased(const std::vector<vk::Image>& images, vk::MemoryPropertyFlags properties);
+
+	// Resets the allocation, does nothing for empty ones.
+	void Free(Allocation& allocation);
+
+	MemoryStats GetStats() const;
+	MemoryStats GetStats(uint32_t memoryType) const;
+	uint32_t GetMemoryTypeCount() const { return uint32_t(m_Pools.size() / 2); }
+
+private:
+	enum Tiling
+	{
+		Linear = 0,
+		Optimal = 1,
+	};
+
+	struct Pool
+	{
+		std::vector<std::unique_ptr<MemoryBlock>> Blocks;
+		vk::DeviceSize BlockSize = 0;
+		bool HostVisible = false;
+	};
+
+	Allocation Allocate(const vk::MemoryRequirements& requirements,
+						vk::MemoryPropertyFlags properties,
+						Tiling tiling,
+						bool dedicated,
+						const vk::MemoryDedicatedAllocateInfo* dedicatedInfo);
+
+	Allocation AllocateOwn(vk::DeviceSize size,
+						   uint32_t memoryType,
+						   const vk::MemoryDedicatedAllocateInfo* dedicatedInfo);
+
+	Pool& GetPool(uint32_t memoryType, Tiling tiling) { return m_Pools[2 * memoryType + tiling]; }
+
+private:
+	// two pools per memory type, see Tiling
+	std::vector<Pool> m_Pools;
+
+	std::vector<MemoryStats> m_OwnStats; // per memory type
+};
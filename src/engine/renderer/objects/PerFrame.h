@@ -0,0 +1,13 @@
+#pragma once
+
+#include <array>
+
+// Number of frames the CPU may record ahead of the GPU, see Renderer.
+#define MAX_FRAMES_IN_FLIGHT 2
+
+// One instance per frame in flight, indexed with Renderer::CurrentFrame. Used
+// for everything the host rewrites every frame, like uniform buffers and the
+// descriptor sets referring to them, so that the frame still executing on the
+// GPU is not affected.
+template <typename T>
+using PerFrame = std::array<T, MAX_FRAMES_IN_FLIGHT>;
@@ -137,7 +137,7 @@ bool Pipeline::Create(
 		.setPViewportState(&viewportInfo)
 		.setPDepthStencilState(&depthStencilState);
 
-	m_Pipeline = Renderer::GetInstance().Device.createGraphicsPipeline({}, info).value;
+	m_Pipeline = Renderer::GetInstance().Device.createGraphicsPipeline(Renderer::GetInstance().PipelineCache, info).value;
 	if (!m_Pipeline)
 	{
 		SPDLOG_ERROR("Pipeline creation failed!");
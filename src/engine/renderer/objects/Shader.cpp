@@ -4,7 +4,11 @@
 #include "engine/assets/AssetManager.h"
 #include "engine/renderer/Renderer.h"
 
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
+#include <set>
+#include <thread>
 
 #if !PRODUCTION
 	#include <shaderc/shaderc.hpp>
@@ -47,6 +51,15 @@ size_t ReadHash(const AssetPathAbs& filename)
 	return 0;
 }
 
+// glslc of the Vulkan SDK, or the one on the PATH if VULKAN_SDK is not set.
+std::string GetGlslcPath()
+{
+	if (const char* sdk = std::getenv("VULKAN_SDK"))
+		return (std::filesystem::path(sdk) / "Bin" / "glslc").string();
+
+	return "glslc";
+}
+
 bool Shader::Create(const AssetPathRel& path, vk::ShaderStageFlagBits stage)
 {
 	bool isEngineFile = path.IsEngineFile();
@@ -56,6 +69,117 @@ bool Shader::Create(const AssetPathRel& path, vk::ShaderStageFlagBits stage)
 	AssetPathAbs absSpvFilepath = spvFilepath.MakeAbsolute(isEngineFile);
 
 #if !PRODUCTION
+	if (!CompileIfStale(path))
+		return false;
+#endif
+
+	if (!absSpvFilepath.Exists())
+	{
+		SPDLOG_ERROR("Compiled shader '{}' does not exist!", spvFilepath);
+		return false;
+	}
+
+	// load compiled code
+	std::vector<uint32_t> code;
+	ReadBinaryFile(absSpvFilepath, code);
+
+	// create module
+	vk::ShaderModuleCreateInfo info({}, code.size() * sizeof(uint32_t), code.data());
+	Module = Renderer::GetInstance().Device.createShaderModule(info);
+
+	if (!Module)
+	{
+		SPDLOG_ERROR("Failed to load shader '{}'!", path);
+		return false;
+	}
+
+	Stage = stage;
+
+	CreateInfo
+		.setStage(Stage)
+		.setModule(Module)
+		.setPName("main");
+
+	SPDLOG_INFO("Loaded shader '{}'!", path);
+
+	return operator bool();
+}
+
+void Shader::Destroy()
+{
+	if (Module)
+	{
+		Renderer::GetInstance().Device.destroyShaderModule(Module);
+		Module = nullptr;
+	}
+}
+
+uint32_t Shader::CompileStaleShaders()
+{
+#if PRODUCTION
+	return 0;
+#else
+	// collect shader sources, relative to their assets directory
+	std::set<std::filesystem::path> sources;
+
+	for (const auto& root : { AssetManager::Data.EngineAssetsDirectory, AssetManager::Data.AssetsDirectory })
+	{
+		if (!std::filesystem::exists(root / "shaders"))
+			continue;
+
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(root / "shaders"))
+		{
+			const auto extension = entry.path().extension();
+
+			if (extension == ".vert" || extension == ".frag" || extension == ".comp" || extension == ".geom")
+				sources.insert(std::filesystem::relative(entry.path(), root));
+		}
+	}
+
+	std::vector<AssetPathRel> paths(sources.begin(), sources.end());
+
+	// every worker picks the next shader until none are left
+	std::atomic_uint32_t next = 0;
+	std::atomic_uint32_t numCompiled = 0;
+	std::atomic_uint32_t numFailed = 0;
+
+	auto worker = [&]()
+	{
+		for (uint32_t i = next++; i < paths.size(); i = next++)
+		{
+			bool compiled = false;
+
+			if (!CompileIfStale(paths[i], &compiled))
+				numFailed++;
+			else if (compiled)
+				numCompiled++;
+		}
+	};
+
+	const uint32_t numThreads = std::min(std::max(std::thread::hardware_concurrency(), 1u), uint32_t(paths.size()));
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 0; i < numThreads; i++)
+		threads.emplace_back(worker);
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (numFailed)
+		SPDLOG_ERROR("{} of {} shaders failed to compile, their compiled code may be stale.", numFailed.load(), paths.size());
+
+	return numCompiled;
+#endif
+}
+
+bool Shader::CompileIfStale(const AssetPathRel& path, bool* compiled)
+{
+#if !PRODUCTION
+	bool isEngineFile = path.IsEngineFile();
+
+	AssetPathRel spvFilepath = path.ApplyFixes("compiled_", ".spv");
+	AssetPathAbs absSpvFilepath = spvFilepath.MakeAbsolute(isEngineFile);
+
 	AssetPathRel hashFilepath = (path + ".hash").MakeTemp();
 	AssetPathAbs absHashFilepath = hashFilepath.MakeAbsolute(isEngineFile);
 
@@ -100,55 +224,34 @@ bool Shader::Create(const AssetPathRel& path, vk::ShaderStageFlagBits stage)
 #endif
 
 		// call glslc
-		std::string cmd = "E:\\dev\\VulkanSDK\\1.3.224.1\\Bin\\glslc " + absPath.string() + " -o " + absSpvFilepath.string();
-		if (system(cmd.c_str()))
+		const std::string glslc = GetGlslcPath();
+		std::string cmd = "\"" + glslc + "\" \"" + absPath.string() + "\" -o \"" + absSpvFilepath.string() + "\"";
+
+#ifdef _WIN32
+		// cmd.exe strips the outermost quotes of the command
+		cmd = "\"" + cmd + "\"";
+#endif
+
+		if (const int result = std::system(cmd.c_str()))
 		{
-			SPDLOG_ERROR("Failed to compile shader '{}'!", path);
+			SPDLOG_ERROR("Failed to compile shader '{}' with '{}' (exit code {})!", path, glslc, result);
 			return false;
 		}
 
-		// store hash
-		std::filesystem::create_directories(absHashFilepath.path().parent_path());
+		// store hash, other threads may create the same directories
+		std::error_code error;
+		std::filesystem::create_directories(absHashFilepath.path().parent_path(), error);
 
 		std::ofstream file(absHashFilepath.string(), std::ios::binary);
 		HZ_ASSERT(file.is_open(), "Failed to open shader hash file! ({})", path);
 
 		file.write((char*)&computedHash, sizeof(computedHash));
 		file.close();
-	}
-#endif
-
-	// load compiled code
-	std::vector<uint32_t> code;
-	ReadBinaryFile(absSpvFilepath, code);
 
-	// create module
-	vk::ShaderModuleCreateInfo info({}, code.size() * sizeof(uint32_t), code.data());
-	Module = Renderer::GetInstance().Device.createShaderModule(info);
-
-	if (!Module)
-	{
-		SPDLOG_ERROR("Failed to load shader '{}'!", path);
-		return false;
+		if (compiled)
+			*compiled = true;
 	}
+#endif
 
-	Stage = stage;
-
-	CreateInfo
-		.setStage(Stage)
-		.setModule(Module)
-		.setPName("main");
-
-	SPDLOG_INFO("Loaded shader '{}'!", path);
-
-	return operator bool();
-}
-
-void Shader::Destroy()
-{
-	if (Module)
-	{
-		Renderer::GetInstance().Device.destroyShaderModule(Module);
-		Module = nullptr;
-	}
+	return true;
 }
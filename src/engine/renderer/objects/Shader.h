@@ -15,6 +15,10 @@ public:
 	bool Create(const AssetPathRel& path, vk::ShaderStageFlagBits stage);
 	void Destroy();
 
+	// Recompiles all shader sources in the shaders directories whose code
+	// changed, spread over all cores. Returns the number of compiled shaders.
+	static uint32_t CompileStaleShaders();
+
 	operator bool()
 	{
 		return Module.operator bool();
@@ -23,4 +27,8 @@ public:
 	vk::ShaderModule Module;
 	vk::ShaderStageFlagBits Stage;
 	vk::PipelineShaderStageCreateInfo CreateInfo;
+
+private:
+	// Compiles the shader if its hash changed. Thread-safe.
+	static bool CompileIfStale(const AssetPathRel& path, bool* compiled = nullptr);
 };
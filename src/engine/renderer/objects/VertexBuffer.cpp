@@ -35,7 +35,5 @@ void VertexBuffer::Stage(void* source, size_t size, size_t offset)
 {
 	assert(size <= BufferCPU.Size);
 
-	void* target = Renderer::GetInstance().Device.mapMemory(BufferCPU.Memory, offset, size);
-	memcpy(target, source, size);
-	Renderer::GetInstance().Device.unmapMemory(BufferCPU.Memory);
+	BufferCPU.Map(source, size, offset);
 }
@@ -0,0 +1,173 @@
+#include "engine/hzpch.h"
+#include "engine/utils/HardwareCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::atomic_bool HardwareCounters::s_Enabled = false;
+std::atomic_uint32_t HardwareCounters::s_Available = 0;
+
+#ifdef __linux__
+
+// ------------------------------------------------------------------------
+
+namespace
+{
+	struct EventConfig
+	{
+		uint32_t Type;
+		uint64_t Config;
+	};
+
+	constexpr uint64_t CacheConfig(uint64_t cache, uint64_t op, uint64_t result)
+	{
+		return cache | (op << 8) | (result << 16);
+	}
+
+	// in the order of HardwareCounters::Counter
+	const EventConfig EventConfigs[HardwareCounters::NumCounters] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HW_CACHE, CacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	};
+
+	// One group per thread, so that a single read returns all counters.
+	struct ThreadCounters
+	{
+		int Leader = -1;
+		int Fds[HardwareCounters::NumCounters];
+		int Slots[HardwareCounters::NumCounters]; // position in the group, -1 if not open
+		uint32_t NumOpen = 0;
+		bool Opened = false;
+
+		void Open()
+		{
+			Opened = true;
+
+			for (uint32_t i = 0; i < HardwareCounters::NumCounters; i++)
+			{
+				perf_event_attr attr = {};
+				attr.size = sizeof(attr);
+				attr.type = EventConfigs[i].Type;
+				attr.config = EventConfigs[i].Config;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+				// this thread on any CPU
+				const int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, Leader, 0));
+
+				Fds[i] = fd;
+				Slots[i] = fd >= 0 ? int(NumOpen++) : -1;
+
+				if (fd >= 0 && Leader < 0)
+					Leader = fd;
+			}
+
+			static std::atomic_bool warned = false;
+
+			if (Leader < 0 && !warned.exchange(true))
+				SPDLOG_WARN("Hardware counters are not available, check /proc/sys/kernel/perf_event_paranoid.");
+		}
+
+		~ThreadCounters()
+		{
+			if (!Opened)
+				return;
+
+			// members before the leader
+			for (int i = HardwareCounters::NumCounters - 1; i >= 0; i--)
+			{
+				if (Fds[i] >= 0)
+					close(Fds[i]);
+			}
+		}
+	};
+}
+
+// ------------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+bool HardwareCounters::IsSupported()
+{
+	return true;
+}
+
+bool HardwareCounters::Read(Values& values)
+{
+	thread_local ThreadCounters counters;
+
+	if (!counters.Opened)
+	{
+		counters.Open();
+
+		uint32_t available = 0;
+		for (uint32_t i = 0; i < NumCounters; i++)
+		{
+			if (counters.Slots[i] >= 0)
+				available |= 1u << i;
+		}
+
+		s_Available.fetch_or(available, std::memory_order_relaxed);
+	}
+
+	if (counters.Leader < 0)
+		return false;
+
+	// nr, time enabled, time running, one value per open counter
+	uint64_t data[3 + NumCounters];
+
+	if (read(counters.Leader, data, sizeof(data)) < ssize_t((3 + counters.NumOpen) * sizeof(uint64_t)))
+		return false;
+
+	const uint64_t enabled = data[1];
+	const uint64_t running = data[2];
+
+	// the kernel multiplexes the counters if there are too few registers
+	const double scale = running && running < enabled ? double(enabled) / double(running) : 1.0;
+
+	for (uint32_t i = 0; i < NumCounters; i++)
+	{
+		const int slot = counters.Slots[i];
+		values[i] = slot >= 0 ? uint64_t(double(data[3 + slot]) * scale) : 0;
+	}
+
+	return true;
+}
+
+#else
+
+// ------------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+bool HardwareCounters::IsSupported()
+{
+	return false;
+}
+
+bool HardwareCounters::Read(Values& values)
+{
+	return false;
+}
+
+#endif
+
+const char* HardwareCounters::GetName(Counter counter)
+{
+	switch (counter)
+	{
+	case Cycles:       return "cycles";
+	case Instructions: return "instructions";
+	case L1DMisses:    return "l1d_misses";
+	case LLCMisses:    return "llc_misses";
+	case BranchMisses: return "branch_misses";
+	default:           return "unknown";
+	}
+}
+
+// ------------------------------------------------------------------------
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+/*
+* Hardware performance counters of the calling thread, read with
+* perf_event_open on Linux. On other platforms, or if the kernel refuses
+* access (see /proc/sys/kernel/perf_event_paranoid), no counter is available
+* and Read fails.
+*
+* While enabled, every PROFILE_SCOPE reads the counters at its start and end,
+* which costs two system calls per scope, and the Profiler sums them up per
+* scope and thread.
+*/
+class HardwareCounters
+{
+public:
+	enum Counter
+	{
+		Cycles,
+		Instructions,
+		L1DMisses,
+		LLCMisses,
+		BranchMisses,
+		NumCounters
+	};
+
+	// Counters that are not available stay zero.
+	using Values = std::array<uint64_t, NumCounters>;
+
+public:
+	static void SetEnabled(bool enabled) { s_Enabled.store(enabled, std::memory_order_relaxed); }
+	static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+	// Whether the platform supports counters at all.
+	static bool IsSupported();
+
+	// Opens the counters of the calling thread on first use. The values are
+	// totals since then, scaled up if the kernel multiplexed the counters.
+	static bool Read(Values& values);
+
+	// Bit i is set if Counter i could be opened on any thread.
+	static uint32_t GetAvailable() { return s_Available.load(std::memory_order_relaxed); }
+	static bool IsAvailable(Counter counter) { return GetAvailable() & (1u << counter); }
+
+	static const char* GetName(Counter counter);
+
+private:
+	static std::atomic_bool s_Enabled;
+	static std::atomic_uint32_t s_Available;
+};
@@ -0,0 +1,109 @@
+#include "engine/hzpch.h"
+#include "engine/utils/Log.h"
+#include "engine/utils/Statistics.h"
+
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+std::mutex Log::s_CallSitesMutex;
+std::vector<Log::CallSite*> Log::s_CallSites;
+size_t Log::s_NumDropped = 0;
+
+// ------------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+Log::CallSite::CallSite(const char* file, int line) :
+	m_Name(std::filesystem::path(file).filename().string() + ":" + std::to_string(line))
+{
+	// call sites are function-local statics, they live until the end
+	std::lock_guard lock(s_CallSitesMutex);
+	s_CallSites.push_back(this);
+}
+
+bool Log::CallSite::Allow()
+{
+	using namespace std::chrono;
+
+	constexpr int64_t window = duration_cast<steady_clock::duration>(seconds(1)).count();
+	const int64_t now = steady_clock::now().time_since_epoch().count();
+
+	int64_t start = m_WindowStart.load(std::memory_order_relaxed);
+
+	// only one thread starts the next window
+	if (now - start >= window &&
+		m_WindowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+	{
+		const uint32_t last = m_NumInWindow.exchange(0, std::memory_order_relaxed);
+
+		if (last > MaxPerSecond)
+			SPDLOG_WARN("{} messages of {} were suppressed.", last - MaxPerSecond, m_Name);
+	}
+
+	if (m_NumInWindow.fetch_add(1, std::memory_order_relaxed) < MaxPerSecond)
+		return true;
+
+	m_NumSuppressed.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void Log::Init()
+{
+	// a single writer thread keeps the messages in order
+	spdlog::init_thread_pool(QueueSize, 1);
+
+	auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+
+	// unnamed like the default logger, so that the format stays the same
+	auto logger = std::make_shared<spdlog::async_logger>("",
+														 std::move(sink),
+														 spdlog::thread_pool(),
+														 spdlog::async_overflow_policy::overrun_oldest);
+
+	logger->flush_on(spdlog::level::err);
+
+	spdlog::set_default_logger(std::move(logger));
+}
+
+void Log::Exit()
+{
+	std::lock_guard lock(s_CallSitesMutex);
+
+	for (const CallSite* site : s_CallSites)
+	{
+		if (site->GetNumSuppressed())
+			SPDLOG_INFO("{} messages of {} were suppressed in total.", site->GetNumSuppressed(), site->GetName());
+	}
+
+	spdlog::shutdown();
+}
+
+void Log::CountSuppressed()
+{
+	{
+		std::lock_guard lock(s_CallSitesMutex);
+
+		for (CallSite* site : s_CallSites)
+		{
+			const uint64_t suppressed = site->GetNumSuppressed();
+
+			if (suppressed == site->m_NumCounted)
+				continue;
+
+			GlobalStatistics.CountUp(("Log suppressed " + site->GetName()).c_str(), suppressed - site->m_NumCounted);
+			site->m_NumCounted = suppressed;
+		}
+	}
+
+	if (auto pool = spdlog::thread_pool())
+	{
+		const size_t dropped = pool->overrun_counter();
+
+		if (dropped != s_NumDropped)
+		{
+			GlobalStatistics.CountUp("Log dropped", dropped - s_NumDropped);
+			s_NumDropped = dropped;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------
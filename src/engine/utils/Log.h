@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+/*
+* Sets up spdlog with an asynchronous default logger: a call formats the
+* message and queues it, a background thread writes it. If the queue is
+* full, the oldest messages are dropped, so logging never blocks a worker.
+*
+* Hot paths log with the *_LIMITED macros, which let at most MaxPerSecond
+* messages per second through per call site. Suppressed and dropped
+* messages are counted in GlobalStatistics.
+*/
+class Log
+{
+public:
+	class CallSite
+	{
+	public:
+		static constexpr uint32_t MaxPerSecond = 10;
+
+		CallSite(const char* file, int line);
+
+		bool Allow();
+
+		const std::string& GetName() const { return m_Name; }
+		uint64_t GetNumSuppressed() const { return m_NumSuppressed.load(std::memory_order_relaxed); }
+
+	private:
+		std::string m_Name; // file name and line
+
+		std::atomic_int64_t m_WindowStart = 0; // in steady clock ticks
+		std::atomic_uint32_t m_NumInWindow = 0;
+		std::atomic_uint64_t m_NumSuppressed = 0;
+
+		friend class Log;
+		uint64_t m_NumCounted = 0; // main thread only
+	};
+
+public:
+	static void Init();
+	static void Exit(); // writes the queued messages
+
+	// Main thread, once per frame after GlobalStatistics.Begin.
+	static void CountSuppressed();
+
+private:
+	static constexpr size_t QueueSize = 8192; // messages
+
+	static std::mutex s_CallSitesMutex;
+	static std::vector<CallSite*> s_CallSites;
+	static size_t s_NumDropped;
+};
+
+#define SPDLOG_LIMITED(level, ...) \
+	do \
+	{ \
+		static Log::CallSite callSite_(__FILE__, __LINE__); \
+		if (callSite_.Allow()) \
+			SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(), level, __VA_ARGS__); \
+	} while (0)
+
+#define SPDLOG_WARN_LIMITED(...) SPDLOG_LIMITED(spdlog::level::warn, __VA_ARGS__)
+#define SPDLOG_ERROR_LIMITED(...) SPDLOG_LIMITED(spdlog::level::err, __VA_ARGS__)
@@ -1,26 +1,51 @@
 #pragma once
 
+#include "engine/utils/HardwareCounters.h"
+#include "engine/utils/Profiler.h"
+
+// Can be used on any thread. The scope is recorded by the Profiler, which
+// adds it to Storage on the main thread.
 class PerformanceTimer
 {
 public:
-	using Clock = std::chrono::high_resolution_clock;
-	using TimePoint = std::chrono::high_resolution_clock::time_point;
-	using Duration = std::chrono::high_resolution_clock::duration;
+	using Clock = Profiler::Clock;
+	using TimePoint = Clock::time_point;
+	using Duration = Clock::duration;
 
 public:
 	PerformanceTimer(const char* name) : Name(name)
 	{
+		Depth = Profiler::BeginScope();
+		Counting = HardwareCounters::IsEnabled() && HardwareCounters::Read(Counters);
 		Start = Clock::now();
 	}
 
 	~PerformanceTimer()
 	{
-		TimePoint end = Clock::now();
-		Storage.Timers[Name].Add(end - Start);
+		const TimePoint end = Clock::now();
+
+		if (!Counting)
+		{
+			Profiler::EndScope(Name, Start, end, Depth);
+			return;
+		}
+
+		HardwareCounters::Values counters;
+		HardwareCounters::Read(counters);
+
+		// the scaled totals of multiplexed counters may even decrease
+		for (size_t i = 0; i < counters.size(); i++)
+			counters[i] = counters[i] > Counters[i] ? counters[i] - Counters[i] : 0;
+
+		Profiler::EndScope(Name, Start, end, Depth, &counters);
 	}
 
 	const char* Name;
 	TimePoint Start;
+	uint32_t Depth;
+
+	bool Counting;
+	HardwareCounters::Values Counters; // at the start
 
 public:
 	template <size_t Capacity>
@@ -44,9 +69,10 @@ public:
 		Duration Values[Capacity];
 	};
 
+	// main thread only
 	static struct _Storage
 	{
-		std::unordered_map<const char*, Timeline<60>> Timers;
+		std::unordered_map<std::string, Timeline<60>> Timers;
 	} Storage;
 
 	static std::string Stringify(const char* timer)
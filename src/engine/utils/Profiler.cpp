@@ -0,0 +1,378 @@
+#include "engine/hzpch.h"
+#include "engine/utils/Profiler.h"
+#include "engine/utils/PerformanceTimer.h"
+#include "engine/assets/AssetManager.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+std::mutex Profiler::s_BuffersMutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::s_Buffers;
+uint32_t Profiler::s_NextThreadIndex = 0;
+
+bool Profiler::s_Capturing = false;
+std::vector<Profiler::CapturedEvent> Profiler::s_CapturedEvents;
+std::vector<Profiler::ThreadInfo> Profiler::s_CapturedThreads;
+uint64_t Profiler::s_NumDropped = 0;
+Profiler::Clock::time_point Profiler::s_Epoch;
+Profiler::CounterTotalsMap Profiler::s_CounterTotals;
+
+// ------------------------------------------------------------------------
+
+static std::string EscapeJson(const std::string& s)
+{
+	std::string r;
+	r.reserve(s.size());
+
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+		{
+			r += '\\';
+			r += c;
+		}
+		else if (uint8_t(c) < 0x20)
+			r += ' ';
+		else
+			r += c;
+	}
+
+	return r;
+}
+
+// ------------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	std::lock_guard lock(s_BuffersMutex);
+	buffer.Name = name;
+}
+
+uint32_t Profiler::BeginScope()
+{
+	return GetThreadBuffer().Depth++;
+}
+
+void Profiler::EndScope(const char* name, Clock::time_point start, Clock::time_point end, uint32_t depth,
+						const HardwareCounters::Values* counters)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	buffer.Depth = depth;
+
+	const uint32_t head = buffer.Head.load(std::memory_order_relaxed);
+
+	if (head - buffer.Tail.load(std::memory_order_acquire) >= Capacity)
+	{
+		buffer.NumDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.Events[head % Capacity] = Event{ name, start, end, depth, counters != nullptr };
+
+	if (counters)
+		buffer.Counters[head % Capacity] = *counters;
+
+	buffer.Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::Collect()
+{
+	// The names of the timers are their keys, the pointers to the literals
+	// only find them faster. Equal literals may have different addresses.
+	static std::unordered_map<const char*, PerformanceTimer::Timeline<60>*> timers;
+
+	std::lock_guard lock(s_BuffersMutex);
+
+	for (auto it = s_Buffers.begin(); it != s_Buffers.end();)
+	{
+		ThreadBuffer& buffer = **it;
+
+		// before the head, so that the last events of an exited thread are included
+		const bool retired = buffer.Retired.load(std::memory_order_acquire);
+
+		const uint32_t head = buffer.Head.load(std::memory_order_acquire);
+		const uint32_t tail = buffer.Tail.load(std::memory_order_relaxed);
+
+		for (uint32_t i = tail; i != head; i++)
+		{
+			const Event& event = buffer.Events[i % Capacity];
+
+			auto& timer = timers[event.Name];
+			if (!timer)
+				timer = &PerformanceTimer::Storage.Timers[event.Name];
+
+			timer->Add(event.End - event.Start);
+
+			if (event.HasCounters)
+			{
+				CounterTotals& totals = s_CounterTotals[{ event.Name, buffer.Index }];
+				totals.Thread = buffer.Name;
+				totals.Calls++;
+
+				const HardwareCounters::Values& counters = buffer.Counters[i % Capacity];
+				for (size_t c = 0; c < counters.size(); c++)
+					totals.Sum[c] += counters[c];
+			}
+
+			if (s_Capturing && event.End >= s_Epoch)
+				s_CapturedEvents.push_back({ event, buffer.Index });
+		}
+
+		buffer.Tail.store(head, std::memory_order_release);
+		s_NumDropped += buffer.NumDropped.exchange(0, std::memory_order_relaxed);
+
+		if (s_Capturing && head != tail)
+		{
+			auto thread = std::find_if(s_CapturedThreads.begin(), s_CapturedThreads.end(), [&](const ThreadInfo& info) {
+				return info.Index == buffer.Index;
+			});
+
+			if (thread == s_CapturedThreads.end())
+				s_CapturedThreads.push_back({ buffer.Index, buffer.Name });
+			else
+				thread->Name = buffer.Name;
+		}
+
+		if (retired)
+			it = s_Buffers.erase(it);
+		else
+			++it;
+	}
+
+	if (s_Capturing && s_CapturedEvents.size() >= MaxCapturedEvents)
+	{
+		SPDLOG_WARN("Trace capture is full, it stops after {} events.", s_CapturedEvents.size());
+		EndCapture();
+	}
+}
+
+void Profiler::BeginCapture()
+{
+	s_CapturedEvents.clear();
+	s_CapturedThreads.clear();
+	s_NumDropped = 0;
+	s_Epoch = Clock::now();
+	s_Capturing = true;
+}
+
+void Profiler::EndCapture()
+{
+	s_Capturing = false;
+}
+
+bool Profiler::ExportChromeTrace(const std::filesystem::path& path)
+{
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Could not write trace to '{}'!", path.string());
+		return false;
+	}
+
+	bool first = true;
+	auto separator = [&]() -> const char* {
+		const char* s = first ? "\n" : ",\n";
+		first = false;
+		return s;
+	};
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	for (const ThreadInfo& thread : s_CapturedThreads)
+	{
+		file << separator()
+			 << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.Index
+			 << ",\"args\":{\"name\":\"" << EscapeJson(thread.Name) << "\"}}";
+
+		file << separator()
+			 << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.Index
+			 << ",\"args\":{\"sort_index\":" << thread.Index << "}}";
+	}
+
+	// complete events in microseconds, nested scopes are stacked by time
+	file << std::fixed << std::setprecision(3);
+
+	for (const CapturedEvent& e : s_CapturedEvents)
+	{
+		const double ts = std::chrono::duration<double, std::micro>(e.Scope.Start - s_Epoch).count();
+		const double dur = std::chrono::duration<double, std::micro>(e.Scope.End - e.Scope.Start).count();
+
+		file << separator()
+			 << "{\"name\":\"" << EscapeJson(e.Scope.Name)
+			 << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.Thread
+			 << ",\"ts\":" << ts
+			 << ",\"dur\":" << dur
+			 << ",\"args\":{\"depth\":" << e.Scope.Depth << "}}";
+	}
+
+	file << "\n]}\n";
+
+	SPDLOG_INFO("Exported {} events of {} threads to '{}'.",
+				s_CapturedEvents.size(),
+				s_CapturedThreads.size(),
+				path.string());
+
+	if (s_NumDropped)
+		SPDLOG_WARN("{} events were dropped during the capture.", s_NumDropped);
+
+	return true;
+}
+
+Profiler::CounterTotals Profiler::GetCounterTotals(const std::string& scope)
+{
+	CounterTotals result;
+
+	for (const auto& [key, totals] : s_CounterTotals)
+	{
+		if (key.first != scope)
+			continue;
+
+		result.Calls += totals.Calls;
+		for (size_t c = 0; c < totals.Sum.size(); c++)
+			result.Sum[c] += totals.Sum[c];
+	}
+
+	return result;
+}
+
+void Profiler::RenderUI()
+{
+	if (!s_Capturing)
+	{
+		if (ImGui::Button("Capture trace"))
+			BeginCapture();
+	}
+	else
+	{
+		if (ImGui::Button("Stop and export trace"))
+		{
+			EndCapture();
+			ExportChromeTrace(AssetManager::GetTempDirectory() / "trace.json");
+		}
+
+		ImGui::SameLine();
+		ImGui::Text("%zu events", s_CapturedEvents.size());
+	}
+
+	RenderCounters();
+}
+
+// ------------------------------------------------------------------------
+// PRIVATE HELPER FUNCTIONS
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+{
+	// marks the buffer when the thread exits, Collect frees it once drained
+	struct Owner
+	{
+		ThreadBuffer* Buffer = nullptr;
+
+		~Owner()
+		{
+			if (Buffer)
+				Buffer->Retired.store(true, std::memory_order_release);
+		}
+	};
+
+	thread_local Owner owner;
+
+	if (!owner.Buffer)
+	{
+		auto buffer = std::make_unique<ThreadBuffer>();
+
+		std::lock_guard lock(s_BuffersMutex);
+
+		buffer->Index = s_NextThreadIndex++;
+		buffer->Name = "Thread " + std::to_string(buffer->Index);
+
+		owner.Buffer = buffer.get();
+		s_Buffers.push_back(std::move(buffer));
+	}
+
+	return *owner.Buffer;
+}
+
+void Profiler::RenderCounters()
+{
+	if (!HardwareCounters::IsSupported())
+		return;
+
+	bool enabled = HardwareCounters::IsEnabled();
+	if (ImGui::Checkbox("Hardware counters", &enabled))
+		HardwareCounters::SetEnabled(enabled);
+
+	if (!enabled)
+		return;
+
+	ImGui::SameLine();
+	if (ImGui::Button("Reset counters"))
+		ResetCounterTotals();
+
+	if (s_CounterTotals.empty())
+	{
+		if (!HardwareCounters::GetAvailable())
+			ImGui::TextUnformatted("No counters, check /proc/sys/kernel/perf_event_paranoid.");
+
+		return;
+	}
+
+	// misses per thousand instructions, so that layouts can be compared
+	// independently of the amount of work
+	constexpr ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+
+	if (!ImGui::BeginTable("Hardware counters", 8, flags))
+		return;
+
+	ImGui::TableSetupColumn("Scope");
+	ImGui::TableSetupColumn("Thread");
+	ImGui::TableSetupColumn("Calls");
+	ImGui::TableSetupColumn("Mcycles/call");
+	ImGui::TableSetupColumn("IPC");
+	ImGui::TableSetupColumn("L1D MPKI");
+	ImGui::TableSetupColumn("LLC MPKI");
+	ImGui::TableSetupColumn("Branch MPKI");
+	ImGui::TableHeadersRow();
+
+	for (const auto& [key, totals] : s_CounterTotals)
+	{
+		const HardwareCounters::Values& sum = totals.Sum;
+		const double instructions = double(sum[HardwareCounters::Instructions]);
+		const double perKilo = instructions > 0.0 ? 1000.0 / instructions : 0.0;
+
+		ImGui::TableNextRow();
+
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(key.first.c_str());
+
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(totals.Thread.c_str());
+
+		ImGui::TableNextColumn();
+		ImGui::Text("%llu", (unsigned long long)totals.Calls);
+
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", 1e-6 * double(sum[HardwareCounters::Cycles]) / double(totals.Calls));
+
+		ImGui::TableNextColumn();
+		ImGui::Text("%.2f", sum[HardwareCounters::Cycles] ? instructions / double(sum[HardwareCounters::Cycles]) : 0.0);
+
+		for (HardwareCounters::Counter counter : { HardwareCounters::L1DMisses, HardwareCounters::LLCMisses, HardwareCounters::BranchMisses })
+		{
+			ImGui::TableNextColumn();
+
+			if (HardwareCounters::IsAvailable(counter))
+				ImGui::Text("%.2f", double(sum[counter]) * perKilo);
+			else
+				ImGui::TextUnformatted("-");
+		}
+	}
+
+	ImGui::EndTable();
+}
+
+// ------------------------------------------------------------------------
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "engine/utils/HardwareCounters.h"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+/*
+* Collects the scopes of PROFILE_SCOPE from all threads.
+*
+* Every thread records into its own ring buffer, which only that thread
+* writes and only Collect reads, so recording takes no lock. Collect runs
+* once per frame on the main thread. It feeds the "Timers" window and, while
+* a capture is running, keeps the events for a Chrome trace, which can be
+* opened in chrome://tracing or ui.perfetto.dev.
+*
+* Events are dropped if a ring buffer is full, i.e. if a thread records more
+* than Capacity scopes between two calls to Collect.
+*
+* While HardwareCounters are enabled, Collect also sums up the counters of
+* every scope per thread, e.g. of each worker of the ray marcher.
+*/
+class Profiler
+{
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct Event
+	{
+		const char* Name;
+		Clock::time_point Start;
+		Clock::time_point End;
+		uint32_t Depth; // of nested scopes on the thread
+		bool HasCounters = false;
+	};
+
+	// of one scope on one thread since the last reset
+	struct CounterTotals
+	{
+		std::string Thread;
+		uint64_t Calls = 0;
+		HardwareCounters::Values Sum = {};
+	};
+
+	// by scope name and thread index
+	using CounterTotalsMap = std::map<std::pair<std::string, uint32_t>, CounterTotals>;
+
+public:
+	// Threads without a name show up by their index.
+	static void SetThreadName(const std::string& name);
+
+	// Called by PerformanceTimer.
+	static uint32_t BeginScope();
+	static void EndScope(const char* name, Clock::time_point start, Clock::time_point end, uint32_t depth,
+						 const HardwareCounters::Values* counters = nullptr);
+
+	// Main thread, once per frame.
+	static void Collect();
+
+	static void BeginCapture();
+	static void EndCapture();
+	static bool IsCapturing() { return s_Capturing; }
+
+	// Writes the captured events as Chrome trace JSON.
+	static bool ExportChromeTrace(const std::filesystem::path& path);
+
+	// Main thread only.
+	static const CounterTotalsMap& GetCounterTotals() { return s_CounterTotals; }
+	// summed over all threads
+	static CounterTotals GetCounterTotals(const std::string& scope);
+	static void ResetCounterTotals() { s_CounterTotals.clear(); }
+
+	static void RenderUI();
+
+private:
+	static constexpr uint32_t Capacity = 4096; // events per thread
+	static constexpr size_t MaxCapturedEvents = 4 * 1024 * 1024;
+
+	struct ThreadBuffer
+	{
+		std::array<Event, Capacity> Events;
+		std::array<HardwareCounters::Values, Capacity> Counters; // of the events with HasCounters
+
+		// written by the owning thread
+		alignas(64) std::atomic_uint32_t Head = 0;
+		// written by Collect
+		alignas(64) std::atomic_uint32_t Tail = 0;
+
+		std::atomic_uint64_t NumDropped = 0;
+		std::atomic_bool Retired = false; // the thread has exited
+
+		uint32_t Depth = 0; // only used by the owning thread
+		uint32_t Index = 0;
+		std::string Name;
+	};
+
+	struct ThreadInfo
+	{
+		uint32_t Index;
+		std::string Name;
+	};
+
+	struct CapturedEvent
+	{
+		Event Scope;
+		uint32_t Thread;
+	};
+
+	static ThreadBuffer& GetThreadBuffer();
+	static void RenderCounters();
+
+private:
+	static std::mutex s_BuffersMutex; // only for adding and removing threads
+	static std::vector<std::unique_ptr<ThreadBuffer>> s_Buffers;
+	static uint32_t s_NextThreadIndex;
+
+	// main thread only
+	static bool s_Capturing;
+	static std::vector<CapturedEvent> s_CapturedEvents;
+	static std::vector<ThreadInfo> s_CapturedThreads;
+	static uint64_t s_NumDropped;
+	static Clock::time_point s_Epoch;
+	static CounterTotalsMap s_CounterTotals;
+};
@@ -1,6 +1,10 @@
 #include "engine/hzpch.h"
 #include "engine/utils/Statistics.h"
 #include "engine/utils/PerformanceTimer.h"
+#include "engine/assets/AssetManager.h"
+
+#include <algorithm>
+#include <fstream>
 
 Statistics GlobalStatistics("Global");
 
@@ -9,12 +13,27 @@ void Statistics::Entry::Sample(float data)
 	Samples[Index] = data;
 	NumSamples = std::min(MaxSamples, NumSamples + 1);
 	Index = (Index + 1) % MaxSamples;
+
+	Buckets[GetBucket(data)]++;
+	TotalMin = TotalSamples ? std::min(TotalMin, data) : data;
+	TotalMax = TotalSamples ? std::max(TotalMax, data) : data;
+	TotalSum += data;
+	TotalSamples++;
+}
+
+void Statistics::Entry::ResetHistogram()
+{
+	Buckets.fill(0);
+	TotalSamples = 0;
+	TotalSum = 0.0;
+	TotalMin = 0.0f;
+	TotalMax = 0.0f;
 }
 
 float Statistics::Entry::GetBack() const
 {
 	HZ_ASSERT(NumSamples, "Entry has no samples!");
-	return Samples[Index];
+	return Samples[(Index + MaxSamples - 1) % MaxSamples];
 }
 
 float Statistics::Entry::GetAverage() const
@@ -50,11 +69,76 @@ float Statistics::Entry::GetMax() const
 	return max;
 }
 
+float Statistics::Entry::GetPercentile(float p) const
+{
+	if (TotalSamples == 0)
+		return 0.0f;
+
+	const uint64_t rank = std::max(uint64_t(1), uint64_t(std::ceil(double(p) * double(TotalSamples))));
+
+	uint64_t count = 0;
+	size_t bucket = 0;
+
+	for (; bucket < NumBuckets - 1; bucket++)
+	{
+		count += Buckets[bucket];
+		if (count >= rank)
+			break;
+	}
+
+	// the exact extremes are known
+	return std::clamp(GetBucketValue(bucket), TotalMin, TotalMax);
+}
+
+float Statistics::Entry::GetTotalAverage() const
+{
+	if (TotalSamples == 0)
+		return 0.0f;
+
+	return float(TotalSum / double(TotalSamples));
+}
+
+size_t Statistics::Entry::GetBucket(float value)
+{
+	// value = mantissa * 2^exponent, mantissa in [0.5, 1)
+	int exponent;
+	const float mantissa = std::frexp(value, &exponent);
+	exponent--;
+
+	if (!(value > 0.0f) || exponent < MinExponent)
+		return 0;
+
+	if (exponent >= MaxExponent)
+		return NumBuckets - 1;
+
+	const int sub = std::min(int((2.0f * mantissa - 1.0f) * SubBuckets), SubBuckets - 1);
+
+	return 1 + size_t(exponent - MinExponent) * SubBuckets + size_t(sub);
+}
+
+float Statistics::Entry::GetBucketValue(size_t bucket)
+{
+	if (bucket == 0)
+		return 0.0f;
+
+	const int exponent = MinExponent + int((bucket - 1) / SubBuckets);
+	const int sub = int((bucket - 1) % SubBuckets);
+
+	// center of the bucket
+	return std::ldexp(1.0f + (float(sub) + 0.5f) / float(SubBuckets), exponent);
+}
+
+// ------------------------------------------------------------------------
+
 void Statistics::Begin()
 {
-	// reset counters
+	// keep the counters of the last frame for display and export
+	m_LastCounters = m_Counters;
+
 	for (auto& [k, v] : m_Counters)
 		v = 0;
+
+	ExportPeriodically();
 }
 
 Statistics::Entry& Statistics::Get(size_t hash)
@@ -79,62 +163,301 @@ void Statistics::CountUp(size_t hash, size_t amount)
 	m_Counters[hash] += amount;
 }
 
-void Statistics::ImGuiRender()
+void Statistics::ResetHistograms()
 {
-	/*std::string strId = "Statistics - " + m_StatsName;
+	for (auto& [hash, entry] : m_Entries)
+		entry.ResetHistogram();
+}
 
-	ImGui::Begin(strId.c_str(), &m_Open);
+void Statistics::ImGuiRender()
+{
+	std::string strId = "Statistics - " + m_StatsName;
 
-	if (m_Entries.empty() && m_Counters.empty())
-	{
-		ImGui::Text("Nothing to display");
-	}
-	else
+	if (m_Open)
 	{
-		ImGui::BeginTable(strId.c_str(), 2, ImGuiTableFlags_BordersOuter | ImGuiTableFlags_RowBg);
-
-		ImGui::TableSetupColumn("Name");
-		ImGui::TableSetupColumn("Value");
-		ImGui::TableHeadersRow();
+		ImGui::Begin(strId.c_str(), &m_Open);
 
-		for (auto& [hash, entry] : m_Entries)
-		{
-			ImGui::TableNextRow();
+		if (ImGui::Button("Reset percentiles"))
+			ResetHistograms();
 
-			ImGui::TableNextColumn();
-			ImGui::Text((m_Names[hash] + ":").c_str());
+		ImGui::SameLine();
+		if (ImGui::Button("Export"))
+			ExportToTempDirectory();
 
-			ImGui::TableNextColumn();
-			if (entry.NumSamples)
-				ImGui::Text(std::to_string(entry.GetBack()).c_str());
-			else ImGui::Text("-");
+		ImGui::Checkbox("Export periodically", &m_ExportPeriodically);
+		if (m_ExportPeriodically)
+		{
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(80.0f);
+			ImGui::DragFloat("Interval [s]", &m_ExportInterval, 0.5f, 1.0f, 600.0f);
 		}
 
-		for (auto& [hash, counter] : m_Counters)
+		if (m_Entries.empty() && m_LastCounters.empty())
 		{
-			ImGui::TableNextRow();
+			ImGui::Text("Nothing to display");
+		}
+		else
+		{
+			std::vector<size_t> hashes;
+
+			if (!m_Entries.empty() &&
+				ImGui::BeginTable(strId.c_str(), 8, ImGuiTableFlags_BordersOuter | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable))
+			{
+				ImGui::TableSetupColumn("Name");
+				ImGui::TableSetupColumn("Last");
+				ImGui::TableSetupColumn("Avg");
+				ImGui::TableSetupColumn("p50");
+				ImGui::TableSetupColumn("p95");
+				ImGui::TableSetupColumn("p99");
+				ImGui::TableSetupColumn("Max");
+				ImGui::TableSetupColumn("Samples");
+				ImGui::TableHeadersRow();
+
+				for (const auto& [hash, entry] : m_Entries)
+					hashes.push_back(hash);
+				SortByName(hashes);
 
-			ImGui::TableNextColumn();
-			ImGui::Text((m_Names[hash] + ":").c_str());
+				for (size_t hash : hashes)
+				{
+					const Entry& entry = m_Entries[hash];
 
-			ImGui::TableNextColumn();
-			ImGui::Text(std::to_string(counter).c_str());
+					ImGui::TableNextRow();
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", GetName(hash).c_str());
+
+					ImGui::TableNextColumn();
+					if (entry.NumSamples)
+						ImGui::Text("%.3f", entry.GetBack());
+					else ImGui::Text("-");
+
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", entry.GetAverage());
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", entry.GetPercentile(0.50f));
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", entry.GetPercentile(0.95f));
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", entry.GetPercentile(0.99f));
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", entry.TotalMax);
+					ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)entry.TotalSamples);
+				}
+
+				ImGui::EndTable();
+			}
+
+			if (!m_LastCounters.empty() &&
+				ImGui::BeginTable((strId + " counters").c_str(), 2, ImGuiTableFlags_BordersOuter | ImGuiTableFlags_RowBg))
+			{
+				ImGui::TableSetupColumn("Counter");
+				ImGui::TableSetupColumn("Last frame");
+				ImGui::TableHeadersRow();
+
+				hashes.clear();
+				for (const auto& [hash, counter] : m_LastCounters)
+					hashes.push_back(hash);
+				SortByName(hashes);
+
+				for (size_t hash : hashes)
+				{
+					ImGui::TableNextRow();
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", GetName(hash).c_str());
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%zu", m_LastCounters[hash]);
+				}
+
+				ImGui::EndTable();
+			}
 		}
 
-		ImGui::EndTable();
+		ImGui::End();
 	}
 
-	ImGui::End();*/
-
 	ImGui::Begin("Timers");
+
+	Profiler::RenderUI();
+
+	if (!m_Open && ImGui::Button(("Show " + strId).c_str()))
+		m_Open = true;
 	
 	{
 		for (const auto& [name, duration] : PerformanceTimer::Storage.Timers)
 		{
-			ImGui::Text("%s:", name);
+			ImGui::Text("%s:", name.c_str());
 			ImGui::Text("  %s", PerformanceTimer::Stringify(duration.GetAverage()).c_str());
 		}
 	}
 
 	ImGui::End();
 }
+
+bool Statistics::ExportCSV(const std::filesystem::path& path)
+{
+	// the first export of a session starts the file over
+	const bool append = m_CSVStarted && std::filesystem::exists(path);
+	std::ofstream file(path, append ? std::ios::app : std::ios::trunc);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Could not write statistics to '{}'!", path.string());
+		return false;
+	}
+
+	m_CSVStarted = true;
+
+	if (!append)
+		file << "time,name,samples,mean,min,p50,p95,p99,max\n";
+
+	const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+
+	std::vector<size_t> hashes;
+	for (const auto& [hash, entry] : m_Entries)
+		hashes.push_back(hash);
+	SortByName(hashes);
+
+	for (size_t hash : hashes)
+	{
+		const Entry& entry = m_Entries[hash];
+
+		if (entry.TotalSamples == 0)
+			continue;
+
+		file << time << ",\"" << GetName(hash) << "\","
+			 << entry.TotalSamples << ","
+			 << entry.GetTotalAverage() << ","
+			 << entry.TotalMin << ","
+			 << entry.GetPercentile(0.50f) << ","
+			 << entry.GetPercentile(0.95f) << ","
+			 << entry.GetPercentile(0.99f) << ","
+			 << entry.TotalMax << "\n";
+	}
+
+	// counters have a single value
+	hashes.clear();
+	for (const auto& [hash, counter] : m_LastCounters)
+		hashes.push_back(hash);
+	SortByName(hashes);
+
+	for (size_t hash : hashes)
+	{
+		const float value = float(m_LastCounters[hash]);
+		file << time << ",\"" << GetName(hash) << "\",1,"
+			 << value << "," << value << "," << value << "," << value << "," << value << "," << value << "\n";
+	}
+
+	return true;
+}
+
+bool Statistics::ExportJSON(const std::filesystem::path& path)
+{
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Could not write statistics to '{}'!", path.string());
+		return false;
+	}
+
+	auto escape = [](const std::string& s) {
+		std::string r;
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+				r += '\\';
+			r += c;
+		}
+		return r;
+	};
+
+	const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+
+	file << "{\n\t\"name\": \"" << escape(m_StatsName) << "\",\n\t\"time\": " << time << ",\n\t\"entries\": [";
+
+	std::vector<size_t> hashes;
+	for (const auto& [hash, entry] : m_Entries)
+		hashes.push_back(hash);
+	SortByName(hashes);
+
+	const char* separator = "\n";
+
+	for (size_t hash : hashes)
+	{
+		const Entry& entry = m_Entries[hash];
+
+		file << separator
+			 << "\t\t{ \"name\": \"" << escape(GetName(hash))
+			 << "\", \"samples\": " << entry.TotalSamples
+			 << ", \"mean\": " << entry.GetTotalAverage()
+			 << ", \"min\": " << entry.TotalMin
+			 << ", \"p50\": " << entry.GetPercentile(0.50f)
+			 << ", \"p95\": " << entry.GetPercentile(0.95f)
+			 << ", \"p99\": " << entry.GetPercentile(0.99f)
+			 << ", \"max\": " << entry.TotalMax << " }";
+
+		separator = ",\n";
+	}
+
+	file << "\n\t],\n\t\"counters\": {";
+
+	hashes.clear();
+	for (const auto& [hash, counter] : m_LastCounters)
+		hashes.push_back(hash);
+	SortByName(hashes);
+
+	separator = "\n";
+
+	for (size_t hash : hashes)
+	{
+		file << separator << "\t\t\"" << escape(GetName(hash)) << "\": " << m_LastCounters[hash];
+		separator = ",\n";
+	}
+
+	file << "\n\t}\n}\n";
+
+	return true;
+}
+
+// ------------------------------------------------------------------------
+// PRIVATE HELPER FUNCTIONS
+
+const std::string& Statistics::GetName(size_t hash)
+{
+	std::string& name = m_Names[hash];
+
+	// sampled by hash only
+	if (name.empty())
+		name = fmt::format("{:016x}", hash);
+
+	return name;
+}
+
+void Statistics::SortByName(std::vector<size_t>& hashes)
+{
+	std::sort(hashes.begin(), hashes.end(), [this](size_t a, size_t b) {
+		return GetName(a) < GetName(b);
+	});
+}
+
+void Statistics::ExportPeriodically()
+{
+	if (!m_ExportPeriodically)
+		return;
+
+	const auto now = std::chrono::steady_clock::now();
+
+	if (std::chrono::duration<float>(now - m_LastExport).count() < m_ExportInterval)
+		return;
+
+	m_LastExport = now;
+
+	ExportToTempDirectory();
+}
+
+void Statistics::ExportToTempDirectory()
+{
+	const auto& directory = AssetManager::GetTempDirectory();
+
+	ExportCSV(directory / ("statistics_" + m_StatsName + ".csv"));
+	ExportJSON(directory / ("statistics_" + m_StatsName + ".json"));
+}
+
+// ------------------------------------------------------------------------
@@ -2,6 +2,9 @@
 
 #include "engine/utils/Utils.h"
 
+#include <array>
+#include <chrono>
+#include <filesystem>
 #include <unordered_map>
 
 class PerformanceTimer;
@@ -9,6 +12,14 @@ class PerformanceTimer;
 class Statistics
 {
 public:
+	/*
+	* Keeps the last MaxSamples values for the current average, min and max,
+	* and a histogram of all values since the last reset for percentiles.
+	*
+	* The histogram buckets are logarithmic: every power of two is split into
+	* SubBuckets linear buckets, so a percentile is off by at most 1/SubBuckets
+	* of its value. Values below 2^MinExponent count as zero.
+	*/
 	struct Entry
 	{
 		static constexpr size_t MaxSamples = 32;
@@ -17,12 +28,32 @@ public:
 		//std::array<float, MaxSamples> Samples;
 		float Samples[MaxSamples];
 
+		static constexpr int MinExponent = -16;
+		static constexpr int MaxExponent = 32;
+		static constexpr int SubBuckets = 16;
+		static constexpr size_t NumBuckets = (MaxExponent - MinExponent) * SubBuckets + 1;
+
+		std::array<uint32_t, NumBuckets> Buckets = {};
+		uint64_t TotalSamples = 0;
+		double TotalSum = 0.0;
+		float TotalMin = 0.0f;
+		float TotalMax = 0.0f;
+
 		void Sample(float data);
+		void ResetHistogram();
 
 		float GetBack() const;
 		float GetAverage() const;
 		float GetMin() const;
 		float GetMax() const;
+
+		// of all samples since the last reset, p in [0, 1]
+		float GetPercentile(float p) const;
+		float GetTotalAverage() const;
+
+	private:
+		static size_t GetBucket(float value);
+		static float GetBucketValue(size_t bucket);
 	};
 
 public:
@@ -51,19 +82,40 @@ public:
 	{
 		size_t hash = Utils::HashString(name);
 		m_Names[hash] = name;
-		
+
 		CountUp(hash, amount);
 	}
 
 	void CountUp(size_t hash, size_t amount = 1);
 
+	void ResetHistograms();
+
+	// One row per entry and export with the seconds since startup. The first
+	// export of a session overwrites the file, the following ones append.
+	bool ExportCSV(const std::filesystem::path& path);
+	// Snapshot of all entries and the counters of the last frame.
+	bool ExportJSON(const std::filesystem::path& path);
+
+private:
+	const std::string& GetName(size_t hash);
+	void SortByName(std::vector<size_t>& hashes);
+	void ExportPeriodically();
+	void ExportToTempDirectory();
+
 private:
 	std::unordered_map<size_t, Entry> m_Entries;
 	std::unordered_map<size_t, size_t> m_Counters;
+	std::unordered_map<size_t, size_t> m_LastCounters; // of the previous frame
 	std::unordered_map<size_t, std::string> m_Names;
 
 	std::string m_StatsName;
 	bool m_Open = true;
+
+	std::chrono::steady_clock::time_point m_StartTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point m_LastExport = m_StartTime;
+	bool m_ExportPeriodically = false;
+	bool m_CSVStarted = false;
+	float m_ExportInterval = 10.0f; // s
 };
 
 // global statistics instance
@@ -1,8 +1,47 @@
 #include "engine/hzpch.h"
 #include "engine/utils/Utils.h"
 
+#ifdef _WIN32
+	#include <windows.h>
+	#include <psapi.h>
+#elif defined(__linux__)
+	#include <sys/resource.h>
+	#include <unistd.h>
+	#include <fstream>
+#endif
+
 namespace Utils
 {
 	std::stack<RandomSession*> RandomSession::s_SessionStack;
 	RandomSession RandomSession::s_globalSession;
+
+	size_t GetProcessMemory()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.WorkingSetSize;
+#elif defined(__linux__)
+		// in pages: total, resident, ...
+		std::ifstream statm("/proc/self/statm");
+		size_t total, resident;
+		if (statm >> total >> resident)
+			return resident * size_t(sysconf(_SC_PAGESIZE));
+#endif
+		return 0;
+	}
+
+	size_t GetPeakProcessMemory()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			return size_t(usage.ru_maxrss) * 1024; // in kilobytes
+#endif
+		return 0;
+	}
 }
@@ -226,4 +226,10 @@ namespace Utils
 
 		return a[mi];
 	}
+
+	// ----------------------------------
+
+	// resident memory of the process in bytes, now and the peak since startup
+	size_t GetProcessMemory();
+	size_t GetPeakProcessMemory();
 }
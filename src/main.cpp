@@ -4,9 +4,12 @@
 #include <engine/events/EventManager.h>
 #include <engine/renderer/Renderer.h>
 
+#include <engine/utils/Log.h>
 #include <engine/utils/PerformanceTimer.h>
+#include <engine/utils/Profiler.h>
 #include <engine/utils/Statistics.h>
 #include <engine/input/Input.h>
+#include <engine/assets/AssetManager.h>
 
 #include "app/Dataset.h"
 #include "app/AdvancedRenderer/AdvancedRenderer.h"
@@ -65,8 +68,32 @@ public:
 			return false;
 
 		// init renderer
+		g_Renderer->ParticleCacheBudget =
+			vk::DeviceSize(config["particleCacheBudgetMB"].as<int>(512)) * 1024 * 1024;
+		g_Renderer->ParticleCachePrefetch = config["particleCachePrefetch"].as<uint32_t>(2);
+
+		if (auto threads = config["rayMarcherThreads"])
+			g_Renderer->m_RayMarcher.SetNumThreads(threads.as<uint32_t>());
+
 		g_Renderer->Init(dataset);
 
+		// replays a camera path, e.g. to compare two builds on the same scene
+		if (auto benchmarkConfig = config["benchmark"])
+		{
+			RendererBenchmark::Config benchmark;
+
+			const auto cameraPath = benchmarkConfig["cameraPath"].as<std::string>("");
+			if (!cameraPath.empty())
+				benchmark.CameraPath = AssetManager::MakeAssetPath(cameraPath);
+
+			benchmark.FirstFrame = benchmarkConfig["firstFrame"].as<int>(0);
+			benchmark.LastFrame = benchmarkConfig["lastFrame"].as<int>(INT_MAX);
+			benchmark.Output = benchmarkConfig["output"].as<std::string>("");
+			benchmark.ExitWhenDone = benchmarkConfig["exitWhenDone"].as<bool>(true);
+
+			g_Renderer->StartBenchmark(benchmark);
+		}
+
 		// add application layer
 		EventManager::LayerStack.AddLayer(new AppLayer);
 
@@ -123,17 +150,35 @@ void ApplicationImGui()
 
 int main()
 {
+	Log::Init();
+	Profiler::SetThreadName("Main");
+
 	App app;
 	app.Init();
 	//app.Run();
 
 	float delta = 1.0f / 60.0f;
 
+	std::optional<std::chrono::steady_clock::time_point> lastFrameStart;
+
 	while (app.Data.Running)
 	{
+		// the scopes of the previous frame, from all threads
+		Profiler::Collect();
+
 		PROFILE_SCOPE("Frame");
 
 		GlobalStatistics.Begin();
+		Log::CountSuppressed();
+
+		{
+			const auto now = std::chrono::steady_clock::now();
+
+			if (lastFrameStart)
+				GlobalStatistics.Sample("Frame time [ms]", std::chrono::duration<float, std::milli>(now - *lastFrameStart).count());
+
+			lastFrameStart = now;
+		}
 
 		// input
 		glfwPollEvents();
@@ -154,7 +199,7 @@ int main()
 		Vulkan.End();
 
 		// close window requested?
-		if (glfwWindowShouldClose(Vulkan.Window))
+		if (glfwWindowShouldClose(Vulkan.Window) || g_Renderer->Benchmark.ShouldExit())
 			app.Data.Running = false;
 	}
 
@@ -162,4 +207,6 @@ int main()
 	g_Renderer.reset();
 
 	app.Exit();
+
+	Log::Exit();
 }